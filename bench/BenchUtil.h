@@ -0,0 +1,29 @@
+// Copyright (c) 2024 Meerkat
+#ifndef BENCH_BENCHUTIL_H_
+#define BENCH_BENCHUTIL_H_
+
+#include <chrono>
+
+namespace bench {
+
+// Average wall time of one call to function over iterations calls, in
+// microseconds. The warmup calls before are not timed.
+template <typename Function>
+double time_us(Function function, int iterations = 1, int warmup = 0) {
+  for (int i = 0; i < warmup; ++i) {
+    function();
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    function();
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  return std::chrono::duration<double, std::micro>(end - start).count()
+    / iterations;
+}
+
+}  // namespace bench
+
+#endif  // BENCH_BENCHUTIL_H_
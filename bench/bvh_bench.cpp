@@ -0,0 +1,113 @@
+// Copyright (c) 2024 Meerkat
+#include "../inc/Bvh.h"
+#include "../inc/Frustum.h"
+#include "BenchUtil.h"
+#include <random>
+
+namespace {
+
+const int sQueryCount = 1000;
+
+void run(size_t instanceCount) {
+  // Instances spread over a square world roughly 10 units apart, like a
+  // mostly static level.
+  const float halfExtent = 5.0f * std::sqrt(static_cast<float>(instanceCount));
+
+  std::mt19937 generator(1);
+  std::uniform_real_distribution<float> position(-halfExtent, halfExtent);
+  std::uniform_real_distribution<float> height(0.0f, 20.0f);
+  std::uniform_real_distribution<float> radius(0.5f, 3.0f);
+
+  std::vector<glm::vec4> spheres(instanceCount);
+  for (glm::vec4& sphere : spheres) {
+    sphere = glm::vec4(position(generator), position(generator),
+                       height(generator), radius(generator));
+  }
+
+  vkUtil::Bvh bvh;
+  double buildTime = bench::time_us([&]() { bvh.build(spheres); });
+
+  // One percent of the instances move, then all of them.
+  std::vector<uint32_t> moved;
+  std::uniform_int_distribution<uint32_t> pick(
+    0, static_cast<uint32_t>(instanceCount - 1));
+  for (size_t i = 0; i < instanceCount / 100; ++i) {
+    uint32_t item = pick(generator);
+    spheres[item].x += 1.0f;
+    moved.push_back(item);
+  }
+  double partialRefitTime =
+    bench::time_us([&]() { bvh.refit(spheres, moved); });
+  double fullRefitTime = bench::time_us([&]() { bvh.refit(spheres); });
+
+  glm::mat4 view = glm::lookAt(
+    glm::vec3(0.0f, 0.0f, 10.0f),
+    glm::vec3(1.0f, 0.0f, 10.0f),
+    glm::vec3(0.0f, 0.0f, 1.0f));
+  glm::mat4 proj =
+    glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+  proj[1][1] *= -1;
+  const std::array<glm::vec4, 6> planes =
+    vkUtil::make_frustum_planes(proj * view);
+
+  std::vector<uint32_t> visible;
+  double frustumTime = bench::time_us([&]() {
+    visible.clear();
+    bvh.query_frustum(planes, &visible);
+  }, 20);
+
+  size_t bruteVisible = 0;
+  double bruteTime = bench::time_us([&]() {
+    bruteVisible = 0;
+    for (const glm::vec4& sphere : spheres) {
+      bool inside = true;
+      for (const glm::vec4& plane : planes) {
+        float distance = glm::dot(glm::vec3(plane), glm::vec3(sphere))
+          + plane.w;
+        inside = inside && distance >= -sphere.w;
+      }
+      bruteVisible += inside;
+    }
+  }, 20);
+
+  std::vector<uint32_t> overlaps;
+  double sphereTime = bench::time_us([&]() {
+    overlaps.clear();
+    bvh.query_sphere(
+      glm::vec3(position(generator), position(generator), 10.0f),
+      25.0f,
+      &overlaps);
+  }, sQueryCount);
+
+  uint32_t hits = 0;
+  double rayTime = bench::time_us([&]() {
+    glm::vec3 origin(position(generator), position(generator), 10.0f);
+    glm::vec3 direction = glm::normalize(
+      glm::vec3(position(generator), position(generator), 0.0f) - origin);
+    uint32_t item;
+    float distance;
+    hits += bvh.raycast(origin, direction, 1000.0f, &item, &distance);
+  }, sQueryCount);
+
+  printf("%zu instances, %zu nodes\n", instanceCount, bvh.get_node_count());
+  printf("  build:            %10.1f us\n", buildTime);
+  printf("  refit 1%% moved:   %10.1f us\n", partialRefitTime);
+  printf("  refit all:        %10.1f us\n", fullRefitTime);
+  printf("  frustum:          %10.1f us (%zu visible)\n",
+         frustumTime, visible.size());
+  printf("  frustum, brute:   %10.1f us (%zu visible)\n",
+         bruteTime, bruteVisible);
+  printf("  sphere query:     %10.2f us\n", sphereTime);
+  printf("  raycast:          %10.2f us (%u hits of %d)\n",
+         rayTime, hits, sQueryCount);
+}
+
+}  // namespace
+
+int main() {
+  for (size_t count : { 10000, 100000, 1000000 }) {
+    run(count);
+  }
+
+  return 0;
+}
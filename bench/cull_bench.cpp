@@ -0,0 +1,60 @@
+// Copyright (c) 2024 Meerkat
+#include "../inc/Culling.h"
+#include "../inc/Frustum.h"
+#include "BenchUtil.h"
+#include <random>
+
+namespace {
+
+const size_t sInstanceCount = 100000;
+const int    sIterations    = 200;
+
+}  // namespace
+
+int main() {
+  // Same camera as the engine, instances spread around it so roughly a
+  // sixth of them survive.
+  glm::mat4 view = glm::lookAt(
+    glm::vec3(-1.0f, 0.0f, 1.0f),
+    glm::vec3(1.0f, 0.0f, 1.0f),
+    glm::vec3(0.0f, 0.0f, 1.0f));
+  glm::mat4 proj =
+    glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+  proj[1][1] *= -1;
+  const std::array<glm::vec4, 6> planes =
+    vkUtil::make_frustum_planes(proj * view);
+
+  std::mt19937 generator(1);
+  std::uniform_real_distribution<float> position(-60.0f, 60.0f);
+  std::uniform_real_distribution<float> radius(0.1f, 2.0f);
+
+  vkUtil::InstanceBounds bounds;
+  bounds.reserve(sInstanceCount);
+  for (size_t i = 0; i < sInstanceCount; ++i) {
+    bounds.push_back(
+      glm::vec3(position(generator), position(generator),
+                position(generator)),
+      radius(generator));
+  }
+
+  std::vector<uint32_t> scalarVisible;
+  std::vector<uint32_t> simdVisible;
+  scalarVisible.reserve(sInstanceCount);
+  simdVisible.reserve(sInstanceCount);
+
+  double scalarTime = bench::time_us([&]() {
+    scalarVisible.clear();
+    vkUtil::cull_spheres_scalar(planes, bounds, &scalarVisible);
+  }, sIterations);
+  double simdTime = bench::time_us([&]() {
+    simdVisible.clear();
+    vkUtil::cull_spheres(planes, bounds, &simdVisible);
+  }, sIterations);
+
+  printf("%zu instances, %zu visible (scalar) %zu visible (simd)\n",
+         sInstanceCount, scalarVisible.size(), simdVisible.size());
+  printf("scalar: %8.1f us\n", scalarTime);
+  printf("simd:   %8.1f us (%.2fx)\n", simdTime, scalarTime / simdTime);
+
+  return scalarVisible == simdVisible ? 0 : 1;
+}
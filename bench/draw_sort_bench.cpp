@@ -0,0 +1,96 @@
+// Copyright (c) 2024 Meerkat
+#include "../inc/DrawPacket.h"
+#include "BenchUtil.h"
+#include <algorithm>
+#include <random>
+
+namespace {
+
+const uint32_t sPipelineCount = 4;
+const uint32_t sMaterialCount = 64;
+const uint32_t sMeshCount     = 32;
+
+// State changes a renderer binding only what differs from the previous
+// packet would record, and the draws left once equal states are merged.
+struct BindCounts {
+  size_t pipelines;
+  size_t materials;
+  size_t draws;
+};
+
+BindCounts count_binds(const std::vector<vkUtil::DrawPacket>& packets) {
+  BindCounts counts {};
+  for (size_t i = 0; i < packets.size(); ++i) {
+    const uint64_t key = packets[i].key;
+    const uint64_t previous = i ? packets[i - 1].key : ~key;
+    counts.pipelines += (key >> vkUtil::sDrawKeyPipelineShift)
+      != (previous >> vkUtil::sDrawKeyPipelineShift);
+    counts.materials += (key >> vkUtil::sDrawKeyMaterialShift)
+      != (previous >> vkUtil::sDrawKeyMaterialShift);
+    counts.draws += vkUtil::get_draw_state(key)
+      != vkUtil::get_draw_state(previous);
+  }
+  return counts;
+}
+
+void print_binds(const char* label, const BindCounts& counts) {
+  printf("  %-10s %8zu pipeline, %8zu material, %8zu draws\n",
+         label, counts.pipelines, counts.materials, counts.draws);
+}
+
+void run(size_t packetCount) {
+  std::mt19937 generator(1);
+  std::uniform_int_distribution<uint32_t> pipeline(0, sPipelineCount - 1);
+  std::uniform_int_distribution<uint32_t> material(0, sMaterialCount - 1);
+  std::uniform_int_distribution<uint32_t> mesh(0, sMeshCount - 1);
+  std::uniform_real_distribution<float> distance(0.0f, 100.0f);
+
+  std::vector<vkUtil::DrawPacket> unsorted(packetCount);
+  for (size_t i = 0; i < packetCount; ++i) {
+    unsorted[i].key = vkUtil::make_draw_key(
+      0,
+      pipeline(generator),
+      material(generator),
+      mesh(generator),
+      vkUtil::make_depth_bucket(distance(generator), 100.0f));
+    unsorted[i].instance = static_cast<uint32_t>(i);
+  }
+
+  std::vector<vkUtil::DrawPacket> radix;
+  std::vector<vkUtil::DrawPacket> scratch;
+  double radixTime = bench::time_us([&]() {
+    radix = unsorted;
+    vkUtil::radix_sort(&radix, &scratch);
+  }, 10);
+
+  std::vector<vkUtil::DrawPacket> reference;
+  double stdTime = bench::time_us([&]() {
+    reference = unsorted;
+    std::stable_sort(reference.begin(), reference.end(),
+      [](const vkUtil::DrawPacket& a, const vkUtil::DrawPacket& b) {
+        return a.key < b.key;
+      });
+  }, 10);
+
+  bool match = std::equal(radix.begin(), radix.end(), reference.begin(),
+    [](const vkUtil::DrawPacket& a, const vkUtil::DrawPacket& b) {
+      return a.key == b.key && a.instance == b.instance;
+    });
+
+  printf("%zu packets\n", packetCount);
+  print_binds("unsorted:", count_binds(unsorted));
+  print_binds("sorted:", count_binds(radix));
+  printf("  radix sort:  %10.1f us\n", radixTime);
+  printf("  stable_sort: %10.1f us (%s)\n",
+         stdTime, match ? "same order" : "MISMATCH");
+}
+
+}  // namespace
+
+int main() {
+  for (size_t count : { 1000, 10000, 100000, 1000000 }) {
+    run(count);
+  }
+
+  return 0;
+}
@@ -0,0 +1,154 @@
+// Copyright (c) 2024 Meerkat
+#include "../inc/SoftwareOcclusion.h"
+#include "../inc/JobPool.h"
+#include "BenchUtil.h"
+#include <algorithm>
+#include <random>
+
+namespace {
+
+const uint32_t sWidth         = 256;
+const uint32_t sHeight        = 144;
+const uint32_t sGroundCells   = 64;
+const uint32_t sWallCount     = 32;
+const size_t   sInstanceCount = 20000;
+const uint32_t sBatch         = 256;
+const int      sIterations    = 100;
+
+// Flat grid at z = 0, the engine's ground.
+vkUtil::OccluderMesh make_ground(float extent) {
+  vkUtil::OccluderMesh mesh;
+  const float step = 2.0f * extent / sGroundCells;
+  for (uint32_t y = 0; y <= sGroundCells; ++y) {
+    for (uint32_t x = 0; x <= sGroundCells; ++x) {
+      mesh.positions.emplace_back(-extent + x * step, -extent + y * step, 0.0f);
+    }
+  }
+  for (uint32_t y = 0; y < sGroundCells; ++y) {
+    for (uint32_t x = 0; x < sGroundCells; ++x) {
+      const Index corner = y * (sGroundCells + 1) + x;
+      const Index above  = corner + sGroundCells + 1;
+      mesh.indices.insert(mesh.indices.end(),
+        { corner, corner + 1, above + 1, corner, above + 1, above });
+    }
+  }
+  return mesh;
+}
+
+// Unit box around the origin.
+vkUtil::OccluderMesh make_box() {
+  vkUtil::OccluderMesh mesh;
+  for (uint32_t corner = 0; corner < 8; ++corner) {
+    mesh.positions.emplace_back(
+      corner & 1 ? 0.5f : -0.5f,
+      corner & 2 ? 0.5f : -0.5f,
+      corner & 4 ? 0.5f : -0.5f);
+  }
+  mesh.indices = {
+    0, 2, 3, 0, 3, 1,  4, 5, 7, 4, 7, 6,
+    0, 1, 5, 0, 5, 4,  2, 6, 7, 2, 7, 3,
+    0, 4, 6, 0, 6, 2,  1, 3, 7, 1, 7, 5,
+  };
+  return mesh;
+}
+
+glm::mat4 make_wall(const glm::vec3& position, const glm::vec3& size) {
+  glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+  return glm::scale(model, size);
+}
+
+}  // namespace
+
+int main() {
+  // Same camera as the engine, looking down +x over the ground.
+  glm::mat4 view = glm::lookAt(
+    glm::vec3(-1.0f, 0.0f, 1.0f),
+    glm::vec3(1.0f, 0.0f, 1.0f),
+    glm::vec3(0.0f, 0.0f, 1.0f));
+  glm::mat4 proj =
+    glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+  proj[1][1] *= -1;
+  const glm::mat4 viewProjection = proj * view;
+
+  std::mt19937 generator(1);
+  std::uniform_real_distribution<float> distance(2.0f, 60.0f);
+  std::uniform_real_distribution<float> side(-30.0f, 30.0f);
+  std::uniform_real_distribution<float> height(-4.0f, 4.0f);
+  std::uniform_real_distribution<float> radius(0.1f, 1.0f);
+
+  const vkUtil::OccluderMesh ground = make_ground(100.0f);
+  const vkUtil::OccluderMesh box = make_box();
+  std::vector<glm::mat4> walls;
+  for (uint32_t i = 0; i < sWallCount; ++i) {
+    walls.push_back(make_wall(
+      glm::vec3(distance(generator), side(generator), 1.0f),
+      glm::vec3(0.5f, 4.0f, 2.0f)));
+  }
+
+  std::vector<glm::vec4> spheres;
+  for (size_t i = 0; i < sInstanceCount; ++i) {
+    spheres.emplace_back(
+      distance(generator), side(generator), height(generator),
+      radius(generator));
+  }
+
+  vkUtil::JobPool jobPool;
+  jobPool.init(std::clamp(std::thread::hardware_concurrency(), 1u, 8u));
+
+  vkUtil::OcclusionBuffer buffer;
+  buffer.resize(sWidth, sHeight);
+
+  double setupTime = bench::time_us([&]() {
+    buffer.begin(viewProjection);
+    buffer.add_occluder(ground, glm::mat4(1.0f));
+    for (const glm::mat4& wall : walls) {
+      buffer.add_occluder(box, wall);
+    }
+  }, sIterations);
+
+  double serialRasterTime = bench::time_us([&]() {
+    for (uint32_t band = 0; band < buffer.get_band_count(); ++band) {
+      buffer.rasterize(band);
+    }
+  }, sIterations);
+  double poolRasterTime = bench::time_us([&]() {
+    jobPool.dispatch(
+      buffer.get_band_count(),
+      [&](uint32_t band) { buffer.rasterize(band); });
+  }, sIterations);
+
+  const uint32_t count = static_cast<uint32_t>(spheres.size());
+  std::vector<uint8_t> serialOccluded(count);
+  std::vector<uint8_t> poolOccluded(count);
+  double serialTestTime = bench::time_us([&]() {
+    for (uint32_t i = 0; i < count; ++i) {
+      serialOccluded[i] = buffer.is_occluded(spheres[i]);
+    }
+  }, sIterations);
+  double poolTestTime = bench::time_us([&]() {
+    jobPool.dispatch((count + sBatch - 1) / sBatch, [&](uint32_t job) {
+      const uint32_t last = std::min(count, (job + 1) * sBatch);
+      for (uint32_t i = job * sBatch; i < last; ++i) {
+        poolOccluded[i] = buffer.is_occluded(spheres[i]);
+      }
+    });
+  }, sIterations);
+
+  const size_t occluded =
+    std::count(serialOccluded.begin(), serialOccluded.end(), 1);
+  printf("%ux%u buffer, %zu triangles on %u bands, %u workers\n",
+         buffer.get_width(), buffer.get_height(), buffer.get_triangle_count(),
+         buffer.get_band_count(), jobPool.get_worker_count());
+  printf("%u instances, %zu occluded\n", count, occluded);
+  printf("setup:            %8.1f us\n", setupTime);
+  printf("rasterize serial: %8.1f us\n", serialRasterTime);
+  printf("rasterize pool:   %8.1f us\n", poolRasterTime);
+  printf("test serial:      %8.1f us\n", serialTestTime);
+  printf("test pool:        %8.1f us\n", poolTestTime);
+  printf("frame (pool):     %8.1f us\n",
+         setupTime + poolRasterTime + poolTestTime);
+
+  jobPool.destroy();
+
+  return serialOccluded == poolOccluded ? 0 : 1;
+}
@@ -0,0 +1,265 @@
+// Copyright (c) 2024 Meerkat
+#include "../inc/Instance.h"
+#include "../inc/Device.h"
+#include "../inc/Descriptors.h"
+#include "../inc/DrawGroup.h"
+#include "../inc/DrawPacket.h"
+#include "../inc/JobPool.h"
+#include "../inc/Memory.h"
+#include "../inc/Mesh.h"
+#include "../inc/Pipeline.h"
+#include "../inc/RenderStructs.h"
+#include "BenchUtil.h"
+#include <algorithm>
+#include <random>
+#include <thread>
+
+// Times the CPU path of Engine::record_draw_commands on a large scene: the
+// sorted draw packets are merged into draw groups, split in one chunk per
+// job and recorded into per job secondary command buffers, for every worker
+// count up to the core count. Nothing is submitted, only recording is timed.
+// Needs a Vulkan device and the compiled shaders in ./bin/shaders.
+
+namespace {
+
+// The stress scene's instance count. Materials and meshes are spread so
+// few neighbours share a state and most instances end up in their own
+// group, the worst case for recording.
+const size_t   sInstanceCount = 250000;
+const uint32_t sMaterialCount = 1024;
+const uint32_t sMeshCount     = 32;
+const uint32_t sIndexCount    = 36;
+const int      sIterations    = 20;
+
+// What every job records with, and its pool and secondary buffer per job.
+struct Recorder {
+  vk::Device                             device;
+  vk::RenderPass                         renderPass;
+  vkUtil::DrawBindings                   bindings;
+  std::vector<vkUtil::MeshRecord>        meshes;
+  std::vector<vkUtil::DrawPushConstants> materials;
+  std::vector<vkUtil::DrawGroup>         groups;
+  std::vector<vk::CommandPool>           pools;
+  std::vector<vk::CommandBuffer>         commandBuffers;
+};
+
+// The part of Engine::record_viewport the secondaries need.
+void record_viewport(vk::CommandBuffer commandBuffer) {
+  vk::Viewport viewport {};
+  viewport.width    = 1920.0f;
+  viewport.height   = 1080.0f;
+  viewport.maxDepth = 1.0f;
+  vk::Rect2D scissor {};
+  scissor.extent = vk::Extent2D{ 1920, 1080 };
+  commandBuffer.setViewport(0, viewport);
+  commandBuffer.setScissor(0, scissor);
+}
+
+// One frame of the CPU path with jobCount jobs, returns the group count.
+size_t record_frame(
+  Recorder* recorder,
+  vkUtil::JobPool* jobPool,
+  uint32_t jobCount,
+  const std::vector<vkUtil::DrawPacket>& packets
+) {
+  vkUtil::make_draw_groups(
+    packets, recorder->meshes, recorder->materials, &recorder->groups);
+  const std::vector<vkUtil::DrawGroup>& groups = recorder->groups;
+
+  vk::CommandBufferInheritanceInfo inheritanceInfo {};
+  inheritanceInfo.renderPass = recorder->renderPass;
+  inheritanceInfo.subpass    = 0;
+
+  jobPool->dispatch(jobCount, [&](uint32_t job) {
+    const size_t first = groups.size() * job / jobCount;
+    const size_t last  = groups.size() * (job + 1) / jobCount;
+
+    recorder->device.resetCommandPool(recorder->pools[job]);
+
+    vk::CommandBufferBeginInfo beginInfo {};
+    beginInfo.flags = vk::CommandBufferUsageFlagBits::eRenderPassContinue
+      | vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    vk::CommandBuffer secondary = recorder->commandBuffers[job];
+    secondary.begin(beginInfo);
+    record_viewport(secondary);
+    vkUtil::record_draw_groups(
+      secondary, recorder->bindings, groups, first, last);
+    secondary.end();
+  });
+
+  return groups.size();
+}
+
+vk::Format find_depth_format(vk::PhysicalDevice physicalDevice) {
+  for (vk::Format format : { vk::Format::eD32Sfloat,
+                             vk::Format::eD24UnormS8Uint }) {
+    const vk::FormatProperties properties =
+      physicalDevice.getFormatProperties(format);
+    if (properties.optimalTilingFeatures
+        & vk::FormatFeatureFlagBits::eDepthStencilAttachment) {
+      return format;
+    }
+  }
+  return vk::Format::eD16Unorm;
+}
+
+}  // namespace
+
+int main() {
+  // A hidden window only to get a surface for the engine's device helpers.
+  glfwInit();
+  glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  GLFWwindow* window = glfwCreateWindow(64, 64, "record_bench", nullptr,
+                                        nullptr);
+
+  vk::Instance instance = vkInit::make_instance(false, "record_bench");
+  VkSurfaceKHR cSurface;
+  if (glfwCreateWindowSurface(instance, window, nullptr, &cSurface)
+      != VK_SUCCESS) {
+    printf("Failed to create a surface.\n");
+    return 1;
+  }
+  vk::SurfaceKHR surface = cSurface;
+  vk::PhysicalDevice physicalDevice =
+    vkInit::choose_physical_device(instance, false);
+  vk::Device device =
+    vkInit::create_logical_device(physicalDevice, surface, false);
+  const uint32_t queueFamily = vkUtil::findQueueFamilies(
+    physicalDevice, surface, false).graphicsFamily.value();
+
+  // Frame set of the depth prepass: camera, object data and visible
+  // instances.
+  vkInit::DescriptorSetLayoutData bindings {};
+  bindings.count   = 3;
+  bindings.indices = { 0, 1, 2 };
+  bindings.types   = { vk::DescriptorType::eUniformBuffer,
+                       vk::DescriptorType::eStorageBuffer,
+                       vk::DescriptorType::eStorageBuffer };
+  bindings.counts  = { 1, 1, 1 };
+  bindings.stages  = { vk::ShaderStageFlagBits::eVertex,
+                       vk::ShaderStageFlagBits::eVertex,
+                       vk::ShaderStageFlagBits::eVertex };
+  vk::DescriptorSetLayout setLayout =
+    vkInit::make_descriptor_set_layout(device, bindings, false);
+  vk::DescriptorPool descriptorPool =
+    vkInit::make_descriptor_pool(device, 1, bindings, false);
+
+  vkInit::PipelineBuilder pipelineBuilder {};
+  pipelineBuilder.init(device, nullptr, false);
+  pipelineBuilder.set_overwrite_mode(false);
+  pipelineBuilder.specify_vertex_format(
+    vkMesh::getPositionBindingDescription(),
+    vkMesh::getPositionAttributeDescriptions()
+  );
+  pipelineBuilder.specify_vertex_shader("./bin/shaders/depth.vert.spv");
+  pipelineBuilder.add_color_attachment(vk::Format::eB8G8R8A8Unorm, 0);
+  pipelineBuilder.specify_depth_attachment(
+    find_depth_format(physicalDevice), 1);
+  pipelineBuilder.set_color_write_mask(vk::ColorComponentFlags());
+  pipelineBuilder.add_descriptor_set_layout(setLayout);
+  pipelineBuilder.add_push_constant_range(
+    vk::ShaderStageFlagBits::eVertex,
+    0,
+    sizeof(vkUtil::DrawPushConstants)
+  );
+  vkInit::GraphicsPipelineOutBundle pipeline = pipelineBuilder.build();
+
+  // Positions then indices of every mesh, only bound, never read.
+  vkUtil::BufferInputChunk bufferInput {};
+  bufferInput.size             =
+    sMeshCount * sIndexCount * (sizeof(uint32_t) + 3 * sizeof(float));
+  bufferInput.usage            = vk::BufferUsageFlagBits::eVertexBuffer
+    | vk::BufferUsageFlagBits::eIndexBuffer;
+  bufferInput.device           = device;
+  bufferInput.physicalDevice   = physicalDevice;
+  bufferInput.memoryProperties = vk::MemoryPropertyFlagBits::eDeviceLocal;
+  vkUtil::Buffer meshBuffer = vkUtil::createBuffer(bufferInput);
+
+  Recorder recorder {};
+  recorder.device                  = device;
+  recorder.renderPass              = pipeline.renderPass;
+  recorder.bindings.layout         = pipeline.pipelineLayout;
+  recorder.bindings.pipeline       = pipeline.graphicsPipeline;
+  recorder.bindings.descriptorSets = { vkInit::allocate_descriptor_set(
+    device, descriptorPool, setLayout, false) };
+  recorder.bindings.vertexBuffer   = meshBuffer.buffer;
+  recorder.bindings.indexBuffer    = meshBuffer.buffer;
+  recorder.bindings.indexOffset    =
+    sMeshCount * sIndexCount * 3 * sizeof(float);
+  for (uint32_t i = 0; i < sMeshCount; ++i) {
+    recorder.meshes.push_back({ sIndexCount, i * sIndexCount });
+  }
+  recorder.materials.resize(sMaterialCount);
+  for (uint32_t i = 0; i < sMaterialCount; ++i) {
+    recorder.materials[i].material = i;
+  }
+
+  const uint32_t coreCount =
+    std::max(1u, std::thread::hardware_concurrency());
+  for (uint32_t job = 0; job < coreCount; ++job) {
+    vk::CommandPoolCreateInfo poolInfo {};
+    poolInfo.queueFamilyIndex = queueFamily;
+    recorder.pools.push_back(device.createCommandPool(poolInfo));
+
+    vk::CommandBufferAllocateInfo allocInfo {};
+    allocInfo.commandPool        = recorder.pools.back();
+    allocInfo.level              = vk::CommandBufferLevel::eSecondary;
+    allocInfo.commandBufferCount = 1;
+    recorder.commandBuffers.push_back(
+      device.allocateCommandBuffers(allocInfo)[0]);
+  }
+
+  // Sorted as prepare_frame leaves them.
+  std::mt19937 generator(1);
+  std::uniform_int_distribution<uint32_t> material(0, sMaterialCount - 1);
+  std::uniform_int_distribution<uint32_t> mesh(0, sMeshCount - 1);
+  std::vector<vkUtil::DrawPacket> packets(sInstanceCount);
+  for (size_t i = 0; i < sInstanceCount; ++i) {
+    packets[i].key = vkUtil::make_draw_key(
+      0, 0, material(generator), mesh(generator), 0);
+    packets[i].instance = static_cast<uint32_t>(i);
+  }
+  std::vector<vkUtil::DrawPacket> scratch;
+  vkUtil::radix_sort(&packets, &scratch);
+
+  printf("%zu instances\n", sInstanceCount);
+  double serialTime = 0.0;
+  for (uint32_t workers = 1; workers <= coreCount; ++workers) {
+    vkUtil::JobPool jobPool;
+    jobPool.init(workers);
+
+    size_t groupCount = 0;
+    double time = bench::time_us([&]() {
+      groupCount = record_frame(&recorder, &jobPool, workers, packets);
+    });
+    if (workers == 1) {
+      serialTime = time;
+      printf("%zu draw groups\n", groupCount);
+    }
+    printf("  %2u workers: %10.1f us, %5.2fx\n",
+           workers, time, serialTime / time);
+
+    jobPool.destroy();
+  }
+
+  for (vk::CommandPool pool : recorder.pools) {
+    device.destroyCommandPool(pool);
+  }
+  device.destroyBuffer(meshBuffer.buffer);
+  device.freeMemory(meshBuffer.bufferMemory);
+  device.destroyPipeline(pipeline.graphicsPipeline);
+  device.destroyPipelineLayout(pipeline.pipelineLayout);
+  device.destroyRenderPass(pipeline.renderPass);
+  device.destroyDescriptorPool(descriptorPool);
+  device.destroyDescriptorSetLayout(setLayout);
+  device.destroy();
+  instance.destroySurfaceKHR(surface);
+  instance.destroy();
+  glfwDestroyWindow(window);
+  glfwTerminate();
+
+  return 0;
+}
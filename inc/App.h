@@ -8,12 +8,20 @@
 
 class App {
  public:
-  App(uint32_t width, uint32_t height, bool debugMode);
+  // textureBudget is the device memory, in bytes, streamed material
+  // textures may occupy.
+  App(
+    uint32_t width,
+    uint32_t height,
+    bool debugMode,
+    size_t textureBudget = Engine::sDefaultTextureBudget
+  );
   ~App();
   void run();
 
  private:
   void build_glfw_window(uint32_t width, uint32_t height, bool debugMode);
+  void handle_input();
   void calculate_frame_rate();
 
   Engine*     mGraphicsEngine = nullptr;
@@ -24,6 +32,7 @@ class App {
   double      mCurrentTime = 0.0;
   int32_t     mNumFrames   = 0;
   float       mFrameTime   = 0.0f;
+  bool        mPrepassKeyDown = false;
 };
 
 #endif  // INC_APP_H_
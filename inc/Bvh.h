@@ -0,0 +1,83 @@
+// Copyright (c) 2024 Meerkat
+#ifndef INC_BVH_H_
+#define INC_BVH_H_
+
+#include "CommonMath.h"
+#include <array>
+#include <vector>
+
+namespace vkUtil {
+
+// Bounding volume hierarchy over bounding spheres (center in xyz, radius in
+// w). Nodes hold axis aligned boxes and are built with binned SAH; items are
+// kept in leaf order so traversal reads them contiguously.
+class Bvh {
+ public:
+  void build(const std::vector<glm::vec4>& spheres);
+  // Updates the boxes after items moved without changing the tree shape.
+  // Only the ancestors of the moved items are refit, unless so many moved
+  // that one bottom up pass is cheaper.
+  void refit(
+    const std::vector<glm::vec4>& spheres,
+    const std::vector<uint32_t>& moved
+  );
+  void refit(const std::vector<glm::vec4>& spheres);
+  void clear();
+
+  // Appends the items at least partly inside the frustum, planes come from
+  // make_frustum_planes. Items of leaves crossing a plane go through
+  // cull_spheres and follow those fully inside. Order follows the tree, not
+  // the item indices.
+  void query_frustum(
+    const std::array<glm::vec4, 6>& planes,
+    std::vector<uint32_t>* items
+  ) const;
+  // Appends the items overlapping the sphere.
+  void query_sphere(
+    const glm::vec3& center,
+    float radius,
+    std::vector<uint32_t>* items
+  ) const;
+  // Closest item whose sphere the ray enters within maxDistance. direction
+  // must be normalized.
+  bool raycast(
+    const glm::vec3& origin,
+    const glm::vec3& direction,
+    float maxDistance,
+    uint32_t* item,
+    float* distance
+  ) const;
+
+  size_t get_node_count() const;
+  size_t size() const;
+
+ private:
+  // Leaves have count > 0 and hold items [first, first + count), inner
+  // nodes have count == 0 and children first and first + 1.
+  struct Node {
+    glm::vec3 min;
+    uint32_t  first;
+    glm::vec3 max;
+    uint32_t  count;
+  };
+
+  // Splits the node at the best SAH bin, returns false if it stays a leaf.
+  bool subdivide(uint32_t node);
+  void fit_leaf(uint32_t node);
+  void fit_inner(uint32_t node);
+  void append_subtree(uint32_t node, std::vector<uint32_t>* items) const;
+
+ private:
+  std::vector<Node>      mNodes;
+  std::vector<uint32_t>  mParents;
+  // Leaf order: sphere and original index of each item.
+  std::vector<glm::vec4> mItemSpheres;
+  std::vector<uint32_t>  mItemIndex;
+  // Position of each original item in the leaf order, and its leaf.
+  std::vector<uint32_t>  mItemSlot;
+  std::vector<uint32_t>  mItemLeaf;
+};
+
+}  // namespace vkUtil
+
+#endif  // INC_BVH_H_
@@ -3,7 +3,7 @@
 #define INC_COMMANDS_H_
 
 #include "Common.h"
-#include "Frame.h"
+#include "FrameContext.h"
 #include "QueueFamilies.h"
 #include <vector>
 
@@ -12,7 +12,7 @@ namespace vkInit {
 struct CommandBufferInputChunk {
   vk::Device device;
   vk::CommandPool commandPool;
-  std::vector<vkUtil::SwapChainFrame>* frames;
+  std::vector<vkUtil::FrameContext>* frames;
 };
 
 inline vk::CommandPool make_command_pool(
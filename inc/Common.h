@@ -2,15 +2,9 @@
 #ifndef INC_COMMON_H_
 #define INC_COMMON_H_
 
-#include <stdio.h>
-#include <stdint.h>
+#include "CommonMath.h"
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 #include <vulkan/vulkan.hpp>
-#define GLM_FORCE_DEPTH_ZERO_TO_ONE
-#include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
-
-typedef uint32_t Index;
 
 #endif  // INC_COMMON_H_
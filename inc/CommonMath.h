@@ -0,0 +1,15 @@
+// Copyright (c) 2024 Meerkat
+#ifndef INC_COMMONMATH_H_
+#define INC_COMMONMATH_H_
+
+// The part of Common.h that does not need Vulkan or GLFW, for the CPU side
+// units the benchmarks build on their own.
+#include <stdio.h>
+#include <stdint.h>
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+typedef uint32_t Index;
+
+#endif  // INC_COMMONMATH_H_
@@ -5,14 +5,17 @@
 
 namespace vkImage {
 
+class TextureRegistry;
+class SamplerCache;
+
 struct CubeMapInputChunk {
   vk::Device               device;
   vk::PhysicalDevice       physicalDevice;
   std::vector<const char*> filenames;
   vk::CommandBuffer        commandBuffer;
   vk::Queue                queue;
-  vk::DescriptorSetLayout  layout;
-  vk::DescriptorPool       descriptorPool;
+  TextureRegistry*         registry;
+  SamplerCache*            samplerCache;
 };
 
 class CubeMap {
@@ -22,14 +25,13 @@ class CubeMap {
   ~CubeMap();
 
   void init(const CubeMapInputChunk& input);
-  void use(vk::CommandBuffer commandBuffer, vk::PipelineLayout pipelineLayout);
 
  private:
   void load();
   void populate();
   void make_view();
   void make_sampler();
-  void make_descriptor_set();
+  void register_environment();
 
  private:
   using stbi_uc = unsigned char;
@@ -46,11 +48,10 @@ class CubeMap {
   vk::DeviceMemory         mImageMemory;
   vk::ImageView            mImageView;
   vk::Sampler              mSampler;
+  SamplerCache*            mSamplerCache = nullptr;
 
   // Resource descriptors
-  vk::DescriptorSetLayout  mLayout;
-  vk::DescriptorSet        mDescriptorSet;
-  vk::DescriptorPool       mDescriptorPool;
+  TextureRegistry*         mRegistry = nullptr;
 
   vk::CommandBuffer        mCommandBuffer;
   vk::Queue                mQueue;
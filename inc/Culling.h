@@ -0,0 +1,53 @@
+// Copyright (c) 2024 Meerkat
+#ifndef INC_CULLING_H_
+#define INC_CULLING_H_
+
+#include "CommonMath.h"
+#include <array>
+#include <vector>
+
+namespace vkUtil {
+
+// World space bounding spheres of a set of instances, stored as structure of
+// arrays so the frustum test loads eight of them per iteration. The arrays
+// are padded to a multiple of eight, padding lanes are masked off by size().
+class InstanceBounds {
+ public:
+  void clear();
+  void reserve(size_t count);
+  void push_back(const glm::vec3& center, float radius);
+
+  size_t size() const;
+  const float* x() const;
+  const float* y() const;
+  const float* z() const;
+  const float* radius() const;
+
+ private:
+  std::vector<float> mX;
+  std::vector<float> mY;
+  std::vector<float> mZ;
+  std::vector<float> mRadius;
+  size_t             mCount = 0;
+};
+
+// Appends to visible the indices of the spheres at least partly inside the
+// frustum, in increasing order. planes come from make_frustum_planes.
+void cull_spheres_scalar(
+  const std::array<glm::vec4, 6>& planes,
+  const InstanceBounds& bounds,
+  std::vector<uint32_t>* visible
+);
+
+// Same as cull_spheres_scalar, eight spheres per iteration with the widest
+// vector unit available: AVX2 when the CPU reports it, otherwise SSE2 on
+// x86 and NEON on ARM.
+void cull_spheres(
+  const std::array<glm::vec4, 6>& planes,
+  const InstanceBounds& bounds,
+  std::vector<uint32_t>* visible
+);
+
+}  // namespace vkUtil
+
+#endif  // INC_CULLING_H_
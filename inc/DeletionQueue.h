@@ -0,0 +1,40 @@
+// Copyright (c) 2024 Meerkat
+#ifndef INC_DELETIONQUEUE_H_
+#define INC_DELETIONQUEUE_H_
+
+#include "Common.h"
+#include <deque>
+#include <functional>
+
+namespace vkUtil {
+
+// Defers the destruction of resources that frames still in flight may be
+// using. Deleters pushed during a frame run once that frame can no longer be
+// executing on the device.
+class DeletionQueue {
+ public:
+  DeletionQueue();
+  ~DeletionQueue();
+
+  void push(std::function<void()>&& deleter);
+
+  // Called once per submitted frame, after waiting on the fence of the frame
+  // slot that is about to be reused and acquiring its image.
+  void advance(uint32_t framesInFlight);
+
+  // Runs every pending deleter. The device must be idle.
+  void flush();
+
+ private:
+  struct Entry {
+    uint64_t              frame;
+    std::function<void()> deleter;
+  };
+
+  std::deque<Entry> mEntries;
+  uint64_t          mFrame = 0;
+};
+
+}  // namespace vkUtil
+
+#endif  // INC_DELETIONQUEUE_H_
@@ -0,0 +1,56 @@
+// Copyright (c) 2024 Meerkat
+#ifndef INC_DESCRIPTORALLOCATOR_H_
+#define INC_DESCRIPTORALLOCATOR_H_
+
+#include "Common.h"
+#include "Descriptors.h"
+#include <utility>
+#include <vector>
+
+namespace vkUtil {
+
+struct DescriptorAllocatorInputChunk {
+  vk::Device device;
+  // Sets per pool for the first pool, later pools double it up to
+  // maxSetsPerPool.
+  uint32_t   setsPerPool;
+  uint32_t   maxSetsPerPool;
+  // Descriptors of each type reserved per set.
+  std::vector<std::pair<vk::DescriptorType, float>> poolRatios;
+};
+
+// Hands out descriptor sets from a chain of pools. A new, larger pool is
+// started whenever the current one runs out, so allocation does not fail on
+// exhaustion. reset recycles every pool at once.
+class DescriptorAllocator {
+ public:
+  DescriptorAllocator();
+  ~DescriptorAllocator();
+
+  void init(const DescriptorAllocatorInputChunk& input, bool debug);
+  void destroy();
+
+  vk::DescriptorSet allocate(vk::DescriptorSetLayout layout);
+
+  // Returns every set allocated so far to the pools. None of them may still
+  // be in use by the device.
+  void reset();
+
+ private:
+  vk::DescriptorPool grab_pool();
+
+ private:
+  bool                            mHasDebug = false;
+  vk::Device                      mDevice;
+  uint32_t                        mSetsPerPool    = 0;
+  uint32_t                        mMaxSetsPerPool = 0;
+  std::vector<std::pair<vk::DescriptorType, float>> mPoolRatios;
+
+  vk::DescriptorPool              mCurrentPool;
+  std::vector<vk::DescriptorPool> mUsedPools;
+  std::vector<vk::DescriptorPool> mFreePools;
+};
+
+}  // namespace vkUtil
+
+#endif  // INC_DESCRIPTORALLOCATOR_H_
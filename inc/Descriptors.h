@@ -8,11 +8,14 @@
 namespace vkInit {
 
 struct DescriptorSetLayoutData {
-  uint32_t                          count;
-  std::vector<uint32_t>             indices;
-  std::vector<vk::DescriptorType>   types;
-  std::vector<uint32_t>             counts;
-  std::vector<vk::ShaderStageFlags> stages;
+  uint32_t                                count;
+  std::vector<uint32_t>                   indices;
+  std::vector<vk::DescriptorType>         types;
+  std::vector<uint32_t>                   counts;
+  std::vector<vk::ShaderStageFlags>       stages;
+  // Optional, one entry per binding when present.
+  std::vector<vk::DescriptorBindingFlags> bindingFlags;
+  vk::DescriptorSetLayoutCreateFlags      layoutFlags;
 };
 
 inline vk::DescriptorSetLayout make_descriptor_set_layout(
@@ -32,10 +35,17 @@ inline vk::DescriptorSetLayout make_descriptor_set_layout(
   }
 
   vk::DescriptorSetLayoutCreateInfo layoutInfo {};
-  layoutInfo.flags        = vk::DescriptorSetLayoutCreateFlagBits();
+  layoutInfo.flags        = bindings.layoutFlags;
   layoutInfo.bindingCount = bindings.count;
   layoutInfo.pBindings    = layoutBindings.data();
 
+  vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo {};
+  if (!bindings.bindingFlags.empty()) {
+    bindingFlagsInfo.bindingCount  = bindings.count;
+    bindingFlagsInfo.pBindingFlags = bindings.bindingFlags.data();
+    layoutInfo.pNext = &bindingFlagsInfo;
+  }
+
   vk::DescriptorSetLayout res {};
   try {
     res = device.createDescriptorSetLayout(layoutInfo);
@@ -53,19 +63,25 @@ inline vk::DescriptorPool make_descriptor_pool(
   vk::Device device,
   uint32_t size,
   const DescriptorSetLayoutData& bindings,
-  bool debug) {
+  bool debug,
+  vk::DescriptorPoolCreateFlags flags = vk::DescriptorPoolCreateFlags()) {
   std::vector<vk::DescriptorPoolSize> poolSizes {};
 
   for (uint32_t i = 0; i < bindings.count; ++i) {
+    uint32_t descriptorsPerSet = 1;
+    if (i < bindings.counts.size()) {
+      descriptorsPerSet = bindings.counts[i];
+    }
+
     vk::DescriptorPoolSize poolSize {};
     poolSize.type            = bindings.types[i];
-    poolSize.descriptorCount = size;
+    poolSize.descriptorCount = size * descriptorsPerSet;
 
     poolSizes.push_back(poolSize);
   }
 
   vk::DescriptorPoolCreateInfo poolInfo {};
-  poolInfo.flags         = vk::DescriptorPoolCreateFlags();
+  poolInfo.flags         = flags;
   poolInfo.maxSets       = size;
   poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
   poolInfo.pPoolSizes    = poolSizes.data();
@@ -83,6 +99,58 @@ inline vk::DescriptorPool make_descriptor_pool(
   return res;
 }
 
+// Template writing every binding of a set from one block of descriptor infos.
+// offsets holds, per binding, where its infos start in the block.
+inline vk::DescriptorUpdateTemplate make_descriptor_update_template(
+  vk::Device device,
+  vk::DescriptorSetLayout layout,
+  const DescriptorSetLayoutData& bindings,
+  const std::vector<size_t>& offsets,
+  bool debug) {
+  std::vector<vk::DescriptorUpdateTemplateEntry> entries {};
+  entries.reserve(bindings.count);
+
+  for (uint32_t i = 0; i < bindings.count; ++i) {
+    bool isImage =
+      bindings.types[i] == vk::DescriptorType::eCombinedImageSampler
+      || bindings.types[i] == vk::DescriptorType::eSampledImage
+      || bindings.types[i] == vk::DescriptorType::eStorageImage
+      || bindings.types[i] == vk::DescriptorType::eSampler;
+
+    vk::DescriptorUpdateTemplateEntry entry {};
+    entry.dstBinding      = bindings.indices[i];
+    entry.dstArrayElement = 0;
+    entry.descriptorCount = bindings.counts[i];
+    entry.descriptorType  = bindings.types[i];
+    entry.offset          = offsets[i];
+    entry.stride          = isImage
+      ? sizeof(vk::DescriptorImageInfo)
+      : sizeof(vk::DescriptorBufferInfo);
+
+    entries.push_back(entry);
+  }
+
+  vk::DescriptorUpdateTemplateCreateInfo templateInfo {};
+  templateInfo.descriptorUpdateEntryCount =
+    static_cast<uint32_t>(entries.size());
+  templateInfo.pDescriptorUpdateEntries = entries.data();
+  templateInfo.templateType =
+    vk::DescriptorUpdateTemplateType::eDescriptorSet;
+  templateInfo.descriptorSetLayout = layout;
+
+  vk::DescriptorUpdateTemplate res {};
+  try {
+    res = device.createDescriptorUpdateTemplate(templateInfo);
+  } catch (vk::SystemError err) {
+    if (debug) {
+      printf("Error while creating descriptor update template. Error: %s\n",
+             err.what());
+    }
+  }
+
+  return res;
+}
+
 inline vk::DescriptorSet allocate_descriptor_set(
   vk::Device device,
   vk::DescriptorPool descriptorPool,
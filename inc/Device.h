@@ -42,6 +42,57 @@ inline bool checkDeviceExtensionSupport(
   return true;
 }
 
+inline vk::PhysicalDeviceVulkan12Features required_vulkan12_features() {
+  vk::PhysicalDeviceVulkan12Features features {};
+  // Bindless texture array.
+  features.descriptorIndexing                           = VK_TRUE;
+  features.runtimeDescriptorArray                       = VK_TRUE;
+  features.descriptorBindingPartiallyBound              = VK_TRUE;
+  features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+  features.descriptorBindingUpdateUnusedWhilePending    = VK_TRUE;
+  features.shaderSampledImageArrayNonUniformIndexing    = VK_TRUE;
+
+  return features;
+}
+
+inline bool checkVulkan12FeatureSupport(
+  const vk::PhysicalDevice& device,
+  bool debug) {
+  if (device.getProperties().apiVersion < VK_API_VERSION_1_2) {
+    if (debug) {
+      printf("Device does not support Vulkan 1.2\n");
+    }
+    return false;
+  }
+
+  vk::PhysicalDeviceVulkan12Features supported {};
+  vk::PhysicalDeviceFeatures2 features {};
+  features.pNext = &supported;
+  device.getFeatures2(&features);
+
+  const vk::PhysicalDeviceVulkan12Features required =
+    required_vulkan12_features();
+
+  bool found =
+    (!required.descriptorIndexing || supported.descriptorIndexing)
+    && (!required.runtimeDescriptorArray || supported.runtimeDescriptorArray)
+    && (!required.descriptorBindingPartiallyBound
+        || supported.descriptorBindingPartiallyBound)
+    && (!required.descriptorBindingSampledImageUpdateAfterBind
+        || supported.descriptorBindingSampledImageUpdateAfterBind)
+    && (!required.descriptorBindingUpdateUnusedWhilePending
+        || supported.descriptorBindingUpdateUnusedWhilePending)
+    && (!required.shaderSampledImageArrayNonUniformIndexing
+        || supported.shaderSampledImageArrayNonUniformIndexing);
+
+  if (debug) {
+    printf("Device %s the required Vulkan 1.2 features\n",
+           found ? "supports" : "does not support");
+  }
+
+  return found;
+}
+
 inline bool isSuitable(const vk::PhysicalDevice& device, bool debug) {
   if (debug) {
     printf("Checking if device is suitable.\n");
@@ -61,7 +112,7 @@ inline bool isSuitable(const vk::PhysicalDevice& device, bool debug) {
   bool extensionSupported =
     checkDeviceExtensionSupport(device, requestedExtensions, debug);
 
-  return extensionSupported;
+  return extensionSupported && checkVulkan12FeatureSupport(device, debug);
 }
 
 inline vk::PhysicalDevice choose_physical_device(
@@ -121,6 +172,8 @@ inline vk::Device create_logical_device(
   };
 
   vk::PhysicalDeviceFeatures deviceFeatures = vk::PhysicalDeviceFeatures();
+  vk::PhysicalDeviceVulkan12Features vulkan12Features =
+    required_vulkan12_features();
 
   std::vector<const char*> enabledLayers;
   if (debug) {
@@ -133,6 +186,7 @@ inline vk::Device create_logical_device(
     enabledLayers.size(), enabledLayers.data(),
     deviceExtensions.size(), deviceExtensions.data(),
     &deviceFeatures);
+  deviceInfo.pNext = &vulkan12Features;
 
   vk::Device device = nullptr;
   try {
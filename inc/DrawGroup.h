@@ -0,0 +1,64 @@
+// Copyright (c) 2024 Meerkat
+#ifndef INC_DRAWGROUP_H_
+#define INC_DRAWGROUP_H_
+
+#include "Common.h"
+#include "DrawPacket.h"
+#include "RenderStructs.h"
+#include <vector>
+
+namespace vkUtil {
+
+// One instanced draw over a run of sorted packets sharing their draw state,
+// starting at the run's first ObjectData record.
+struct DrawGroup {
+  uint32_t          firstIndex;
+  uint32_t          indexCount;
+  uint32_t          firstInstance;
+  uint32_t          instanceCount;
+  DrawPushConstants draw;
+};
+
+// State bound once before a job's groups. Descriptor sets are bound from
+// set 0, vertexBuffer to binding 0.
+struct DrawBindings {
+  vk::PipelineLayout             layout;
+  vk::Pipeline                   pipeline;
+  std::vector<vk::DescriptorSet> descriptorSets;
+  vk::Buffer                     vertexBuffer;
+  vk::Buffer                     indexBuffer;
+  vk::DeviceSize                 indexOffset = 0;
+};
+
+// State changes recorded for a range of groups.
+struct DrawStats {
+  uint32_t pipelineBinds;
+  uint32_t descriptorBinds;
+  uint32_t pushConstants;
+  uint32_t draws;
+};
+
+// Merges runs of sorted packets sharing their draw state into groups.
+// meshes holds the index range and materials the push constants of each
+// mesh and material, indexed by the ids in the draw keys.
+void make_draw_groups(
+  const std::vector<DrawPacket>& packets,
+  const std::vector<MeshRecord>& meshes,
+  const std::vector<DrawPushConstants>& materials,
+  std::vector<DrawGroup>* groups
+);
+
+// Binds the state and records groups [first, last), skipping push constants
+// equal to the previous group's. Only reads its arguments, so jobs can
+// record disjoint ranges in parallel.
+DrawStats record_draw_groups(
+  vk::CommandBuffer commandBuffer,
+  const DrawBindings& bindings,
+  const std::vector<DrawGroup>& groups,
+  size_t first,
+  size_t last
+);
+
+}  // namespace vkUtil
+
+#endif  // INC_DRAWGROUP_H_
@@ -0,0 +1,86 @@
+// Copyright (c) 2024 Meerkat
+#ifndef INC_DRAWPACKET_H_
+#define INC_DRAWPACKET_H_
+
+#include "CommonMath.h"
+#include <vector>
+
+namespace vkUtil {
+
+// One instance to draw, ordered by key. From the most significant bits the
+// key holds the pass, pipeline, material, mesh and a depth bucket, so sorting
+// groups the state changes from the most to the least expensive one.
+struct DrawPacket {
+  uint64_t key;
+  uint32_t instance;
+  uint32_t pad;
+};
+
+constexpr uint32_t sDrawKeyDepthBits    = 20;
+constexpr uint32_t sDrawKeyMeshBits     = 16;
+constexpr uint32_t sDrawKeyMaterialBits = 16;
+constexpr uint32_t sDrawKeyPipelineBits = 8;
+constexpr uint32_t sDrawKeyPassBits     = 4;
+
+constexpr uint32_t sDrawKeyMeshShift     = sDrawKeyDepthBits;
+constexpr uint32_t sDrawKeyMaterialShift =
+  sDrawKeyMeshShift + sDrawKeyMeshBits;
+constexpr uint32_t sDrawKeyPipelineShift =
+  sDrawKeyMaterialShift + sDrawKeyMaterialBits;
+constexpr uint32_t sDrawKeyPassShift     =
+  sDrawKeyPipelineShift + sDrawKeyPipelineBits;
+
+inline uint64_t make_draw_key(
+  uint32_t pass,
+  uint32_t pipeline,
+  uint32_t material,
+  uint32_t mesh,
+  uint32_t depthBucket
+) {
+  auto field = [](uint32_t value, uint32_t bits) {
+    return static_cast<uint64_t>(value) & ((1ull << bits) - 1);
+  };
+
+  return field(pass, sDrawKeyPassBits) << sDrawKeyPassShift
+    | field(pipeline, sDrawKeyPipelineBits) << sDrawKeyPipelineShift
+    | field(material, sDrawKeyMaterialBits) << sDrawKeyMaterialShift
+    | field(mesh, sDrawKeyMeshBits) << sDrawKeyMeshShift
+    | field(depthBucket, sDrawKeyDepthBits);
+}
+
+// Bucket of a view distance in [0, far], front to back.
+inline uint32_t make_depth_bucket(float distance, float far) {
+  const uint32_t maxBucket = (1u << sDrawKeyDepthBits) - 1;
+  const float scaled = distance / far * static_cast<float>(maxBucket);
+  if (!(scaled > 0.0f)) {
+    return 0;
+  }
+  return scaled >= maxBucket ? maxBucket : static_cast<uint32_t>(scaled);
+}
+
+// Key without the depth bucket: packets that share it can be drawn with
+// the same bound state.
+inline uint64_t get_draw_state(uint64_t key) {
+  return key >> sDrawKeyDepthBits;
+}
+
+inline uint32_t get_draw_material(uint64_t key) {
+  return static_cast<uint32_t>(key >> sDrawKeyMaterialShift)
+    & ((1u << sDrawKeyMaterialBits) - 1);
+}
+
+inline uint32_t get_draw_mesh(uint64_t key) {
+  return static_cast<uint32_t>(key >> sDrawKeyMeshShift)
+    & ((1u << sDrawKeyMeshBits) - 1);
+}
+
+// Sorts packets by key with an LSD radix sort over bytes, scratch is
+// resized to match. Stable, and skips the bytes all keys share.
+void radix_sort(
+  std::vector<DrawPacket>* packets,
+  std::vector<DrawPacket>* scratch
+);
+
+}  // namespace vkUtil
+
+#endif  // INC_DRAWPACKET_H_
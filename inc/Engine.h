@@ -5,52 +5,152 @@
 
 #include "Common.h"
 #include "Frame.h"
+#include "FrameContext.h"
 #include "Pipeline.h"
+#include "PipelineCache.h"
+#include "PipelineCompiler.h"
 #include "VertexMenagerie.h"
 #include "Image.h"
 #include "Texture.h"
 #include "Cubemap.h"
+#include "TextureRegistry.h"
+#include "SamplerCache.h"
+#include "TextureStreamer.h"
+#include "TextureAtlas.h"
+#include "DeletionQueue.h"
+#include "DescriptorAllocator.h"
+#include "JobPool.h"
+#include "DrawPacket.h"
+#include "DrawGroup.h"
+#include "SoftwareOcclusion.h"
 #include <vector>
 #include <unordered_map>
 
 class Scene;
 class Engine {
  public:
+  static constexpr size_t sDefaultTextureBudget = 256 << 20;
+
   void init(
     uint32_t width, uint32_t height, GLFWwindow* window, bool debugMode);
   void destroy();
+  // Sizes the per-frame instance buffers for the scene up front, render
+  // grows them if the scene outgrows them later.
+  void load_scene(Scene* scene);
   void render(Scene* scene);
 
+  // Device memory the streamed material textures may occupy. Set before
+  // init to bound the textures loaded with the assets too.
+  void set_texture_budget(size_t budget);
+  // Cull and emit draws in a compute pass instead of recording them on the
+  // CPU.
+  void set_gpu_driven(bool gpuDriven);
+  bool get_gpu_driven() const { return mGpuDriven; }
+  // Lay down depth with a position only pass first, so the main pass shades
+  // each pixel once. Can be switched between frames.
+  void set_depth_prepass(bool depthPrepass);
+  bool get_depth_prepass() const { return mDepthPrepass; }
+  // GPU time of the render pass of the last completed frame, in
+  // milliseconds. Zero where the queue has no timestamps.
+  float get_gpu_time() const { return mGpuTime; }
+  // Occlusion culling on top of frustum culling. The GPU driven draws are
+  // tested against a depth pyramid in two phases, the CPU recorded ones
+  // against occluders rasterized in software.
+  void set_occlusion_culling(bool occlusionCulling);
+  // Cull counters of the last completed GPU driven frame, or of the last
+  // prepared CPU recorded one.
+  const vkUtil::CullCounters& get_cull_stats() const { return mCullStats; }
+
+  // State changes recorded by the last CPU driven standard pass.
+  const vkUtil::DrawStats& get_draw_stats() const { return mDrawStats; }
+
  private:
   void make_instance();
   void make_device();
   void make_swapchain();
+  // Retires the swapchain and everything sized by it without waiting for
+  // the device.
   void recreate_swapchain();
+  // Whether the window was resized, or presentation reported suboptimal,
+  // and the framebuffer size has since held still for the debounce time.
+  bool resize_settled();
   void cleanup_swapchain();
   void make_descriptor_set_layouts();
+  // Describes every pipeline and compiles them on the pipeline compiler,
+  // returning once those the first frame draws with are ready.
   void make_pipeline();
+  // Collects the depth prepass variants, compiled after everything else.
+  void wait_depth_prepass_pipelines();
   void finalize_setup();
   void make_framebuffers();
-  void make_frame_resources();
+  void make_frame_contexts();
+  // Depth is sampled into a pyramid only for GPU driven occlusion culling,
+  // otherwise it is transient.
+  bool uses_depth_pyramid() const;
+  void make_depth_buffers();
+  // Remakes depth and framebuffers when uses_depth_pyramid() changes.
+  void remake_depth_buffers();
   void make_assets();
-  void prepare_scene(vk::CommandBuffer commandBuffer);
-  void prepare_frame(uint32_t imageIndex, Scene* scene);
-  void record_draw_commands_sky(
+  void make_mesh_table();
+  // Binds the mesh buffers, only the position stream for the depth prepass.
+  void prepare_scene(
+    vk::CommandBuffer commandBuffer,
+    bool positionsOnly = false
+  ) const;
+  void prepare_frame(vkUtil::FrameContext& frame, Scene* scene);
+  // Rasterizes the occluders among mFrustumInstances on the job pool, then
+  // drops the instances they hide. Returns how many were dropped.
+  uint32_t cull_occluded(Scene* scene, const glm::mat4& viewProjection);
+  // Writes the ObjectData of scene instance index to the frame's slot.
+  void write_object_data(
+    vkUtil::FrameContext& frame,
+    uint32_t slot,
+    Scene* scene,
+    uint32_t index
+  );
+  void update_streaming(Scene* scene);
+  void record_cull_commands(
+    vk::CommandBuffer commandBuffer,
+    vkUtil::FrameContext& frame,
+    vkUtil::CullPhase phase
+  );
+  // Reduces the frame's depth into its pyramid, leaving the depth ready to
+  // be loaded by the late pass.
+  void record_depth_pyramid(
     vk::CommandBuffer commandBuffer,
-    uint32_t imageIndex,
-    Scene* scene
+    const vkUtil::FrameContext& frame
   );
-  void record_draw_commands_standard(
+  // The draws written by the last cull dispatch, after a depth prepass of
+  // them when enabled.
+  void record_indirect_draws(
     vk::CommandBuffer commandBuffer,
-    uint32_t imageIndex,
-    Scene* scene
+    const vkUtil::FrameContext& frame
   );
-  void render_objects(
+  // Opaque geometry and then the sky in a single render pass.
+  void record_draw_commands(
     vk::CommandBuffer commandBuffer,
-    vkMesh::MeshTypes objType,
-    uint32_t* startInstance,
-    uint32_t instanceCount
+    uint32_t imageIndex
   );
+  // Full screen sky triangle at the far plane, depth tested so only pixels
+  // no geometry covered are shaded. Records into the running render pass.
+  void record_sky_commands(vk::CommandBuffer commandBuffer) const;
+  // Viewport and scissor covering the swapchain. Pipelines leave both
+  // dynamic, so every command buffer drawing with them records this once,
+  // secondaries included since they inherit no state.
+  void record_viewport(vk::CommandBuffer commandBuffer) const;
+  // State the standard or depth prepass draw groups are recorded with.
+  vkUtil::DrawBindings make_draw_bindings(
+    vk::DescriptorSet frameSet,
+    bool depthPrepass
+  ) const;
+  // Standard pipeline of the main pass, the depth tested variant when a
+  // prepass ran.
+  vk::Pipeline get_standard_pipeline() const;
+  void read_timestamps(vkUtil::FrameContext& frame);
+  void read_cull_stats(vkUtil::FrameContext& frame);
+  vkUtil::DrawPushConstants make_draw_constants(
+    vkMesh::MeshTypes objType
+  ) const;
 
  private:
   using TextureMap = std::unordered_map<vkMesh::MeshTypes, vkImage::Texture*>;
@@ -75,25 +175,103 @@ class Engine {
   std::vector<vkUtil::SwapChainFrame> mSwapchainFrames;
   vk::Format                          mSwapchainFormat;
   vk::Extent2D                        mSwapchainExtent;
+  // Framebuffer size last seen and the time it last changed.
+  int32_t                             mResizeWidth         = 0;
+  int32_t                             mResizeHeight        = 0;
+  double                              mResizeTime          = 0.0;
+  bool                                mSwapchainSuboptimal = false;
+  vk::Format                          mDepthFormat;
+  // Whether mDepthFormat can be sampled into the depth pyramid.
+  bool                                mDepthSampleable = false;
 
   std::unordered_map<PipelineTypes, vk::DescriptorSetLayout> mFrameSetLayout;
-  vk::DescriptorPool mFrameDescriptorPool;
-  std::unordered_map<PipelineTypes, vk::DescriptorSetLayout> mMeshSetLayout;
-  vk::DescriptorPool mMeshDescriptorPool;
+  std::unordered_map<PipelineTypes, vk::DescriptorUpdateTemplate>
+    mFrameUpdateTemplate;
+  vkUtil::DescriptorAllocator mDescriptorAllocator;
 
+  vkUtil::JobPool                     mJobPool;
+  vkImage::TextureRegistry* mTextureRegistry = nullptr;
+
+  // Kept on disk between runs, every pipeline is created through it.
+  vkInit::PipelineCache                                 mPipelineCache;
+  vkInit::PipelineCompiler                              mPipelineCompiler;
+  // Every graphics pipeline draws in the one render pass.
+  vk::RenderPass                                        mRenderPass;
   std::unordered_map<PipelineTypes, vk::PipelineLayout> mPipelineLayout;
-  std::unordered_map<PipelineTypes, vk::RenderPass>     mRenderPass;
   std::unordered_map<PipelineTypes, vk::Pipeline>       mGraphicsPipeline;
 
+  // Standard layout variants: depth only, and shading against the prepass
+  // depth with less-or-equal and no writes.
+  bool                          mDepthPrepass = false;
+  vk::Pipeline                  mDepthPrepassPipeline;
+  vk::Pipeline                  mDepthTestedPipeline;
+  // Compiled in the background, collected once the prepass is switched on.
+  vkInit::PipelineCompiler::Ticket
+    mDepthPrepassTicket = 0;
+  vkInit::PipelineCompiler::Ticket
+    mDepthTestedTicket  = 0;
+
+  // Nanoseconds per timestamp tick, zero without timestamp support.
+  float                         mTimestampPeriod = 0.0f;
+  float                         mGpuTime         = 0.0f;
+
+  bool                          mGpuDriven = true;
+  vk::DescriptorSetLayout       mCullSetLayout;
+  vk::DescriptorUpdateTemplate  mCullUpdateTemplate;
+  vk::PipelineLayout            mCullPipelineLayout;
+  vk::Pipeline                  mCullPipeline;
+
+  bool                          mOcclusionCulling = true;
+  vk::RenderPass                mEarlyRenderPass;
+  vk::RenderPass                mLateRenderPass;
+  vk::DescriptorSetLayout       mDepthPyramidSetLayout;
+  vk::PipelineLayout            mDepthPyramidPipelineLayout;
+  vk::Pipeline                  mDepthPyramidPipeline;
+  vk::Sampler                   mDepthPyramidSampler;
+  vkUtil::CullCounters          mCullStats {};
+
   vk::CommandPool                     mCommandPool;
   vk::CommandBuffer                   mMainCommandBuffer;
 
-  uint32_t                            mMaxFramesInFlight;
-  uint32_t                            mFrameNumber;
+  // Frames recorded ahead of the device, independent of the swapchain
+  // image count.
+  std::vector<vkUtil::FrameContext>   mFrameContexts;
+  uint32_t                            mMaxFramesInFlight = 2;
+  uint32_t                            mFrameNumber       = 0;
 
   VertexMenagerie*                    mMeshes = nullptr;
+  // MeshRecord per MeshTypes, read by the cull shader, and its host copy.
+  vkUtil::Buffer                      mMeshTable;
+  std::vector<vkUtil::MeshRecord>     mMeshRecords;
+  // Object space bounding sphere per MeshTypes, indexed like mMeshRecords.
+  std::vector<glm::vec4>              mMeshSpheres;
   TextureMap                          mMaterials;
+  vkImage::TextureAtlas*              mAtlas = nullptr;
+  std::unordered_map<vkMesh::MeshTypes, uint32_t> mAtlasRegions;
   vkImage::CubeMap*                   mSkyCubeMap = nullptr;
+  vkImage::SamplerCache*              mSamplerCache = nullptr;
+  // Object space bounding sphere per mesh, center in xyz and radius in w.
+  std::unordered_map<vkMesh::MeshTypes, glm::vec4> mMeshBounds;
+  // Per frame scratch: scene instances inside the frustum, and the draw
+  // packets sorted by state key, in the order their ObjectData is written.
+  std::vector<uint32_t>               mFrustumInstances;
+  std::vector<vkUtil::DrawPacket>     mDrawPackets;
+  std::vector<vkUtil::DrawPacket>     mDrawPacketScratch;
+  std::vector<vkUtil::DrawGroup>      mDrawGroups;
+  // make_draw_constants of every material, indexed by material id.
+  std::vector<vkUtil::DrawPushConstants> mMaterialConstants;
+  // Positions of the meshes designated as occluders, the buffer they are
+  // rasterized into, and which frustum instances they hide.
+  std::unordered_map<vkMesh::MeshTypes, vkUtil::OccluderMesh>
+    mOccluderMeshes;
+  vkUtil::OcclusionBuffer             mOcclusionBuffer;
+  std::vector<uint8_t>                mOccluded;
+  vkUtil::DrawStats                   mDrawStats {};
+
+  vkImage::TextureStreamer*           mTextureStreamer = nullptr;
+  size_t                              mTextureBudget   =
+    sDefaultTextureBudget;
+  vkUtil::DeletionQueue               mDeletionQueue;
 };
 
 #endif  // INC_ENGINE_H_
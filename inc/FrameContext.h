@@ -0,0 +1,177 @@
+// Copyright (c) 2024 Meerkat
+#ifndef INC_FRAMECONTEXT_H_
+#define INC_FRAMECONTEXT_H_
+
+#include "Common.h"
+#include "Memory.h"
+#include "Pipeline.h"
+#include "RenderStructs.h"
+#include <unordered_map>
+#include <vector>
+
+namespace vkUtil {
+
+class DeletionQueue;
+
+struct CameraMatrices {
+  glm::mat4 view;
+  glm::mat4 projection;
+  glm::mat4 viewProjection;
+};
+
+struct CameraVectors {
+  glm::vec4 forwards;
+  glm::vec4 right;
+  glm::vec4 up;
+};
+
+// Descriptor infos of the frame sets, read by the frame update templates.
+struct FrameDescriptors {
+  vk::DescriptorBufferInfo cameraMatrix;
+  vk::DescriptorBufferInfo cameraVectors;
+  vk::DescriptorBufferInfo modelBuffer;
+  vk::DescriptorBufferInfo meshTable;
+  vk::DescriptorBufferInfo drawCommands;
+  vk::DescriptorBufferInfo drawCount;
+  vk::DescriptorBufferInfo visibility;
+  vk::DescriptorImageInfo  depthPyramid;
+  vk::DescriptorBufferInfo visibleInstances;
+};
+
+// Upper bound on depth pyramid levels, enough for a 32k wide swapchain.
+constexpr uint32_t sMaxPyramidLevels = 16;
+
+// Everything one frame in flight records into or reads from: its command
+// buffer, synchronization and per-frame buffers. Contexts are used in a ring
+// independent of which swapchain image the frame ends up presenting, so a
+// context is only reused once its fence has signaled.
+class FrameContext {
+ public:
+  FrameContext();
+  ~FrameContext();
+
+  void make_descriptor_resources();
+  // With hiZ, depth is stored and sampled into the depth pyramid, which is
+  // made along with it. Otherwise depth is cleared on load and never
+  // stored, so the image is transient and lives in lazily allocated memory
+  // where the device offers it, and there is no pyramid.
+  void make_depth_resources(
+    vk::Format format,
+    vk::Extent2D extent,
+    bool hiZ
+  );
+  void destroy_depth_resources();
+  // Hands the depth resources to the deletion queue instead, for frames
+  // still in flight, and leaves the context ready for make_depth_resources.
+  void retire_depth_resources(DeletionQueue* deletionQueue);
+  // Grows the instance buffers geometrically to hold at least count
+  // instances. The old buffers are destroyed right away, so only call once
+  // the context's fence has signaled.
+  void reserve_instances(uint32_t count);
+  // One indirect command per mesh of the mesh table, and the host written
+  // commands each cull phase starts from.
+  void make_draw_buffers(uint32_t meshCount);
+  // Rewrites the descriptor sets if their buffers changed since the last
+  // write, otherwise does nothing.
+  void write_descriptor_set();
+  void destroy();
+
+ private:
+  void make_instance_buffers();
+  void destroy_instance_buffers();
+
+ public:
+  // Devices
+  vk::Device               mDevice;
+  vk::PhysicalDevice       mPhysicalDevice;
+
+  // Command
+  vk::CommandBuffer        mCommandBuffer;
+  // One pool and secondary buffer per recording job, reset once the frame's
+  // fence has signaled.
+  std::vector<vk::CommandPool>   mJobCommandPools;
+  std::vector<vk::CommandBuffer> mJobCommandBuffers;
+  // Depth prepass draws of each job, executed before any main pass draw.
+  std::vector<vk::CommandBuffer> mJobPrepassCommandBuffers;
+
+  // Timestamps around the render pass, read once the fence has signaled.
+  vk::QueryPool            mTimestampPool;
+  bool                     mTimestampsWritten = false;
+
+  // Depth, sized to the swapchain
+  vk::Image                mDepthBuffer;
+  vk::DeviceMemory         mDepthBufferMemory;
+  vk::ImageView            mDepthBufferView;
+  bool                     mDepthLazilyAllocated = false;
+
+  // Hi-Z pyramid of the frame's depth, R32 with one view per level for the
+  // reduction and one over all levels for culling. A descriptor set per
+  // level reads the level below and writes the level. Null without hiZ.
+  vk::Image                      mDepthPyramid;
+  vk::DeviceMemory               mDepthPyramidMemory;
+  vk::ImageView                  mDepthPyramidView;
+  std::vector<vk::ImageView>     mDepthPyramidLevelViews;
+  std::vector<vk::Extent2D>      mDepthPyramidExtents;
+  std::vector<vk::DescriptorSet> mDepthPyramidSets;
+  vk::Sampler                    mDepthPyramidSampler;
+
+  // Sync
+  vk::Semaphore            mImageAvailable;
+  vk::Fence                mInFlight;
+
+  CameraMatrices           mCameraMatrixData;
+  Buffer                   mCameraMatrixBuffer;
+  void*                    mCameraMatrixWriteLocation;
+
+  CameraVectors            mCameraVectorsData;
+  Buffer                   mCameraVectorsBuffer;
+  void*                    mCameraVectorsWriteLocation;
+
+  Buffer                   mModelBuffer;
+  ObjectData*              mModelBufferWriteLocation;
+  uint32_t                 mInstanceCapacity = 1024;
+  uint32_t                 mInstanceCount    = 0;
+  // The GPU driven path keeps the object data in scene order across frames
+  // and only rewrites the instances that changed. It is resident if the
+  // buffer holds scene version mSceneVersion; the CPU path and a regrown
+  // buffer drop that. Changed instances collect here until the context
+  // runs again.
+  bool                     mObjectsResident = false;
+  uint64_t                 mSceneVersion    = 0;
+  std::vector<uint32_t>    mChangedInstances;
+
+  // One indexed indirect command per mesh. Each cull phase copies in the
+  // template, which holds every mesh's index range, no instances and where
+  // its region of the visible instance buffer starts; the cull shader then
+  // counts each survivor into its mesh's command and region.
+  uint32_t                 mMeshCount = 0;
+  Buffer                   mDrawCommandBuffer;
+  Buffer                   mDrawTemplateBuffer;
+  vk::DrawIndexedIndirectCommand*
+                           mDrawTemplateLocation = nullptr;
+  // ObjectData index of every drawn instance, grouped by mesh, read by the
+  // vertex shaders through gl_InstanceIndex.
+  Buffer                   mVisibleInstanceBuffer;
+  // Drawn instances and cull statistics.
+  Buffer                   mDrawCountBuffer;
+  // Per instance result of the late cull phase, cleared when (re)made.
+  Buffer                   mVisibilityBuffer;
+  bool                     mVisibilityCleared = false;
+  // Host copy of the cull counters, read once the fence has signaled.
+  Buffer                   mCullReadbackBuffer;
+  void*                    mCullReadbackLocation;
+  bool                     mCullReadbackWritten = false;
+
+  FrameDescriptors         mDescriptors;
+  bool                     mDescriptorsDirty = true;
+
+  std::unordered_map<PipelineTypes, vk::DescriptorSet> mDescriptorSet;
+  std::unordered_map<PipelineTypes, vk::DescriptorUpdateTemplate>
+                                                       mUpdateTemplate;
+  vk::DescriptorSet                                    mCullDescriptorSet;
+  vk::DescriptorUpdateTemplate                         mCullUpdateTemplate;
+};
+
+}  // namespace vkUtil
+
+#endif  // INC_FRAMECONTEXT_H_
@@ -12,72 +12,57 @@
 namespace vkInit {
 
 struct FramebufferInput {
-  vk::Device                                        device;
-  std::unordered_map<PipelineTypes, vk::RenderPass> renderPass;
-  vk::Extent2D                                      swapchainExtent;
+  vk::Device                 device;
+  vk::RenderPass             renderPass;
+  vk::Extent2D               swapchainExtent;
+  // Depth attachment of each frame context.
+  std::vector<vk::ImageView> depthViews;
 };
 
-inline void make_framebuffers(
+inline vk::Framebuffer make_framebuffer(
   const FramebufferInput& input,
-  std::vector<vkUtil::SwapChainFrame>* frames,
+  const std::vector<vk::ImageView>& attachments,
   bool debug) {
-  for (size_t i = 0; i < frames->size(); ++i) {
-    {
-      std::vector<vk::ImageView> attachments {
-        frames->at(i).mImageView
-      };
-
-      vk::FramebufferCreateInfo framebufferInfo {};
-      framebufferInfo.flags           = vk::FramebufferCreateFlags();
-      framebufferInfo.renderPass      =
-        input.renderPass.at(PipelineTypes::SKY);
-      framebufferInfo.attachmentCount = attachments.size();
-      framebufferInfo.pAttachments    = attachments.data();
-      framebufferInfo.width           = input.swapchainExtent.width;
-      framebufferInfo.height          = input.swapchainExtent.height;
-      framebufferInfo.layers          = 1;
+  vk::FramebufferCreateInfo framebufferInfo {};
+  framebufferInfo.flags           = vk::FramebufferCreateFlags();
+  framebufferInfo.renderPass      = input.renderPass;
+  framebufferInfo.attachmentCount = attachments.size();
+  framebufferInfo.pAttachments    = attachments.data();
+  framebufferInfo.width           = input.swapchainExtent.width;
+  framebufferInfo.height          = input.swapchainExtent.height;
+  framebufferInfo.layers          = 1;
 
-      try {
-        if (debug) {
-          printf("Creating sky framebuffer %ld\n", i);
-        }
-        frames->at(i).mFramebuffer[PipelineTypes::SKY] =
-          input.device.createFramebuffer(framebufferInfo);
-      } catch (vk::SystemError err) {
-        if (debug) {
-          printf("Error creating sky framebuffer %ld. Error: %s\n",
-                 i, err.what());
-        }
-      }
+  vk::Framebuffer res {};
+  try {
+    res = input.device.createFramebuffer(framebufferInfo);
+  } catch (vk::SystemError err) {
+    if (debug) {
+      printf("Error creating framebuffer. Error: %s\n", err.what());
     }
-    {
-      std::vector<vk::ImageView> attachments {
-        frames->at(i).mImageView,
-        frames->at(i).mDepthBufferView
-      };
+  }
 
-      vk::FramebufferCreateInfo framebufferInfo {};
-      framebufferInfo.flags           = vk::FramebufferCreateFlags();
-      framebufferInfo.renderPass      =
-        input.renderPass.at(PipelineTypes::STANDARD);
-      framebufferInfo.attachmentCount = attachments.size();
-      framebufferInfo.pAttachments    = attachments.data();
-      framebufferInfo.width           = input.swapchainExtent.width;
-      framebufferInfo.height          = input.swapchainExtent.height;
-      framebufferInfo.layers          = 1;
+  return res;
+}
 
-      try {
-        if (debug) {
-          printf("Creating framebuffer %ld\n", i);
-        }
-        frames->at(i).mFramebuffer[PipelineTypes::STANDARD] =
-          input.device.createFramebuffer(framebufferInfo);
-      } catch (vk::SystemError err) {
-        if (debug) {
-          printf("Error creating framebuffer %ld. Error: %s\n",
-                 i, err.what());
-        }
+// Creates, for every swapchain image, one framebuffer per frame context.
+inline void make_framebuffers(
+  const FramebufferInput& input,
+  std::vector<vkUtil::SwapChainFrame>* frames,
+  bool debug) {
+  for (size_t i = 0; i < frames->size(); ++i) {
+    vkUtil::SwapChainFrame& frame = frames->at(i);
+    for (size_t c = 0; c < input.depthViews.size(); ++c) {
+      if (debug) {
+        printf("Creating framebuffers %ld for frame context %ld\n", i, c);
       }
+
+      frame.mFramebuffer.push_back(
+        make_framebuffer(
+          input,
+          { frame.mImageView, input.depthViews[c] },
+          debug
+        )
+      );
     }
   }
 }
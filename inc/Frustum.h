@@ -0,0 +1,54 @@
+// Copyright (c) 2024 Meerkat
+#ifndef INC_FRUSTUM_H_
+#define INC_FRUSTUM_H_
+
+#include "CommonMath.h"
+#include <glm/gtc/matrix_access.hpp>
+#include <algorithm>
+#include <array>
+
+namespace vkUtil {
+
+// Frustum planes of a view projection matrix, normalized so that
+// dot(plane.xyz, p) + plane.w is the signed distance of p, positive inside.
+// Order is left, right, bottom, top, near, far. Assumes zero to one depth.
+inline std::array<glm::vec4, 6> make_frustum_planes(
+  const glm::mat4& viewProjection) {
+  const glm::vec4 row0 = glm::row(viewProjection, 0);
+  const glm::vec4 row1 = glm::row(viewProjection, 1);
+  const glm::vec4 row2 = glm::row(viewProjection, 2);
+  const glm::vec4 row3 = glm::row(viewProjection, 3);
+
+  std::array<glm::vec4, 6> planes = { {
+    row3 + row0,
+    row3 - row0,
+    row3 + row1,
+    row3 - row1,
+    row2,
+    row3 - row2,
+  } };
+
+  for (glm::vec4& plane : planes) {
+    plane /= glm::length(glm::vec3(plane));
+  }
+
+  return planes;
+}
+
+// World space bounding sphere of an instance from its object space sphere,
+// the radius grows with the largest axis scale.
+inline glm::vec4 transform_sphere(
+  const glm::mat4& model, const glm::vec4& sphere) {
+  const glm::vec3 center =
+    glm::vec3(model * glm::vec4(glm::vec3(sphere), 1.0f));
+  const float scale = std::max(
+    glm::length(glm::vec3(model[0])),
+    std::max(glm::length(glm::vec3(model[1])),
+             glm::length(glm::vec3(model[2]))));
+
+  return glm::vec4(center, sphere.w * scale);
+}
+
+}  // namespace vkUtil
+
+#endif  // INC_FRUSTUM_H_
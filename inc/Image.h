@@ -18,6 +18,7 @@ struct ImageInputChunk {
   vk::Format              format;
   uint32_t                arraySize;
   vk::ImageCreateFlags    flags;
+  uint32_t                mipLevels;
 };
 
 struct ImageLayoutTransitionJob {
@@ -27,6 +28,7 @@ struct ImageLayoutTransitionJob {
   vk::ImageLayout   oldLayout;
   vk::ImageLayout   newLayout;
   uint32_t          arraySize;
+  uint32_t          mipLevels;
 };
 
 struct BufferImageCopyJob {
@@ -46,6 +48,15 @@ vk::DeviceMemory make_image_memory(
   vk::Image image
 );
 void transition_image_layout(const ImageLayoutTransitionJob& job);
+void record_layout_transition(
+  vk::CommandBuffer commandBuffer,
+  vk::Image image,
+  vk::ImageLayout oldLayout,
+  vk::ImageLayout newLayout,
+  uint32_t baseMipLevel,
+  uint32_t levelCount,
+  uint32_t arraySize
+);
 void copy_buffer_to_image(const BufferImageCopyJob& job);
 vk::ImageView make_image_view(
   vk::Device device,
@@ -53,7 +64,10 @@ vk::ImageView make_image_view(
   vk::Format format,
   vk::ImageAspectFlags aspectFlags,
   vk::ImageViewType type,
-  uint32_t arraySize
+  uint32_t arraySize,
+  const vk::ComponentMapping& components = vk::ComponentMapping(),
+  uint32_t mipLevels = 1,
+  uint32_t baseMipLevel = 0
 );
 vk::Format find_supported_format(
   vk::PhysicalDevice physicalDevice,
@@ -61,6 +75,14 @@ vk::Format find_supported_format(
   vk::ImageTiling tiling,
   vk::FormatFeatureFlags features
 );
+bool is_format_supported(
+  vk::PhysicalDevice physicalDevice,
+  vk::Format format,
+  vk::ImageTiling tiling,
+  vk::FormatFeatureFlags features
+);
+// Layout transitions of such formats must name both aspects.
+bool has_stencil_component(vk::Format format);
 
 }  // namespace vkImage
 
@@ -0,0 +1,53 @@
+// Copyright (c) 2024 Meerkat
+#ifndef INC_JOBPOOL_H_
+#define INC_JOBPOOL_H_
+
+#include "CommonMath.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vkUtil {
+
+// Fixed set of worker threads running batches of jobs. dispatch blocks the
+// caller until the whole batch is done, so jobs may reference the caller's
+// stack.
+class JobPool {
+ public:
+  using Job = std::function<void(uint32_t job)>;
+
+  JobPool();
+  ~JobPool();
+
+  void init(uint32_t workerCount);
+  void destroy();
+
+  uint32_t get_worker_count() const;
+
+  // Runs job(i) for every i in [0, jobCount) on the workers.
+  void dispatch(uint32_t jobCount, const Job& job);
+
+ private:
+  void work();
+
+ private:
+  std::vector<std::thread> mWorkers;
+  std::mutex               mMutex;
+  std::condition_variable  mWakeUp;
+  std::condition_variable  mDone;
+  bool                     mRunning    = false;
+  uint64_t                 mGeneration = 0;
+  uint32_t                 mBusyWorkers = 0;
+
+  // Batch being run
+  const Job*               mJob      = nullptr;
+  uint32_t                 mJobCount = 0;
+  std::atomic<uint32_t>    mNextJob  = 0;
+};
+
+}  // namespace vkUtil
+
+#endif  // INC_JOBPOOL_H_
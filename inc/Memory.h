@@ -43,6 +43,28 @@ inline uint32_t findMemoryTypeIndex(
   throw std::runtime_error("");
 }
 
+inline bool hasMemoryType(
+  vk::PhysicalDevice physicalDevice, uint32_t supportedMemoryIndices,
+  vk::MemoryPropertyFlags requestedProperties) {
+  vk::PhysicalDeviceMemoryProperties memoryProperties =
+    physicalDevice.getMemoryProperties();
+
+  for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i) {
+    bool isSupported =
+      static_cast<bool>(supportedMemoryIndices & (1 << i));
+
+    bool isSufficient =
+      (memoryProperties.memoryTypes[i].propertyFlags & requestedProperties)
+      == requestedProperties;
+
+    if (isSupported && isSufficient) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
 inline void allocateBufferMemory(Buffer* buffer,
                                  const BufferInputChunk& input) {
   vk::MemoryRequirements memoryRequirements =
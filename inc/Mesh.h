@@ -57,6 +57,32 @@ getPosColorAttributeDescriptions() {
   return attributes;
 }
 
+// Tightly packed positions, the only input of the depth prepass.
+static const uint32_t POSITION_COMPONENTS = 3;
+
+inline vk::VertexInputBindingDescription getPositionBindingDescription() {
+  vk::VertexInputBindingDescription bindingDescription {};
+  bindingDescription.binding   = 0;
+  bindingDescription.stride    = POSITION_COMPONENTS * sizeof(float);
+  bindingDescription.inputRate = vk::VertexInputRate::eVertex;
+
+  return bindingDescription;
+}
+
+inline std::vector<vk::VertexInputAttributeDescription>
+getPositionAttributeDescriptions() {
+  std::vector<vk::VertexInputAttributeDescription> attributes {};
+  attributes.resize(1);
+
+  // Pos
+  attributes[0].binding  = 0;
+  attributes[0].location = 0;
+  attributes[0].format   = vk::Format::eR32G32B32Sfloat;
+  attributes[0].offset   = 0;
+
+  return attributes;
+}
+
 }  // namespace vkMesh
 
 #endif  // INC_MESH_H_
@@ -0,0 +1,43 @@
+// Copyright (c) 2024 Meerkat
+#ifndef INC_MIPCHAIN_H_
+#define INC_MIPCHAIN_H_
+
+#include "Common.h"
+#include <vector>
+
+namespace vkImage {
+
+// CPU side texels of a texture, repacked into the smallest format that keeps
+// the source channels and box filtered into a mip chain. Only the levels in
+// [firstLevel, firstLevel + levels.size()) are kept.
+struct MipChain {
+  uint32_t                                width         = 0;
+  uint32_t                                height        = 0;
+  uint32_t                                channels      = 0;
+  uint32_t                                bytesPerPixel = 4;
+  vk::Format                              format = vk::Format::eR8G8B8A8Unorm;
+  vk::ComponentMapping                    swizzle;
+  uint32_t                                levelCount    = 0;
+  uint32_t                                firstLevel    = 0;
+  std::vector<std::vector<unsigned char>> levels;
+};
+
+uint32_t mip_level_count(uint32_t width, uint32_t height);
+vk::Extent2D mip_level_extent(uint32_t width, uint32_t height, uint32_t level);
+
+// Decodes filename and keeps the levels [firstLevel, lastLevel). A lastLevel
+// of 0 keeps the chain down to 1x1. When maxExtent is not 0 the first kept
+// level is raised until neither side is larger than maxExtent. Safe to call
+// from worker threads.
+bool load_mip_chain(
+  const char* filename,
+  vk::PhysicalDevice physicalDevice,
+  uint32_t firstLevel,
+  uint32_t lastLevel,
+  uint32_t maxExtent,
+  MipChain* chain
+);
+
+}  // namespace vkImage
+
+#endif  // INC_MIPCHAIN_H_
@@ -18,6 +18,11 @@ class ObjMesh {
   std::vector<glm::vec3>                     vn;
   std::vector<glm::vec2>                     vt;
   glm::mat4                                  preTransform;
+  // Bounds of the pre transformed positions, the sphere is centered on the
+  // box with the center in xyz and the radius in w.
+  glm::vec3                                  boundsMin;
+  glm::vec3                                  boundsMax;
+  glm::vec4                                  boundingSphere;
 
   ObjMesh(
     const char* objFilepath,
@@ -30,6 +35,7 @@ class ObjMesh {
   void read_normal_data(const std::vector<std::string>& words);
   void read_face_data(const std::vector<std::string>& words);
   void read_corner(const std::string& words);
+  void compute_bounds();
 };
 
 }
@@ -6,6 +6,7 @@
 #include "Shaders.h"
 #include "RenderStructs.h"
 #include "Mesh.h"
+#include <array>
 #include <unordered_map>
 #include <vector>
 #include <string>
@@ -28,12 +29,60 @@ struct GraphicsPipelineOutBundle {
   vk::Pipeline       graphicsPipeline;
 };
 
+// Everything a graphics pipeline is compiled from, by value so a copy can
+// be compiled on another thread while the builder moves on. The layout and
+// render pass already exist, only the pipeline itself is left to make.
+// Filled once by PipelineBuilder::describe and read only after that.
+struct GraphicsPipelineDescription {
+  const std::string                                      vertexShader;
+  // Empty for depth only pipelines.
+  const std::string                                      fragmentShader;
+  // Empty when the vertex shader makes its own vertices.
+  const std::vector<vk::VertexInputBindingDescription>   bindingDescriptions;
+  const std::vector<vk::VertexInputAttributeDescription> attributeDescriptions;
+  const bool                                             depthTest;
+  const bool                                             depthWrite;
+  const vk::CompareOp                                    depthCompareOp;
+  const vk::ColorComponentFlags                          colorWriteMask;
+  const vk::PipelineLayout                               pipelineLayout;
+  const vk::RenderPass                                   renderPass;
+};
+
+// Compute pipelines have a single stage and no fixed function state, so they
+// are described directly instead of through the builder.
+struct ComputePipelineDescription {
+  std::string        shader;
+  vk::PipelineLayout pipelineLayout;
+};
+
+vk::PipelineLayout make_pipeline_layout(
+  vk::Device device,
+  const std::vector<vk::DescriptorSetLayout>& descriptorSetLayouts,
+  const std::vector<vk::PushConstantRange>& pushConstantRanges
+);
+
+// Load the shaders and compile the pipeline, through pipelineCache when one
+// is given. Only read the description, so any thread may call them.
+vk::Pipeline make_graphics_pipeline(
+  vk::Device device,
+  vk::PipelineCache pipelineCache,
+  const GraphicsPipelineDescription& description,
+  bool debug
+);
+vk::Pipeline make_compute_pipeline(
+  vk::Device device,
+  vk::PipelineCache pipelineCache,
+  const ComputePipelineDescription& description,
+  bool debug
+);
+
 class PipelineBuilder {
  public:
   PipelineBuilder();
   ~PipelineBuilder();
 
-  void init(vk::Device);
+  // build compiles through pipelineCache when one is given.
+  void init(vk::Device device, vk::PipelineCache pipelineCache, bool debug);
 
   void reset();
 
@@ -44,59 +93,79 @@ class PipelineBuilder {
 
   void specify_vertex_shader(const char* filename);
   void specify_fragment_shader(const char* filename);
-  void specify_swapchain_extent(vk::Extent2D screen_size);
   void specify_depth_attachment(
     const vk::Format& depthFormat,
     uint32_t attachment_index
   );
   void clear_depth_attachment();
+  // Depth test of the pipeline, specify_depth_attachment defaults it to a
+  // writing less-than test.
+  void set_depth_test(vk::CompareOp compareOp, bool write);
   void add_color_attachment(
     const vk::Format& format,
     uint32_t attachment_index
   );
+  // Overwrite mode loads the attachments instead of clearing or discarding
+  // them, for a pass continuing another one.
   void set_overwrite_mode(bool mode);
+  // Keep the depth attachment after the pass, for passes sampling it later.
+  void set_depth_store(bool store);
+  // Builds against an existing render pass instead of making one from the
+  // attachments, so several pipelines can draw in the same pass.
+  void use_renderpass(vk::RenderPass renderPass);
+  // Same for the layout, for variants of a pipeline binding the same sets.
+  void use_pipeline_layout(vk::PipelineLayout pipelineLayout);
+  // Color channels written, none for depth only pipelines.
+  void set_color_write_mask(vk::ColorComponentFlags mask);
+  // Makes the layout and render pass if none is in use, and returns the
+  // description of the pipeline for make_graphics_pipeline.
+  GraphicsPipelineDescription describe();
+  // describe and compile right away.
   GraphicsPipelineOutBundle build();
+  // Only the render pass of the current attachments, for passes drawn with
+  // pipelines built against a compatible one.
+  vk::RenderPass build_renderpass();
   void add_descriptor_set_layout(vk::DescriptorSetLayout descriptorSetLayout);
   void reset_descriptor_set_layout();
+  void add_push_constant_range(
+    vk::ShaderStageFlags stages,
+    uint32_t offset,
+    uint32_t size
+  );
+  void reset_push_constant_ranges();
 
  private:
-  vk::Device                     mDevice;
-  vk::GraphicsPipelineCreateInfo mPipelineInfo {};
+  vk::Device                                       mDevice;
+  vk::PipelineCache                                mPipelineCache = nullptr;
+  bool                                             mHasDebug = false;
 
-  vk::VertexInputBindingDescription                mBindingDescription;
+  std::vector<vk::VertexInputBindingDescription>   mBindingDescriptions;
   std::vector<vk::VertexInputAttributeDescription> mAttributeDescriptions;
-  vk::PipelineVertexInputStateCreateInfo           mVertexInputInfo {};
-  vk::PipelineInputAssemblyStateCreateInfo         mInputAssemblyInfo {};
-
-  std::vector<vk::PipelineShaderStageCreateInfo>   mShaderStages;
-  vk::ShaderModule                                 mVertexShader = nullptr;
-  vk::ShaderModule                                 mFragmentShader = nullptr;
-  vk::PipelineShaderStageCreateInfo                mVertexShaderInfo;
-  vk::PipelineShaderStageCreateInfo                mFragmentShaderInfo;
+  std::string                                      mVertexShader;
+  std::string                                      mFragmentShader;
 
-  vk::Extent2D                                     mSwapchainExtent;
-  vk::Viewport                                     mViewport {};
-  vk::Rect2D                                       mScissor {};
-  vk::PipelineViewportStateCreateInfo              mViewportState {};
+  bool                                             mDepthTest  = false;
+  bool                                             mDepthWrite = false;
+  vk::CompareOp                                    mDepthCompareOp =
+    vk::CompareOp::eLess;
+  vk::ColorComponentFlags                          mColorWriteMask;
 
-  vk::PipelineRasterizationStateCreateInfo         mRasterizerInfo {};
-
-  vk::PipelineDepthStencilStateCreateInfo          mDepthState;
   std::unordered_map<uint32_t, vk::AttachmentDescription>
     mAttachmentDescriptions;
   std::unordered_map<uint32_t, vk::AttachmentReference>
     mAttachmentReferences;
   std::vector<vk::AttachmentDescription>  mFlattenedAttachmentDescriptions;
   std::vector<vk::AttachmentReference>    mFlattenedAttachmentReferences;
-  vk::PipelineMultisampleStateCreateInfo  mMultisamplingInfo {};
-  vk::PipelineColorBlendAttachmentState   mColorBlendAttachment {};
-  vk::PipelineColorBlendStateCreateInfo   mColorBlendingInfo {};
   std::vector<vk::DescriptorSetLayout>    mDescriptorSetLayouts;
+  std::vector<vk::PushConstantRange>      mPushConstantRanges;
   bool                                    mOverwrite;
+  bool                                    mDepthStore = false;
+  vk::RenderPass                          mRenderPass = nullptr;
+  vk::PipelineLayout                      mPipelineLayout = nullptr;
 
  private:
   void reset_vertex_format();
-  void reset_shader_modules();
+  void reset_shaders();
   void reset_renderpass_attachments();
   vk::AttachmentDescription make_renderpass_attachment(
     const vk::Format& format,
@@ -109,16 +178,6 @@ class PipelineBuilder {
     uint32_t attachmentIndex,
     vk::ImageLayout layout
   );
-  void configure_input_assembly();
-  vk::PipelineShaderStageCreateInfo make_shader_info(
-    const vk::ShaderModule& shaderModule,
-    const vk::ShaderStageFlagBits& stage
-  );
-  vk::PipelineViewportStateCreateInfo make_viewport_state();
-  void make_rasterizer_info();
-  void configure_multisampling();
-  void configure_color_blending();
-  vk::PipelineLayout make_pipeline_layout();
   vk::RenderPass make_renderpass();
   vk::SubpassDescription make_subpass(
     const std::vector<vk::AttachmentReference>& attachments
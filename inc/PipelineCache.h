@@ -0,0 +1,45 @@
+// Copyright (c) 2024 Meerkat
+#ifndef INC_PIPELINECACHE_H_
+#define INC_PIPELINECACHE_H_
+
+#include "Common.h"
+#include <string>
+#include <vector>
+
+namespace vkInit {
+
+// vk::PipelineCache kept in a file between runs, so pipelines compiled by
+// one launch are reused by the next. The file is only loaded if its header
+// names this vendor, device and driver cache UUID; otherwise the cache
+// starts empty and replaces the file on destroy.
+class PipelineCache {
+ public:
+  void init(
+    vk::PhysicalDevice physicalDevice,
+    vk::Device device,
+    const std::string& filename,
+    bool debug
+  );
+  // Writes the cache back to its file, then destroys it.
+  void destroy();
+
+  vk::PipelineCache get() const;
+  // Whether init loaded pipelines from the file.
+  bool is_warm() const;
+
+ private:
+  bool is_compatible(const std::vector<char>& data) const;
+  void save() const;
+
+ private:
+  vk::Device                   mDevice;
+  vk::PhysicalDeviceProperties mProperties;
+  vk::PipelineCache            mCache = nullptr;
+  std::string                  mFilename;
+  bool                         mWarm  = false;
+  bool                         mDebug = false;
+};
+
+}  // namespace vkInit
+
+#endif  // INC_PIPELINECACHE_H_
@@ -0,0 +1,71 @@
+// Copyright (c) 2024 Meerkat
+#ifndef INC_PIPELINECOMPILER_H_
+#define INC_PIPELINECOMPILER_H_
+
+#include "Common.h"
+#include "Pipeline.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vkInit {
+
+// Compiles pipeline descriptions on its own worker threads, in the order
+// they are submitted, all through one pipeline cache. Vulkan synchronizes
+// pipeline caches internally, so the workers share it without a lock.
+// submit returns at once and wait blocks on that one pipeline only: submit
+// what the first frame needs first, and wait for the rest when used.
+class PipelineCompiler {
+ public:
+  using Ticket = uint32_t;
+
+  PipelineCompiler();
+  ~PipelineCompiler();
+
+  void init(
+    vk::Device device,
+    vk::PipelineCache pipelineCache,
+    uint32_t workerCount,
+    bool debug
+  );
+  // Finishes what was submitted, then joins the workers. Pipelines never
+  // waited for are left to the caller, who still holds their tickets.
+  void destroy();
+
+  // The description is copied into the task, the caller may drop its own.
+  Ticket submit(GraphicsPipelineDescription description);
+  Ticket submit(ComputePipelineDescription description);
+  vk::Pipeline wait(Ticket ticket);
+
+ private:
+  struct Task {
+    std::function<vk::Pipeline()> compile;
+    vk::Pipeline                   pipeline = nullptr;
+    bool                           done     = false;
+  };
+
+  Ticket enqueue(std::function<vk::Pipeline()> compile);
+  void work();
+
+ private:
+  vk::Device               mDevice;
+  vk::PipelineCache        mPipelineCache;
+  bool                     mDebug = false;
+
+  std::vector<std::thread> mWorkers;
+  std::mutex               mMutex;
+  std::condition_variable  mWakeUp;
+  std::condition_variable  mDone;
+  bool                     mRunning = false;
+  // Indexed by ticket, a deque so workers keep their task while more are
+  // queued.
+  std::deque<Task>         mTasks;
+  uint32_t                 mNextTask = 0;
+};
+
+}  // namespace vkInit
+
+#endif  // INC_PIPELINECOMPILER_H_
@@ -6,8 +6,89 @@
 
 namespace vkUtil {
 
+// Per instance record of the object storage buffer, matches the std430
+// layout declared in default.vert and cull.comp.
 struct ObjectData {
   glm::mat4 model;
+  // Material of the instance, read instead of the push constants when the
+  // draw was written by the cull shader.
+  glm::vec4 uvTransform;
+  // Object space bounding sphere, center in xyz and radius in w.
+  glm::vec4 bounds;
+  uint32_t  mesh;
+  uint32_t  material;
+  uint32_t  flags;
+  uint32_t  pad;
+};
+
+// Per mesh record of the mesh table, indexed by MeshTypes, matches
+// cull.comp.
+struct MeshRecord {
+  uint32_t indexCount;
+  uint32_t firstIndex;
+};
+
+// DrawPushConstants::flags
+enum DrawFlags : uint32_t {
+  // The material is a region of the texture atlas, coordinates are wrapped
+  // before being moved into it.
+  DRAW_FLAG_ATLAS      = 1 << 0,
+  // The draw was written by the cull shader, gl_InstanceIndex picks the
+  // instance from the visible instance buffer and material comes from its
+  // ObjectData record.
+  DRAW_FLAG_GPU_DRIVEN = 1 << 1,
+  // Only in ObjectData: the instance is hidden, the cull shader skips it.
+  DRAW_FLAG_HIDDEN     = 1 << 2,
+  // The material got no bindless slot, default.frag skips the texture fetch
+  // rather than reading another material's slot.
+  DRAW_FLAG_UNTEXTURED = 1 << 3,
+};
+
+// Per draw parameters pushed before each mesh/material draw, matches the push
+// constant block of default.vert.
+struct DrawPushConstants {
+  // Texture coordinate scale in xy and offset in zw, places the material in
+  // its region of a texture atlas.
+  glm::vec4 uvTransform;
+  // First ObjectData record of the draw.
+  uint32_t  baseInstance;
+  // Slot of the material texture in the bindless array.
+  uint32_t  material;
+  uint32_t  flags;
+};
+
+// Parameters of the cull dispatch, matches the push constant block of
+// cull.comp.
+struct CullPushConstants {
+  // World space frustum planes, inside where dot(plane.xyz, p) + plane.w is
+  // positive.
+  glm::vec4 planes[6];
+  uint32_t  instanceCount;
+  // Number of per mesh commands, instances of other meshes are dropped.
+  uint32_t  maxDraws;
+  // CullPhase of the dispatch.
+  uint32_t  phase;
+  uint32_t  pad;
+};
+
+// CullPushConstants::phase. With occlusion culling a frame culls twice: the
+// early phase draws what was visible the last time the frame context ran,
+// the late phase tests everything against the depth pyramid built from the
+// early draws and draws what became visible.
+enum CullPhase : uint32_t {
+  // Frustum culling only, every instance.
+  CULL_PHASE_ALL   = 0,
+  CULL_PHASE_EARLY = 1,
+  CULL_PHASE_LATE  = 2,
+};
+
+// Drawn instance count and statistics written by cull.comp. The drawn count
+// is reset before each phase, the statistics once per frame.
+struct CullCounters {
+  uint32_t drawCount;
+  uint32_t frustumCulled;
+  uint32_t occlusionCulled;
+  uint32_t pad;
 };
 
 }  // namespace vkUtil
@@ -0,0 +1,53 @@
+// Copyright (c) 2024 Meerkat
+#ifndef INC_SAMPLERCACHE_H_
+#define INC_SAMPLERCACHE_H_
+
+#include "Common.h"
+#include <unordered_map>
+
+namespace vkImage {
+
+struct SamplerInfoHash {
+  size_t operator()(const vk::SamplerCreateInfo& info) const;
+};
+
+struct SamplerInfoEqual {
+  bool operator()(
+    const vk::SamplerCreateInfo& a,
+    const vk::SamplerCreateInfo& b
+  ) const;
+};
+
+// Hands out one vk::Sampler per distinct SamplerCreateInfo. Samplers are
+// reference counted and destroyed when the last user releases them. Create
+// infos with a pNext chain are rejected, acquire returns a null sampler.
+class SamplerCache {
+ public:
+  SamplerCache();
+  ~SamplerCache();
+
+  void init(vk::Device device);
+  void destroy();
+
+  vk::Sampler acquire(const vk::SamplerCreateInfo& samplerInfo);
+  void release(vk::Sampler sampler);
+
+  size_t size() const;
+
+ private:
+  struct Entry {
+    vk::Sampler sampler;
+    uint32_t    references;
+  };
+
+  using SamplerMap = std::unordered_map<
+    vk::SamplerCreateInfo, Entry, SamplerInfoHash, SamplerInfoEqual>;
+
+  vk::Device mDevice;
+  SamplerMap mSamplers;
+  std::unordered_map<VkSampler, vk::SamplerCreateInfo> mKeys;
+};
+
+}  // namespace vkImage
+
+#endif  // INC_SAMPLERCACHE_H_
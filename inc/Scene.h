@@ -4,16 +4,137 @@
 
 #include "Common.h"
 #include "Mesh.h"
+#include "Bvh.h"
+#include <glm/gtc/quaternion.hpp>
+#include <array>
 #include <unordered_map>
 #include <vector>
 
+// Handle of a scene instance. Stays valid while other instances are added
+// or removed, and stops resolving once its own instance is removed.
+struct InstanceHandle {
+  uint32_t slot;
+  uint32_t generation;
+};
+
+// Scene::flags
+enum InstanceFlags : uint32_t {
+  INSTANCE_FLAG_HIDDEN = 1 << 0,
+};
+
+// Instances in structure of arrays layout, sorted by mesh and material so
+// each draw range is contiguous. Adds and removes only append or swap, the
+// order is restored by flush. A BVH over the world bounds answers frustum,
+// sphere and ray queries; it is rebuilt when instances are added or removed
+// and refit when they only move.
 class Scene {
  public:
+  // Instances [first, first + count) share a mesh and a material.
+  struct DrawRange {
+    vkMesh::MeshTypes mesh;
+    uint32_t          material;
+    uint32_t          first;
+    uint32_t          count;
+  };
+
   Scene();
 
   void init();
 
-  std::unordered_map<vkMesh::MeshTypes, std::vector<glm::vec3>> positions;
+  // material is the mesh type whose texture the instance uses.
+  InstanceHandle add(
+    vkMesh::MeshTypes mesh,
+    uint32_t material,
+    const glm::vec3& position,
+    const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+    const glm::vec3& scale = glm::vec3(1.0f),
+    uint32_t instanceFlags = 0
+  );
+  InstanceHandle add(vkMesh::MeshTypes mesh, const glm::vec3& position);
+  void remove(InstanceHandle handle);
+  void set_transform(
+    InstanceHandle handle,
+    const glm::vec3& position,
+    const glm::quat& rotation,
+    const glm::vec3& scale
+  );
+  // Object space bounding sphere of a mesh, center in xyz and radius in w.
+  void set_mesh_bounds(vkMesh::MeshTypes mesh, const glm::vec4& sphere);
+  bool contains(InstanceHandle handle) const;
+  // Index of the instance in the arrays below, valid until the next add,
+  // remove or flush.
+  uint32_t get_index(InstanceHandle handle) const;
+
+  // Sorts the instances back by mesh and material and rebuilds the draw
+  // ranges and the BVH if anything was added or removed, otherwise refits
+  // the BVH around the instances that moved.
+  void flush();
+
+  // Queries return instance indices, valid until the next flush.
+  void query_frustum(
+    const std::array<glm::vec4, 6>& planes,
+    std::vector<uint32_t>* indices
+  ) const;
+  void query_sphere(
+    const glm::vec3& center,
+    float radius,
+    std::vector<uint32_t>* indices
+  ) const;
+  bool raycast(
+    const glm::vec3& origin,
+    const glm::vec3& direction,
+    float maxDistance,
+    uint32_t* index,
+    float* distance
+  ) const;
+
+  // Bumped by every flush that reorders the instances. Indices from an
+  // older version no longer name the same instances.
+  uint64_t get_version() const;
+  // Instances whose transform changed in flushes of the current version
+  // since the last clear_changed, possibly repeated.
+  const std::vector<uint32_t>& get_changed() const;
+  void clear_changed();
+
+  size_t get_instance_count() const;
+  const std::vector<DrawRange>& get_draw_ranges() const;
+  // Instances of each mesh, indexed by MeshTypes, material is that of the
+  // mesh's first draw range. Meshes past the end or with a zero count have
+  // no instances.
+  const std::vector<DrawRange>& get_mesh_ranges() const;
+  glm::mat4 get_model(uint32_t index) const;
+
+  std::vector<glm::vec3>         positions;
+  std::vector<glm::quat>         rotations;
+  std::vector<glm::vec3>         scales;
+  std::vector<vkMesh::MeshTypes> meshes;
+  std::vector<uint32_t>          materials;
+  std::vector<uint32_t>          flags;
+  // World space bounding sphere, updated by flush.
+  std::vector<glm::vec4>         bounds;
+
+ private:
+  void swap_instances(uint32_t a, uint32_t b);
+  glm::vec4 get_world_bounds(uint32_t index) const;
+
+ private:
+  // Slot map, slots are recycled with a bumped generation.
+  std::vector<uint32_t>  mSlotIndex;
+  std::vector<uint32_t>  mSlotGeneration;
+  std::vector<uint32_t>  mFreeSlots;
+  // Slot of each instance, parallel to the arrays.
+  std::vector<uint32_t>  mInstanceSlot;
+
+  std::vector<DrawRange> mDrawRanges;
+  std::vector<DrawRange> mMeshRanges;
+  bool                   mDirty = false;
+  uint64_t               mVersion = 0;
+  std::vector<uint32_t>  mChanged;
+
+  std::unordered_map<vkMesh::MeshTypes, glm::vec4> mMeshBounds;
+  vkUtil::Bvh            mBvh;
+  // Instances moved since the last flush.
+  std::vector<uint32_t>  mMoved;
 };
 
 #endif  // INC_SCENE_H_
@@ -0,0 +1,86 @@
+// Copyright (c) 2024 Meerkat
+#ifndef INC_SOFTWAREOCCLUSION_H_
+#define INC_SOFTWAREOCCLUSION_H_
+
+#include "CommonMath.h"
+#include <vector>
+
+namespace vkUtil {
+
+// Object space triangles of an occluder, positions only.
+struct OccluderMesh {
+  std::vector<glm::vec3> positions;
+  std::vector<Index>     indices;
+};
+
+// Low resolution depth buffer the CPU rasterizes occluders into, then tests
+// instance bounds against, for the CPU recorded path. Depth runs from 0 near
+// to 1 far like the depth attachment and each pixel keeps its nearest
+// occluder. Rows are shaded eight pixels per iteration with the widest
+// vector unit available, and every tile caches its farthest pixel so most
+// tests read one value per tile.
+//
+// A frame is begin, add_occluder per occluder, rasterize of every band, then
+// is_occluded. Bands are independent and is_occluded only reads, so both
+// may run on several threads.
+class OcclusionBuffer {
+ public:
+  static constexpr uint32_t sTileSize = 8;
+
+  // Rounded up to whole tiles, contents are lost.
+  void resize(uint32_t width, uint32_t height);
+  uint32_t get_width() const;
+  uint32_t get_height() const;
+  // Rows of tiles, the unit rasterize works on.
+  uint32_t get_band_count() const;
+  size_t get_triangle_count() const;
+
+  void begin(const glm::mat4& viewProjection);
+  // Clips the triangles to the near plane and sets them up in screen space.
+  void add_occluder(const OccluderMesh& mesh, const glm::mat4& model);
+  // Clears the band, draws the occluders into it and refreshes its tiles.
+  void rasterize(uint32_t band);
+  // True if the box around the sphere, center in xyz and radius in w, is
+  // behind the occluders everywhere it covers the buffer.
+  bool is_occluded(const glm::vec4& sphere) const;
+
+  // Screen space triangle, pixel centers at half integers.
+  struct Triangle {
+    // Edge functions a * x + b * y + c, not negative inside.
+    float   edgeA[3];
+    float   edgeB[3];
+    float   edgeC[3];
+    // Depth plane depthA * x + depthB * y + depthC.
+    float   depthA;
+    float   depthB;
+    float   depthC;
+    // Inclusive pixel bounds, clamped to the buffer.
+    int32_t minX;
+    int32_t minY;
+    int32_t maxX;
+    int32_t maxY;
+  };
+
+ private:
+  // Takes clip space vertices in front of the near plane.
+  void setup_triangle(
+    const glm::vec4& a,
+    const glm::vec4& b,
+    const glm::vec4& c
+  );
+
+ private:
+  uint32_t              mWidth  = 0;
+  uint32_t              mHeight = 0;
+  uint32_t              mTilesX = 0;
+  uint32_t              mTilesY = 0;
+  glm::mat4             mViewProjection = glm::mat4(1.0f);
+  std::vector<float>    mDepth;
+  // Farthest depth of each tile.
+  std::vector<float>    mTileDepth;
+  std::vector<Triangle> mTriangles;
+};
+
+}  // namespace vkUtil
+
+#endif  // INC_SOFTWAREOCCLUSION_H_
@@ -148,10 +148,13 @@ inline vk::Extent2D choose_swapchain_extent(
   return result;
 }
 
+// oldSwapchain, when given, is retired by the new one: its images not yet
+// acquired are released and the driver may reuse its resources. The caller
+// still destroys it once no frame in flight presents from it.
 inline SwapChainBundle create_swapchain(
   vk::PhysicalDevice physicalDevice, vk::Device device,
   vk::SurfaceKHR surface, uint32_t width, uint32_t height,
-  bool debug) {
+  vk::SwapchainKHR oldSwapchain, bool debug) {
   SwapChainSupportDetails support =
     query_swap_chain_support(physicalDevice, surface, debug);
 
@@ -195,7 +198,7 @@ inline SwapChainBundle create_swapchain(
   createInfo.presentMode = presentMode;
   createInfo.clipped = VK_TRUE;
 
-  createInfo.oldSwapchain = vk::SwapchainKHR(nullptr);
+  createInfo.oldSwapchain = oldSwapchain;
 
   SwapChainBundle bundle{};
   try {
@@ -2,17 +2,31 @@
 #define INC_TEXTURE_H_
 
 #include "Common.h"
+#include "Image.h"
+#include "MipChain.h"
+#include <optional>
+
+namespace vkUtil {
+class DeletionQueue;
+}
 
 namespace vkImage {
 
+class TextureRegistry;
+class SamplerCache;
+
 struct TextureInputChunk {
   vk::Device              device;
   vk::PhysicalDevice      physicalDevice;
   const char*             filename;
   vk::CommandBuffer       commandBuffer;
   vk::Queue               queue;
-  vk::DescriptorSetLayout layout;
-  vk::DescriptorPool      descriptorPool;
+  TextureRegistry*        registry;
+  SamplerCache*           samplerCache;
+  // Largest side of the finest mip uploaded by init, 0 uploads every level.
+  uint32_t                coarseExtent;
+  // Logs the format and size each texture is stored with.
+  bool                    debug = false;
 };
 
 class Texture {
@@ -21,35 +35,88 @@ class Texture {
   ~Texture();
 
   void init(const TextureInputChunk& input);
-  void use(vk::CommandBuffer commandBuffer, vk::PipelineLayout pipelineLayout);
+
+  // Slot of this texture in the bindless texture array.
+  // Bindless slot, empty when the registry was full at init.
+  std::optional<uint32_t> get_index() const;
+
+  // Bytes saved on the device compared to uploading the texture as RGBA8.
+  size_t get_memory_savings() const;
+
+  // Mip residency. The device image only holds the levels
+  // [residentMip, mipLevels), coarser levels than coarseMip are never evicted.
+  const char* get_filename() const;
+  vk::Extent2D get_extent() const;
+  uint32_t get_mip_levels() const;
+  uint32_t get_resident_mip() const;
+  uint32_t get_coarse_mip() const;
+  size_t get_level_size(uint32_t level) const;
+  size_t get_resident_size(uint32_t residentMip) const;
+
+  // Records the move to a new image holding [residentMip, mipLevels). Levels
+  // already resident are copied on the device, finer ones are read from
+  // staging, tightly packed from stagingOffset with each level aligned to
+  // get_staging_alignment().
+  void record_residency_change(
+    vk::CommandBuffer commandBuffer,
+    uint32_t residentMip,
+    vk::Buffer staging,
+    vk::DeviceSize stagingOffset
+  );
+  // Swaps in the image recorded above once its commands have completed. The
+  // previous image and bindless slot are retired through deletionQueue. With
+  // no free slot for the new image the change is dropped instead.
+  void commit_residency_change(vkUtil::DeletionQueue* deletionQueue);
+  vk::DeviceSize get_staging_alignment() const;
 
  private:
-  void load();
+  void load(uint32_t coarseExtent);
   void populate();
   void make_view();
   void make_sampler();
-  void make_descriptor_set();
+  void register_texture();
+  ImageInputChunk make_image_input(uint32_t residentMip) const;
+  void record_upload(
+    vk::CommandBuffer commandBuffer,
+    vk::Image image,
+    uint32_t imageBaseMip,
+    uint32_t firstLevel,
+    uint32_t lastLevel,
+    vk::Buffer staging,
+    vk::DeviceSize stagingOffset
+  );
 
  private:
-  using stbi_uc = unsigned char;
   uint32_t                mWidth    = 0;
   uint32_t                mHeight   = 0;
   uint32_t                mChannels = 0;
+  uint32_t                mBytesPerPixel = 4;
+  vk::Format              mFormat   = vk::Format::eR8G8B8A8Unorm;
+  vk::ComponentMapping    mSwizzle;
   vk::Device              mDevice;
   vk::PhysicalDevice      mPhysicalDevice;
   const char*             mFilename;
-  stbi_uc*                mPixels;
+  bool                    mHasDebug = false;
+  MipChain                mMipChain;
 
   // Resources
+  uint32_t                mMipLevels   = 1;
+  uint32_t                mCoarseMip   = 0;
+  uint32_t                mResidentMip = 0;
   vk::Image               mImage;
   vk::DeviceMemory        mImageMemory;
   vk::ImageView           mImageView;
   vk::Sampler             mSampler;
+  SamplerCache*           mSamplerCache = nullptr;
+
+  // Residency change waiting for its transfer to complete
+  uint32_t                mPendingMip = 0;
+  vk::Image               mPendingImage;
+  vk::DeviceMemory        mPendingImageMemory;
 
   // Resource descriptors
-  vk::DescriptorSetLayout mLayout;
-  vk::DescriptorSet       mDescriptorSet;
-  vk::DescriptorPool      mDescriptorPool;
+  TextureRegistry*        mRegistry = nullptr;
+  std::optional<uint32_t> mIndex;
 
   vk::CommandBuffer       mCommandBuffer;
   vk::Queue               mQueue;
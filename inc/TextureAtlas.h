@@ -0,0 +1,94 @@
+// Copyright (c) 2024 Meerkat
+#ifndef INC_TEXTUREATLAS_H_
+#define INC_TEXTUREATLAS_H_
+
+#include "Common.h"
+#include <optional>
+#include <vector>
+
+namespace vkImage {
+
+class TextureRegistry;
+class SamplerCache;
+
+struct TextureAtlasInputChunk {
+  vk::Device         device;
+  vk::PhysicalDevice physicalDevice;
+  vk::CommandBuffer  commandBuffer;
+  vk::Queue          queue;
+  TextureRegistry*   registry;
+  SamplerCache*      samplerCache;
+  // Textures with both sides up to this size are packed.
+  uint32_t           maxExtent;
+  // Logs the packed size.
+  bool               debug = false;
+};
+
+// Packs small material textures into a single RGBA8 image behind one bindless
+// slot. Each region is surrounded by a one texel gutter replicating its edges
+// so filtering does not bleed between neighbours. Regions have no mips, draws
+// set DRAW_FLAG_ATLAS so repeating coordinates wrap inside their region.
+class TextureAtlas {
+ public:
+  TextureAtlas();
+  ~TextureAtlas();
+
+  void init(const TextureAtlasInputChunk& input);
+
+  // Whether filename is small enough to be packed.
+  bool accepts(const char* filename) const;
+
+  // Queues filename for packing, returns its region.
+  uint32_t add(const char* filename);
+
+  // Packs the queued textures and uploads the atlas. Called once, after the
+  // last add.
+  void finalize();
+
+  // Bindless slot, empty when the registry was full at finalize.
+  std::optional<uint32_t> get_index() const;
+  size_t get_region_count() const;
+
+  // Scale in xy and offset in zw taking a region's texture coordinates into
+  // the atlas.
+  glm::vec4 get_uv_transform(uint32_t region) const;
+
+ private:
+  struct Region {
+    uint32_t                   width;
+    uint32_t                   height;
+    uint32_t                   x;
+    uint32_t                   y;
+    std::vector<unsigned char> texels;
+  };
+
+  void pack();
+  void populate();
+
+ private:
+  static constexpr uint32_t sGutter = 1;
+
+  vk::Device              mDevice;
+  vk::PhysicalDevice      mPhysicalDevice;
+  vk::CommandBuffer       mCommandBuffer;
+  vk::Queue               mQueue;
+  TextureRegistry*        mRegistry     = nullptr;
+  SamplerCache*           mSamplerCache = nullptr;
+  uint32_t                mMaxExtent    = 0;
+  bool                    mHasDebug     = false;
+
+  std::vector<Region>     mRegions;
+  uint32_t                mWidth  = 0;
+  uint32_t                mHeight = 0;
+
+  // Resources
+  vk::Image               mImage;
+  vk::DeviceMemory        mImageMemory;
+  vk::ImageView           mImageView;
+  vk::Sampler             mSampler;
+  std::optional<uint32_t> mIndex;
+};
+
+}  // namespace vkImage
+
+#endif  // INC_TEXTUREATLAS_H_
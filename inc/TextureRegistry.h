@@ -0,0 +1,61 @@
+// Copyright (c) 2024 Meerkat
+#ifndef INC_TEXTUREREGISTRY_H_
+#define INC_TEXTUREREGISTRY_H_
+
+#include "Common.h"
+#include <optional>
+#include <vector>
+
+namespace vkImage {
+
+struct TextureRegistryInputChunk {
+  vk::Device device;
+  uint32_t   maxTextures;
+};
+
+// Owns the single bindless descriptor set shared by every material. Binding 0
+// is a partially bound array of 2D textures indexed by material, binding 1 is
+// the environment cubemap.
+class TextureRegistry {
+ public:
+  TextureRegistry();
+  ~TextureRegistry();
+
+  void init(const TextureRegistryInputChunk& input, bool debug);
+
+  // Empty when every slot is taken, a live slot is never handed out twice.
+  std::optional<uint32_t> register_texture(
+    vk::ImageView imageView,
+    vk::Sampler sampler
+  );
+  // The slot must no longer be referenced by frames in flight.
+  void release_texture(uint32_t index);
+  void set_environment(vk::ImageView imageView, vk::Sampler sampler);
+  void use(vk::CommandBuffer commandBuffer,
+           vk::PipelineLayout pipelineLayout) const;
+
+  vk::DescriptorSetLayout get_layout() const;
+  vk::DescriptorSet get_descriptor_set() const;
+
+ private:
+  void write_descriptor(
+    uint32_t binding,
+    uint32_t arrayElement,
+    vk::ImageView imageView,
+    vk::Sampler sampler
+  );
+
+ private:
+  vk::Device              mDevice;
+  uint32_t                mMaxTextures  = 0;
+  uint32_t                mTextureCount = 0;
+  std::vector<uint32_t>   mFreeSlots;
+
+  vk::DescriptorSetLayout mLayout;
+  vk::DescriptorPool      mDescriptorPool;
+  vk::DescriptorSet       mDescriptorSet;
+};
+
+}  // namespace vkImage
+
+#endif  // INC_TEXTUREREGISTRY_H_
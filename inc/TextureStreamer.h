@@ -0,0 +1,113 @@
+// Copyright (c) 2024 Meerkat
+#ifndef INC_TEXTURESTREAMER_H_
+#define INC_TEXTURESTREAMER_H_
+
+#include "Common.h"
+#include "Memory.h"
+#include "MipChain.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace vkUtil {
+class DeletionQueue;
+}
+
+namespace vkImage {
+
+class Texture;
+
+struct TextureStreamerInputChunk {
+  vk::Device             device;
+  vk::PhysicalDevice     physicalDevice;
+  vk::SurfaceKHR         surface;
+  vk::Queue              queue;
+  vkUtil::DeletionQueue* deletionQueue;
+  // Device memory the streamed mips may take, coarse mips included.
+  size_t                 budget;
+};
+
+// Keeps the mip residency of registered textures in line with how large they
+// appear on screen. Finer mips are decoded on a worker thread and uploaded in
+// batches on the render thread, coarser ones are dropped when the budget is
+// exceeded, lowest priority first.
+class TextureStreamer {
+ public:
+  TextureStreamer();
+  ~TextureStreamer();
+
+  void init(const TextureStreamerInputChunk& input, bool debug);
+  void destroy();
+
+  void add(Texture* texture);
+  void set_budget(size_t budget);
+
+  // Projected size, in pixels, of the largest instance using the texture this
+  // frame. Cleared by update.
+  void request(Texture* texture, float screenSize);
+
+  // Render thread, once per frame. True when a batch was committed, which
+  // moves its textures to new bindless slots.
+  bool update();
+
+  size_t get_resident_size() const;
+
+ private:
+  struct TextureState {
+    float    screenSize = 0.0f;
+    uint32_t targetMip  = 0;
+    bool     loading    = false;
+  };
+
+  struct LoadRequest {
+    Texture*    texture;
+    const char* filename;
+    uint32_t    firstLevel;
+    uint32_t    lastLevel;
+    float       priority;
+  };
+
+  struct LoadResult {
+    Texture* texture;
+    MipChain mipChain;
+  };
+
+  void work();
+  void choose_targets();
+  uint32_t desired_mip(const Texture* texture, float screenSize) const;
+  void finish_batch();
+  void submit_batch();
+
+ private:
+  bool                   mHasDebug = false;
+  vk::Device             mDevice;
+  vk::PhysicalDevice     mPhysicalDevice;
+  vk::Queue              mQueue;
+  vkUtil::DeletionQueue* mDeletionQueue = nullptr;
+  size_t                 mBudget        = 0;
+
+  std::vector<Texture*>                      mTextures;
+  std::unordered_map<Texture*, TextureState> mStates;
+
+  // Worker thread
+  std::thread              mWorker;
+  std::mutex               mMutex;
+  std::condition_variable  mWakeUp;
+  bool                     mRunning = false;
+  std::vector<LoadRequest> mRequests;
+  std::vector<LoadResult>  mResults;
+
+  // Transfer batch in flight
+  vk::CommandPool          mCommandPool;
+  vk::CommandBuffer        mCommandBuffer;
+  vk::Fence                mBatchFence;
+  bool                     mBatchInFlight = false;
+  std::vector<Texture*>    mBatch;
+  vkUtil::Buffer           mStagingBuffer {};
+};
+
+}  // namespace vkImage
+
+#endif  // INC_TEXTURESTREAMER_H_
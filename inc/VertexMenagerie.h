@@ -27,12 +27,23 @@ class VertexMenagerie {
     const std::vector<Index>& indices);
   void finalize(const FinalizationChunk& input);
   const vkUtil::Buffer& getVertexBuffer();
+  // Positions alone, a third of the interleaved vertex size, for passes
+  // that only need depth.
+  const vkUtil::Buffer& getPositionBuffer();
   const vkUtil::Buffer& getIndexBuffer();
   uint32_t getOffset(vkMesh::MeshTypes type) const;
   uint32_t getSize(vkMesh::MeshTypes type) const;
 
+ private:
+  vkUtil::Buffer upload(
+    const FinalizationChunk& input,
+    const void* data,
+    size_t size,
+    vk::BufferUsageFlags usage);
+
  private:
   vkUtil::Buffer                                  mVertexBuffer;
+  vkUtil::Buffer                                  mPositionBuffer;
   vkUtil::Buffer                                  mIndexBuffer;
   std::unordered_map<vkMesh::MeshTypes, uint32_t> mFirstIndices;
   std::unordered_map<vkMesh::MeshTypes, uint32_t> mIndexCounts;
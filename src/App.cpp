@@ -3,12 +3,19 @@
 #include <algorithm>
 #include <sstream>
 
-App::App(uint32_t width, uint32_t height, bool debug) {
+App::App(
+  uint32_t width,
+  uint32_t height,
+  bool debug,
+  size_t textureBudget
+) {
   build_glfw_window(width, height, debug);
   mGraphicsEngine = new Engine();
+  mGraphicsEngine->set_texture_budget(textureBudget);
   mGraphicsEngine->init(width, height, mWindow, debug);
   mScene = new Scene();
   mScene->init();
+  mGraphicsEngine->load_scene(mScene);
 }
 
 App::~App() {
@@ -41,19 +48,45 @@ void App::build_glfw_window(uint32_t width, uint32_t height, bool debug) {
 void App::run() {
   while (!glfwWindowShouldClose(mWindow)) {
     glfwPollEvents();
+    handle_input();
     mGraphicsEngine->render(mScene);
     calculate_frame_rate();
   }
 }
 
+void App::handle_input() {
+  // P toggles the depth prepass, on release so holding it flips it once.
+  bool prepassKeyDown = glfwGetKey(mWindow, GLFW_KEY_P) == GLFW_PRESS;
+  if (mPrepassKeyDown && !prepassKeyDown) {
+    mGraphicsEngine->set_depth_prepass(
+      !mGraphicsEngine->get_depth_prepass());
+  }
+  mPrepassKeyDown = prepassKeyDown;
+}
+
 void App::calculate_frame_rate() {
   mCurrentTime = glfwGetTime();
   double delta = mCurrentTime - mLastTime;
 
   if (delta >= 1.0) {
     int32_t framerate = std::max(1, static_cast<int32_t>(mNumFrames / delta));
+    const vkUtil::CullCounters& cull = mGraphicsEngine->get_cull_stats();
     std::stringstream title;
-    title << "Running at " << framerate << " fps.";
+    title << "Running at " << framerate << " fps, GPU "
+          << mGraphicsEngine->get_gpu_time() << " ms"
+          << (mGraphicsEngine->get_depth_prepass() ? " with" : " without")
+          << " depth prepass, "
+          << cull.frustumCulled + cull.occlusionCulled << " culled ("
+          << cull.occlusionCulled << " occluded), ";
+    // Bind counts only exist for the CPU recorded draws.
+    if (mGraphicsEngine->get_gpu_driven()) {
+      title << "GPU driven draws.";
+    } else {
+      const vkUtil::DrawStats& draws = mGraphicsEngine->get_draw_stats();
+      title << draws.draws << " draws, "
+            << draws.pipelineBinds << " pipeline and "
+            << draws.descriptorBinds << " descriptor binds.";
+    }
     glfwSetWindowTitle(mWindow, title.str().c_str());
     mLastTime = mCurrentTime;
     mNumFrames = -1;
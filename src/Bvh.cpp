@@ -0,0 +1,479 @@
+// Copyright (c) 2024 Meerkat
+#include "../inc/Bvh.h"
+#include "../inc/Culling.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace {
+
+// Nodes with this many items or fewer are always leaves, nodes with more
+// than sMaxLeafItems are always split.
+constexpr uint32_t sMinLeafItems = 2;
+constexpr uint32_t sMaxLeafItems = 8;
+constexpr int      sBinCount     = 16;
+// Cost of visiting a node relative to testing one item.
+constexpr float    sTraversalCost = 1.0f;
+
+float surface_area(const glm::vec3& min, const glm::vec3& max) {
+  const glm::vec3 extent = max - min;
+  return 2.0f * (extent.x * extent.y + extent.y * extent.z
+                 + extent.z * extent.x);
+}
+
+struct Bin {
+  glm::vec3 min   = glm::vec3(std::numeric_limits<float>::max());
+  glm::vec3 max   = glm::vec3(-std::numeric_limits<float>::max());
+  uint32_t  count = 0;
+
+  void grow(const glm::vec4& sphere) {
+    min = glm::min(min, glm::vec3(sphere) - sphere.w);
+    max = glm::max(max, glm::vec3(sphere) + sphere.w);
+    ++count;
+  }
+
+  void grow(const Bin& other) {
+    min = glm::min(min, other.min);
+    max = glm::max(max, other.max);
+    count += other.count;
+  }
+};
+
+int bin_index(float centroid, float minCentroid, float scale) {
+  return std::min(
+    sBinCount - 1, static_cast<int>((centroid - minCentroid) * scale));
+}
+
+// Entry distance of the ray into the box, or infinity if it misses.
+float intersect_box(
+  const glm::vec3& origin,
+  const glm::vec3& inverseDirection,
+  const glm::vec3& min,
+  const glm::vec3& max,
+  float maxDistance
+) {
+  const glm::vec3 t0 = (min - origin) * inverseDirection;
+  const glm::vec3 t1 = (max - origin) * inverseDirection;
+  const glm::vec3 tNear = glm::min(t0, t1);
+  const glm::vec3 tFar  = glm::max(t0, t1);
+  const float enter = std::max(std::max(tNear.x, tNear.y), tNear.z);
+  const float exit  = std::min(std::min(tFar.x, tFar.y), tFar.z);
+
+  if (exit < std::max(enter, 0.0f) || enter > maxDistance) {
+    return std::numeric_limits<float>::infinity();
+  }
+  return std::max(enter, 0.0f);
+}
+
+}  // namespace
+
+void vkUtil::Bvh::build(const std::vector<glm::vec4>& spheres) {
+  clear();
+
+  const uint32_t count = static_cast<uint32_t>(spheres.size());
+  if (count == 0) {
+    return;
+  }
+
+  // Spheres are partitioned along with their indices, so every pass over a
+  // node reads them contiguously.
+  mItemIndex.resize(count);
+  std::iota(mItemIndex.begin(), mItemIndex.end(), 0);
+  mItemSpheres = spheres;
+
+  mNodes.reserve(2 * count);
+  mParents.reserve(2 * count);
+  mNodes.push_back({ glm::vec3(0.0f), 0, glm::vec3(0.0f), count });
+  mParents.push_back(0);
+
+  std::vector<uint32_t> stack = { 0 };
+  while (!stack.empty()) {
+    uint32_t node = stack.back();
+    stack.pop_back();
+
+    if (subdivide(node)) {
+      stack.push_back(mNodes[node].first);
+      stack.push_back(mNodes[node].first + 1);
+    }
+  }
+
+  mItemSlot.resize(count);
+  mItemLeaf.resize(count);
+  for (uint32_t k = 0; k < count; ++k) {
+    mItemSlot[mItemIndex[k]] = k;
+  }
+  for (uint32_t node = 0; node < mNodes.size(); ++node) {
+    for (uint32_t k = 0; k < mNodes[node].count; ++k) {
+      mItemLeaf[mItemIndex[mNodes[node].first + k]] = node;
+    }
+  }
+}
+
+bool vkUtil::Bvh::subdivide(uint32_t node) {
+  const uint32_t first = mNodes[node].first;
+  const uint32_t count = mNodes[node].count;
+
+  Bin bounds;
+  glm::vec3 minCentroid(std::numeric_limits<float>::max());
+  glm::vec3 maxCentroid(-std::numeric_limits<float>::max());
+  for (uint32_t k = first; k < first + count; ++k) {
+    const glm::vec4& sphere = mItemSpheres[k];
+    bounds.grow(sphere);
+    minCentroid = glm::min(minCentroid, glm::vec3(sphere));
+    maxCentroid = glm::max(maxCentroid, glm::vec3(sphere));
+  }
+  mNodes[node].min = bounds.min;
+  mNodes[node].max = bounds.max;
+
+  if (count <= sMinLeafItems) {
+    return false;
+  }
+
+  // Bin every axis in one pass over the items, then take the cheapest
+  // split over all of them.
+  glm::vec3 scale;
+  for (int axis = 0; axis < 3; ++axis) {
+    const float extent = maxCentroid[axis] - minCentroid[axis];
+    scale[axis] = extent > 0.0f ? sBinCount / extent : 0.0f;
+  }
+
+  Bin bins[3][sBinCount];
+  for (uint32_t k = first; k < first + count; ++k) {
+    const glm::vec4& sphere = mItemSpheres[k];
+    for (int axis = 0; axis < 3; ++axis) {
+      bins[axis][bin_index(sphere[axis], minCentroid[axis], scale[axis])]
+        .grow(sphere);
+    }
+  }
+
+  int   bestAxis = -1;
+  int   bestBin  = 0;
+  float bestCost = std::numeric_limits<float>::max();
+  for (int axis = 0; axis < 3; ++axis) {
+    if (scale[axis] == 0.0f) {
+      continue;
+    }
+
+    // Cost of splitting after bin i, left sweep then right sweep.
+    float leftCost[sBinCount - 1];
+    Bin left;
+    for (int i = 0; i < sBinCount - 1; ++i) {
+      left.grow(bins[axis][i]);
+      leftCost[i] = left.count ? left.count * surface_area(left.min, left.max)
+                               : 0.0f;
+    }
+    Bin right;
+    for (int i = sBinCount - 1; i > 0; --i) {
+      right.grow(bins[axis][i]);
+      float cost = leftCost[i - 1]
+        + (right.count ? right.count * surface_area(right.min, right.max)
+                       : 0.0f);
+      if (cost < bestCost) {
+        bestCost = cost;
+        bestAxis = axis;
+        bestBin  = i - 1;
+      }
+    }
+  }
+
+  const float area = surface_area(bounds.min, bounds.max);
+  const float leafCost = count * area;
+  const float splitCost = sTraversalCost * area + bestCost;
+  if (splitCost >= leafCost && count <= sMaxLeafItems) {
+    return false;
+  }
+
+  uint32_t leftCount = 0;
+  if (bestAxis >= 0) {
+    uint32_t i = first;
+    uint32_t j = first + count;
+    while (i < j) {
+      if (bin_index(mItemSpheres[i][bestAxis],
+                    minCentroid[bestAxis],
+                    scale[bestAxis]) <= bestBin) {
+        ++i;
+      } else {
+        --j;
+        std::swap(mItemSpheres[i], mItemSpheres[j]);
+        std::swap(mItemIndex[i], mItemIndex[j]);
+      }
+    }
+    leftCount = i - first;
+  }
+  if (leftCount == 0 || leftCount == count) {
+    // Every centroid fell in the same bin, split the range in half.
+    leftCount = count / 2;
+  }
+
+  const uint32_t left = static_cast<uint32_t>(mNodes.size());
+  mNodes.push_back({ glm::vec3(0.0f), first, glm::vec3(0.0f), leftCount });
+  mNodes.push_back({ glm::vec3(0.0f), first + leftCount, glm::vec3(0.0f),
+                     count - leftCount });
+  mParents.push_back(node);
+  mParents.push_back(node);
+
+  mNodes[node].first = left;
+  mNodes[node].count = 0;
+
+  return true;
+}
+
+void vkUtil::Bvh::refit(
+  const std::vector<glm::vec4>& spheres,
+  const std::vector<uint32_t>& moved
+) {
+  if (moved.size() > mItemIndex.size() / 8) {
+    refit(spheres);
+    return;
+  }
+
+  for (uint32_t item : moved) {
+    mItemSpheres[mItemSlot[item]] = spheres[item];
+
+    uint32_t node = mItemLeaf[item];
+    fit_leaf(node);
+    while (node != 0) {
+      node = mParents[node];
+      fit_inner(node);
+    }
+  }
+}
+
+void vkUtil::Bvh::refit(const std::vector<glm::vec4>& spheres) {
+  for (uint32_t k = 0; k < mItemIndex.size(); ++k) {
+    mItemSpheres[k] = spheres[mItemIndex[k]];
+  }
+
+  // Children are always stored after their parent.
+  for (size_t node = mNodes.size(); node-- > 0;) {
+    if (mNodes[node].count) {
+      fit_leaf(static_cast<uint32_t>(node));
+    } else {
+      fit_inner(static_cast<uint32_t>(node));
+    }
+  }
+}
+
+void vkUtil::Bvh::clear() {
+  mNodes.clear();
+  mParents.clear();
+  mItemSpheres.clear();
+  mItemIndex.clear();
+  mItemSlot.clear();
+  mItemLeaf.clear();
+}
+
+void vkUtil::Bvh::fit_leaf(uint32_t node) {
+  Bin bounds;
+  for (uint32_t k = 0; k < mNodes[node].count; ++k) {
+    bounds.grow(mItemSpheres[mNodes[node].first + k]);
+  }
+  mNodes[node].min = bounds.min;
+  mNodes[node].max = bounds.max;
+}
+
+void vkUtil::Bvh::fit_inner(uint32_t node) {
+  const Node& left  = mNodes[mNodes[node].first];
+  const Node& right = mNodes[mNodes[node].first + 1];
+  mNodes[node].min = glm::min(left.min, right.min);
+  mNodes[node].max = glm::max(left.max, right.max);
+}
+
+void vkUtil::Bvh::append_subtree(
+  uint32_t node,
+  std::vector<uint32_t>* items
+) const {
+  // Subtree items are contiguous, from the first item of the leftmost leaf
+  // to the last item of the rightmost one.
+  uint32_t leftmost = node;
+  while (!mNodes[leftmost].count) {
+    leftmost = mNodes[leftmost].first;
+  }
+  uint32_t rightmost = node;
+  while (!mNodes[rightmost].count) {
+    rightmost = mNodes[rightmost].first + 1;
+  }
+
+  items->insert(
+    items->end(),
+    mItemIndex.begin() + mNodes[leftmost].first,
+    mItemIndex.begin() + mNodes[rightmost].first + mNodes[rightmost].count);
+}
+
+void vkUtil::Bvh::query_frustum(
+  const std::array<glm::vec4, 6>& planes,
+  std::vector<uint32_t>* items
+) const {
+  if (mNodes.empty()) {
+    return;
+  }
+
+  // Items of the leaves crossing a plane, tested together at the end.
+  InstanceBounds candidates;
+  std::vector<uint32_t> candidateItems;
+
+  std::vector<uint32_t> stack = { 0 };
+  while (!stack.empty()) {
+    const uint32_t index = stack.back();
+    stack.pop_back();
+    const Node& node = mNodes[index];
+
+    // Farthest corner along each plane normal decides rejection, the
+    // nearest decides whether the whole box is inside.
+    bool outside = false;
+    bool inside  = true;
+    for (const glm::vec4& plane : planes) {
+      const glm::vec3 normal(plane);
+      const glm::vec3 far = glm::mix(
+        node.min, node.max, glm::greaterThanEqual(normal, glm::vec3(0.0f)));
+      const glm::vec3 near = glm::mix(
+        node.max, node.min, glm::greaterThanEqual(normal, glm::vec3(0.0f)));
+      if (glm::dot(normal, far) + plane.w < 0.0f) {
+        outside = true;
+        break;
+      }
+      inside = inside && glm::dot(normal, near) + plane.w >= 0.0f;
+    }
+
+    if (outside) {
+      continue;
+    }
+    if (inside) {
+      append_subtree(index, items);
+      continue;
+    }
+    if (!node.count) {
+      stack.push_back(node.first);
+      stack.push_back(node.first + 1);
+      continue;
+    }
+
+    for (uint32_t k = node.first; k < node.first + node.count; ++k) {
+      candidates.push_back(glm::vec3(mItemSpheres[k]), mItemSpheres[k].w);
+      candidateItems.push_back(mItemIndex[k]);
+    }
+  }
+
+  std::vector<uint32_t> visible;
+  visible.reserve(candidates.size());
+  cull_spheres(planes, candidates, &visible);
+  for (uint32_t candidate : visible) {
+    items->push_back(candidateItems[candidate]);
+  }
+}
+
+void vkUtil::Bvh::query_sphere(
+  const glm::vec3& center,
+  float radius,
+  std::vector<uint32_t>* items
+) const {
+  if (mNodes.empty()) {
+    return;
+  }
+
+  std::vector<uint32_t> stack = { 0 };
+  while (!stack.empty()) {
+    const Node& node = mNodes[stack.back()];
+    stack.pop_back();
+
+    const glm::vec3 closest = glm::clamp(center, node.min, node.max);
+    const glm::vec3 offset = closest - center;
+    if (glm::dot(offset, offset) > radius * radius) {
+      continue;
+    }
+    if (!node.count) {
+      stack.push_back(node.first);
+      stack.push_back(node.first + 1);
+      continue;
+    }
+
+    for (uint32_t k = node.first; k < node.first + node.count; ++k) {
+      const glm::vec4& sphere = mItemSpheres[k];
+      const glm::vec3 between = glm::vec3(sphere) - center;
+      const float reach = radius + sphere.w;
+      if (glm::dot(between, between) <= reach * reach) {
+        items->push_back(mItemIndex[k]);
+      }
+    }
+  }
+}
+
+bool vkUtil::Bvh::raycast(
+  const glm::vec3& origin,
+  const glm::vec3& direction,
+  float maxDistance,
+  uint32_t* item,
+  float* distance
+) const {
+  if (mNodes.empty()) {
+    return false;
+  }
+
+  const glm::vec3 inverseDirection = 1.0f / direction;
+  float closest = maxDistance;
+  bool hit = false;
+
+  std::vector<uint32_t> stack = { 0 };
+  while (!stack.empty()) {
+    const Node& node = mNodes[stack.back()];
+    stack.pop_back();
+
+    if (intersect_box(origin, inverseDirection, node.min, node.max, closest)
+        > closest) {
+      continue;
+    }
+
+    if (!node.count) {
+      // Visit the nearer child first so it can shorten the ray.
+      const Node& left  = mNodes[node.first];
+      const Node& right = mNodes[node.first + 1];
+      float leftEnter = intersect_box(
+        origin, inverseDirection, left.min, left.max, closest);
+      float rightEnter = intersect_box(
+        origin, inverseDirection, right.min, right.max, closest);
+      if (leftEnter <= rightEnter) {
+        stack.push_back(node.first + 1);
+        stack.push_back(node.first);
+      } else {
+        stack.push_back(node.first);
+        stack.push_back(node.first + 1);
+      }
+      continue;
+    }
+
+    for (uint32_t k = node.first; k < node.first + node.count; ++k) {
+      const glm::vec4& sphere = mItemSpheres[k];
+      const glm::vec3 offset = origin - glm::vec3(sphere);
+      const float b = glm::dot(offset, direction);
+      const float c = glm::dot(offset, offset) - sphere.w * sphere.w;
+      const float discriminant = b * b - c;
+      if (discriminant < 0.0f) {
+        continue;
+      }
+
+      const float root = std::sqrt(discriminant);
+      if (-b + root < 0.0f) {
+        continue;
+      }
+      // Zero when the ray starts inside the sphere.
+      const float t = std::max(-b - root, 0.0f);
+      if (t <= closest) {
+        closest   = t;
+        *item     = mItemIndex[k];
+        *distance = t;
+        hit       = true;
+      }
+    }
+  }
+
+  return hit;
+}
+
+size_t vkUtil::Bvh::get_node_count() const {
+  return mNodes.size();
+}
+
+size_t vkUtil::Bvh::size() const {
+  return mItemIndex.size();
+}
@@ -1,6 +1,7 @@
 #include "../inc/Cubemap.h"
 #include "../inc/Image.h"
-#include "../inc/Descriptors.h"
+#include "../inc/TextureRegistry.h"
+#include "../inc/SamplerCache.h"
 #include "../inc/Memory.h"
 #include "../ext/stb/stb_image.h"
 
@@ -11,7 +12,7 @@ vkImage::CubeMap::~CubeMap() {
   mDevice.freeMemory(mImageMemory);
   mDevice.destroyImage(mImage);
   mDevice.destroyImageView(mImageView);
-  mDevice.destroySampler(mSampler);
+  mSamplerCache->release(mSampler);
 }
 
 void vkImage::CubeMap::init(const CubeMapInputChunk& input) {
@@ -20,8 +21,8 @@ void vkImage::CubeMap::init(const CubeMapInputChunk& input) {
   mFilenames      = input.filenames;
   mCommandBuffer  = input.commandBuffer;
   mQueue          = input.queue;
-  mLayout         = input.layout;
-  mDescriptorPool = input.descriptorPool;
+  mRegistry       = input.registry;
+  mSamplerCache   = input.samplerCache;
 
   load();
 
@@ -49,18 +50,7 @@ void vkImage::CubeMap::init(const CubeMapInputChunk& input) {
 
   make_view();
   make_sampler();
-  make_descriptor_set();
-}
-
-void vkImage::CubeMap::use(vk::CommandBuffer commandBuffer,
-                           vk::PipelineLayout pipelineLayout) {
-  commandBuffer.bindDescriptorSets(
-    vk::PipelineBindPoint::eGraphics,
-    pipelineLayout,
-    1,
-    mDescriptorSet,
-    nullptr
-  );
+  register_environment();
 }
 
 void vkImage::CubeMap::load() {
@@ -176,35 +166,9 @@ void vkImage::CubeMap::make_sampler() {
   samplerInfo.minLod                  = 0.0f;
   samplerInfo.maxLod                  = 0.0f;
 
-  try {
-    mSampler = mDevice.createSampler(samplerInfo);
-  } catch (vk::SystemError err) {
-    printf("Error while creating image sampler. Error: %s\n",
-            err.what());
-  }
+  mSampler = mSamplerCache->acquire(samplerInfo);
 }
 
-void vkImage::CubeMap::make_descriptor_set() {
-  bool debug = true;
-  mDescriptorSet  = vkInit::allocate_descriptor_set(
-    mDevice,
-    mDescriptorPool,
-    mLayout,
-    debug
-  );
-
-  vk::DescriptorImageInfo imageDescriptor {};
-  imageDescriptor.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-  imageDescriptor.imageView   = mImageView;
-  imageDescriptor.sampler     = mSampler;
-
-  vk::WriteDescriptorSet descriptorWrite {};
-  descriptorWrite.dstSet          = mDescriptorSet;
-  descriptorWrite.dstBinding      = 0;
-  descriptorWrite.dstArrayElement = 0;
-  descriptorWrite.descriptorType  = vk::DescriptorType::eCombinedImageSampler;
-  descriptorWrite.descriptorCount = 1;
-  descriptorWrite.pImageInfo      = &imageDescriptor;
-
-  mDevice.updateDescriptorSets(1, &descriptorWrite, 0, nullptr);
+void vkImage::CubeMap::register_environment() {
+  mRegistry->set_environment(mImageView, mSampler);
 }
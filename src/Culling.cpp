@@ -0,0 +1,257 @@
+// Copyright (c) 2024 Meerkat
+#include "../inc/Culling.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CULLING_X86
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CULLING_NEON
+#endif
+
+namespace {
+
+constexpr size_t sLanes = 8;
+
+// Writes the indices of the set bits of mask, lane i being instance base + i.
+inline uint32_t* compact(uint32_t mask, uint32_t base, uint32_t* out) {
+  while (mask) {
+    *out++ = base + static_cast<uint32_t>(__builtin_ctz(mask));
+    mask &= mask - 1;
+  }
+  return out;
+}
+
+// Mask of the lanes of the block starting at first that hold instances.
+inline uint32_t valid_lanes(size_t first, size_t count) {
+  const size_t remaining = count - first;
+  return remaining >= sLanes ? 0xffu : (1u << remaining) - 1u;
+}
+
+#if defined(CULLING_X86)
+
+__attribute__((target("avx2")))
+uint32_t* cull_avx2(
+  const std::array<glm::vec4, 6>& planes,
+  const vkUtil::InstanceBounds& bounds,
+  uint32_t* out
+) {
+  __m256 nx[6], ny[6], nz[6], d[6];
+  for (int p = 0; p < 6; ++p) {
+    nx[p] = _mm256_set1_ps(planes[p].x);
+    ny[p] = _mm256_set1_ps(planes[p].y);
+    nz[p] = _mm256_set1_ps(planes[p].z);
+    d[p]  = _mm256_set1_ps(planes[p].w);
+  }
+
+  const size_t count = bounds.size();
+  for (size_t i = 0; i < count; i += sLanes) {
+    const __m256 x = _mm256_loadu_ps(bounds.x() + i);
+    const __m256 y = _mm256_loadu_ps(bounds.y() + i);
+    const __m256 z = _mm256_loadu_ps(bounds.z() + i);
+    const __m256 r = _mm256_sub_ps(
+      _mm256_setzero_ps(), _mm256_loadu_ps(bounds.radius() + i));
+
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (int p = 0; p < 6; ++p) {
+      __m256 distance = _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(nx[p], x), _mm256_mul_ps(ny[p], y)),
+        _mm256_add_ps(_mm256_mul_ps(nz[p], z), d[p]));
+      inside = _mm256_and_ps(
+        inside, _mm256_cmp_ps(distance, r, _CMP_GE_OQ));
+    }
+
+    uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(inside));
+    out = compact(mask & valid_lanes(i, count), static_cast<uint32_t>(i), out);
+  }
+
+  return out;
+}
+
+// Eight spheres as two halves of four.
+uint32_t* cull_sse2(
+  const std::array<glm::vec4, 6>& planes,
+  const vkUtil::InstanceBounds& bounds,
+  uint32_t* out
+) {
+  __m128 nx[6], ny[6], nz[6], d[6];
+  for (int p = 0; p < 6; ++p) {
+    nx[p] = _mm_set1_ps(planes[p].x);
+    ny[p] = _mm_set1_ps(planes[p].y);
+    nz[p] = _mm_set1_ps(planes[p].z);
+    d[p]  = _mm_set1_ps(planes[p].w);
+  }
+
+  const size_t count = bounds.size();
+  for (size_t i = 0; i < count; i += sLanes) {
+    uint32_t mask = 0;
+    for (size_t half = 0; half < sLanes; half += 4) {
+      const __m128 x = _mm_loadu_ps(bounds.x() + i + half);
+      const __m128 y = _mm_loadu_ps(bounds.y() + i + half);
+      const __m128 z = _mm_loadu_ps(bounds.z() + i + half);
+      const __m128 r = _mm_sub_ps(
+        _mm_setzero_ps(), _mm_loadu_ps(bounds.radius() + i + half));
+
+      __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+      for (int p = 0; p < 6; ++p) {
+        __m128 distance = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(nx[p], x), _mm_mul_ps(ny[p], y)),
+          _mm_add_ps(_mm_mul_ps(nz[p], z), d[p]));
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, r));
+      }
+      mask |= static_cast<uint32_t>(_mm_movemask_ps(inside)) << half;
+    }
+
+    out = compact(mask & valid_lanes(i, count), static_cast<uint32_t>(i), out);
+  }
+
+  return out;
+}
+
+#elif defined(CULLING_NEON)
+
+// Eight spheres as two halves of four.
+uint32_t* cull_neon(
+  const std::array<glm::vec4, 6>& planes,
+  const vkUtil::InstanceBounds& bounds,
+  uint32_t* out
+) {
+  float32x4_t nx[6], ny[6], nz[6], d[6];
+  for (int p = 0; p < 6; ++p) {
+    nx[p] = vdupq_n_f32(planes[p].x);
+    ny[p] = vdupq_n_f32(planes[p].y);
+    nz[p] = vdupq_n_f32(planes[p].z);
+    d[p]  = vdupq_n_f32(planes[p].w);
+  }
+
+  const uint32_t laneBitsData[4] = { 1, 2, 4, 8 };
+  const uint32x4_t laneBits = vld1q_u32(laneBitsData);
+
+  const size_t count = bounds.size();
+  for (size_t i = 0; i < count; i += sLanes) {
+    uint32_t mask = 0;
+    for (size_t half = 0; half < sLanes; half += 4) {
+      const float32x4_t x = vld1q_f32(bounds.x() + i + half);
+      const float32x4_t y = vld1q_f32(bounds.y() + i + half);
+      const float32x4_t z = vld1q_f32(bounds.z() + i + half);
+      const float32x4_t r = vnegq_f32(vld1q_f32(bounds.radius() + i + half));
+
+      uint32x4_t inside = vdupq_n_u32(0xffffffffu);
+      for (int p = 0; p < 6; ++p) {
+        float32x4_t distance = vmlaq_f32(d[p], nx[p], x);
+        distance = vmlaq_f32(distance, ny[p], y);
+        distance = vmlaq_f32(distance, nz[p], z);
+        inside = vandq_u32(inside, vcgeq_f32(distance, r));
+      }
+
+      uint32x4_t bits = vandq_u32(inside, laneBits);
+      uint32x2_t pairs = vorr_u32(vget_low_u32(bits), vget_high_u32(bits));
+      mask |= (vget_lane_u32(pairs, 0) | vget_lane_u32(pairs, 1)) << half;
+    }
+
+    out = compact(mask & valid_lanes(i, count), static_cast<uint32_t>(i), out);
+  }
+
+  return out;
+}
+
+#endif
+
+}  // namespace
+
+void vkUtil::InstanceBounds::clear() {
+  mX.clear();
+  mY.clear();
+  mZ.clear();
+  mRadius.clear();
+  mCount = 0;
+}
+
+void vkUtil::InstanceBounds::reserve(size_t count) {
+  const size_t padded = (count + sLanes - 1) / sLanes * sLanes;
+  mX.reserve(padded);
+  mY.reserve(padded);
+  mZ.reserve(padded);
+  mRadius.reserve(padded);
+}
+
+void vkUtil::InstanceBounds::push_back(const glm::vec3& center, float radius) {
+  if (mCount == mX.size()) {
+    mX.resize(mCount + sLanes, 0.0f);
+    mY.resize(mCount + sLanes, 0.0f);
+    mZ.resize(mCount + sLanes, 0.0f);
+    mRadius.resize(mCount + sLanes, 0.0f);
+  }
+
+  mX[mCount]      = center.x;
+  mY[mCount]      = center.y;
+  mZ[mCount]      = center.z;
+  mRadius[mCount] = radius;
+  ++mCount;
+}
+
+size_t vkUtil::InstanceBounds::size() const {
+  return mCount;
+}
+
+const float* vkUtil::InstanceBounds::x() const {
+  return mX.data();
+}
+
+const float* vkUtil::InstanceBounds::y() const {
+  return mY.data();
+}
+
+const float* vkUtil::InstanceBounds::z() const {
+  return mZ.data();
+}
+
+const float* vkUtil::InstanceBounds::radius() const {
+  return mRadius.data();
+}
+
+void vkUtil::cull_spheres_scalar(
+  const std::array<glm::vec4, 6>& planes,
+  const InstanceBounds& bounds,
+  std::vector<uint32_t>* visible
+) {
+  for (size_t i = 0; i < bounds.size(); ++i) {
+    const glm::vec3 center(bounds.x()[i], bounds.y()[i], bounds.z()[i]);
+    const float radius = bounds.radius()[i];
+
+    bool inside = true;
+    for (const glm::vec4& plane : planes) {
+      float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+      inside = inside && distance >= -radius;
+    }
+    if (inside) {
+      visible->push_back(static_cast<uint32_t>(i));
+    }
+  }
+}
+
+void vkUtil::cull_spheres(
+  const std::array<glm::vec4, 6>& planes,
+  const InstanceBounds& bounds,
+  std::vector<uint32_t>* visible
+) {
+#if defined(CULLING_X86) || defined(CULLING_NEON)
+  // Room for every instance, trimmed to the survivors afterwards.
+  const size_t first = visible->size();
+  visible->resize(first + bounds.size());
+  uint32_t* begin = visible->data() + first;
+
+#if defined(CULLING_X86)
+  static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+  uint32_t* end = hasAvx2
+    ? cull_avx2(planes, bounds, begin)
+    : cull_sse2(planes, bounds, begin);
+#else
+  uint32_t* end = cull_neon(planes, bounds, begin);
+#endif
+
+  visible->resize(first + static_cast<size_t>(end - begin));
+#else
+  cull_spheres_scalar(planes, bounds, visible);
+#endif
+}
@@ -0,0 +1,30 @@
+// Copyright (c) 2024 Meerkat
+#include "../inc/DeletionQueue.h"
+
+vkUtil::DeletionQueue::DeletionQueue() {
+}
+
+vkUtil::DeletionQueue::~DeletionQueue() {
+  flush();
+}
+
+void vkUtil::DeletionQueue::push(std::function<void()>&& deleter) {
+  mEntries.push_back({ mFrame, std::move(deleter) });
+}
+
+void vkUtil::DeletionQueue::advance(uint32_t framesInFlight) {
+  ++mFrame;
+
+  while (!mEntries.empty()
+         && mEntries.front().frame + framesInFlight <= mFrame) {
+    mEntries.front().deleter();
+    mEntries.pop_front();
+  }
+}
+
+void vkUtil::DeletionQueue::flush() {
+  for (Entry& entry : mEntries) {
+    entry.deleter();
+  }
+  mEntries.clear();
+}
@@ -0,0 +1,119 @@
+// Copyright (c) 2024 Meerkat
+#include "../inc/DescriptorAllocator.h"
+#include <algorithm>
+
+vkUtil::DescriptorAllocator::DescriptorAllocator() {
+}
+
+vkUtil::DescriptorAllocator::~DescriptorAllocator() {
+}
+
+void vkUtil::DescriptorAllocator::init(
+  const DescriptorAllocatorInputChunk& input,
+  bool debug
+) {
+  mHasDebug       = debug;
+  mDevice         = input.device;
+  mSetsPerPool    = input.setsPerPool;
+  mMaxSetsPerPool = input.maxSetsPerPool;
+  mPoolRatios     = input.poolRatios;
+}
+
+void vkUtil::DescriptorAllocator::destroy() {
+  for (vk::DescriptorPool pool : mUsedPools) {
+    mDevice.destroyDescriptorPool(pool);
+  }
+  for (vk::DescriptorPool pool : mFreePools) {
+    mDevice.destroyDescriptorPool(pool);
+  }
+  mUsedPools.clear();
+  mFreePools.clear();
+  mCurrentPool = nullptr;
+}
+
+vk::DescriptorSet vkUtil::DescriptorAllocator::allocate(
+  vk::DescriptorSetLayout layout
+) {
+  if (!mCurrentPool) {
+    mCurrentPool = grab_pool();
+  }
+
+  vk::DescriptorSetAllocateInfo allocationInfo {};
+  allocationInfo.descriptorSetCount = 1;
+  allocationInfo.pSetLayouts        = &layout;
+
+  // The second attempt runs on a fresh pool, which only fails when a single
+  // set needs more descriptors than a whole pool holds.
+  for (uint32_t attempt = 0; attempt < 2; ++attempt) {
+    allocationInfo.descriptorPool = mCurrentPool;
+    try {
+      return mDevice.allocateDescriptorSets(allocationInfo)[0];
+    } catch (vk::OutOfPoolMemoryError) {
+    } catch (vk::FragmentedPoolError) {
+    } catch (vk::SystemError err) {
+      if (mHasDebug) {
+        printf("Error while allocating descriptor set. Error: %s\n",
+               err.what());
+      }
+      return nullptr;
+    }
+
+    mCurrentPool = grab_pool();
+  }
+
+  if (mHasDebug) {
+    printf("Descriptor set does not fit in an empty pool.\n");
+  }
+  return nullptr;
+}
+
+void vkUtil::DescriptorAllocator::reset() {
+  for (vk::DescriptorPool pool : mUsedPools) {
+    mDevice.resetDescriptorPool(pool);
+    mFreePools.push_back(pool);
+  }
+  mUsedPools.clear();
+  mCurrentPool = nullptr;
+}
+
+vk::DescriptorPool vkUtil::DescriptorAllocator::grab_pool() {
+  if (!mFreePools.empty()) {
+    vk::DescriptorPool pool = mFreePools.back();
+    mFreePools.pop_back();
+    mUsedPools.push_back(pool);
+    return pool;
+  }
+
+  std::vector<vk::DescriptorPoolSize> poolSizes {};
+  for (const auto& [type, ratio] : mPoolRatios) {
+    vk::DescriptorPoolSize poolSize {};
+    poolSize.type            = type;
+    poolSize.descriptorCount = std::max(
+      1u, static_cast<uint32_t>(ratio * mSetsPerPool));
+    poolSizes.push_back(poolSize);
+  }
+
+  vk::DescriptorPoolCreateInfo poolInfo {};
+  poolInfo.maxSets       = mSetsPerPool;
+  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+  poolInfo.pPoolSizes    = poolSizes.data();
+
+  vk::DescriptorPool pool {};
+  try {
+    pool = mDevice.createDescriptorPool(poolInfo);
+  } catch (vk::SystemError err) {
+    if (mHasDebug) {
+      printf("Error while creating descriptor pool. Error: %s\n",
+             err.what());
+    }
+  }
+
+  if (mHasDebug) {
+    printf("Descriptor allocator grew to %zu pools, %u sets in the last.\n",
+           mUsedPools.size() + 1, mSetsPerPool);
+  }
+
+  mSetsPerPool = std::min(mSetsPerPool * 2, mMaxSetsPerPool);
+  mUsedPools.push_back(pool);
+  return pool;
+}
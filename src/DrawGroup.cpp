@@ -0,0 +1,93 @@
+// Copyright (c) 2024 Meerkat
+#include "../inc/DrawGroup.h"
+#include <cstring>
+
+void vkUtil::make_draw_groups(
+  const std::vector<DrawPacket>& packets,
+  const std::vector<MeshRecord>& meshes,
+  const std::vector<DrawPushConstants>& materials,
+  std::vector<DrawGroup>* groups
+) {
+  groups->clear();
+  for (uint32_t first = 0; first < packets.size();) {
+    const uint64_t state = get_draw_state(packets[first].key);
+    uint32_t last = first + 1;
+    while (last < packets.size()
+           && get_draw_state(packets[last].key) == state) {
+      ++last;
+    }
+
+    const MeshRecord& mesh = meshes[get_draw_mesh(packets[first].key)];
+
+    DrawGroup group {};
+    group.firstIndex        = mesh.firstIndex;
+    group.indexCount        = mesh.indexCount;
+    group.firstInstance     = first;
+    group.instanceCount     = last - first;
+    group.draw              =
+      materials[get_draw_material(packets[first].key)];
+    group.draw.baseInstance = 0;
+    groups->push_back(group);
+
+    first = last;
+  }
+}
+
+vkUtil::DrawStats vkUtil::record_draw_groups(
+  vk::CommandBuffer commandBuffer,
+  const DrawBindings& bindings,
+  const std::vector<DrawGroup>& groups,
+  size_t first,
+  size_t last
+) {
+  DrawStats stats {};
+
+  commandBuffer.bindDescriptorSets(
+    vk::PipelineBindPoint::eGraphics,
+    bindings.layout,
+    0,
+    bindings.descriptorSets,
+    nullptr
+  );
+  stats.descriptorBinds +=
+    static_cast<uint32_t>(bindings.descriptorSets.size());
+
+  commandBuffer.bindPipeline(
+    vk::PipelineBindPoint::eGraphics, bindings.pipeline);
+  ++stats.pipelineBinds;
+
+  const vk::DeviceSize offset = 0;
+  commandBuffer.bindVertexBuffers(0, bindings.vertexBuffer, offset);
+  commandBuffer.bindIndexBuffer(
+    bindings.indexBuffer, bindings.indexOffset, vk::IndexType::eUint32);
+
+  // The instance offset travels in firstInstance, so the push constants
+  // only change with the material and consecutive groups of one material
+  // skip the push.
+  const DrawPushConstants* pushed = nullptr;
+  for (size_t i = first; i < last; ++i) {
+    const DrawGroup& group = groups[i];
+    if (!pushed
+        || memcmp(pushed, &group.draw, sizeof(DrawPushConstants))) {
+      commandBuffer.pushConstants(
+        bindings.layout,
+        vk::ShaderStageFlagBits::eVertex,
+        0,
+        sizeof(DrawPushConstants),
+        &group.draw
+      );
+      pushed = &group.draw;
+      ++stats.pushConstants;
+    }
+    commandBuffer.drawIndexed(
+      group.indexCount,
+      group.instanceCount,
+      group.firstIndex,
+      0,
+      group.firstInstance
+    );
+    ++stats.draws;
+  }
+
+  return stats;
+}
@@ -0,0 +1,51 @@
+// Copyright (c) 2024 Meerkat
+#include "../inc/DrawPacket.h"
+#include <array>
+
+void vkUtil::radix_sort(
+  std::vector<DrawPacket>* packets,
+  std::vector<DrawPacket>* scratch
+) {
+  const size_t count = packets->size();
+  if (count < 2) {
+    return;
+  }
+  scratch->resize(count);
+
+  // Histograms of all eight bytes in one pass.
+  std::array<std::array<uint32_t, 256>, 8> histograms {};
+  for (const DrawPacket& packet : *packets) {
+    for (int byte = 0; byte < 8; ++byte) {
+      ++histograms[byte][(packet.key >> (8 * byte)) & 0xff];
+    }
+  }
+
+  DrawPacket* source      = packets->data();
+  DrawPacket* destination = scratch->data();
+  for (int byte = 0; byte < 8; ++byte) {
+    std::array<uint32_t, 256>& histogram = histograms[byte];
+    const uint32_t shift = 8 * byte;
+
+    // Every key has the same value in this byte, the pass would not move
+    // anything.
+    if (histogram[(source[0].key >> shift) & 0xff] == count) {
+      continue;
+    }
+
+    uint32_t offset = 0;
+    for (uint32_t& bucket : histogram) {
+      uint32_t size = bucket;
+      bucket = offset;
+      offset += size;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+      destination[histogram[(source[i].key >> shift) & 0xff]++] = source[i];
+    }
+    std::swap(source, destination);
+  }
+
+  if (source != packets->data()) {
+    packets->swap(*scratch);
+  }
+}
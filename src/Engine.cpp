@@ -11,6 +11,35 @@
 #include "../inc/Scene.h"
 #include "../inc/Descriptors.h"
 #include "../inc/ObjMesh.h"
+#include "../inc/Frustum.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+
+namespace {
+
+const glm::vec3 sCameraEye    = { -1.0f,  0.0f,  1.0f };
+const glm::vec3 sCameraCenter = {  1.0f,  0.0f,  1.0f };
+const glm::vec3 sCameraUp     = {  0.0f,  0.0f,  1.0f };
+const float     sCameraFov    = glm::radians(45.0f);
+const float     sCameraNear   = 0.1f;
+const float     sCameraFar    = 100.0f;
+
+const char* const sPipelineCacheFile = "./bin/pipeline.cache";
+
+// Seconds the framebuffer size must hold still before a resize recreates
+// the swapchain, so dragging a window edge recreates it once, not per frame.
+const double sResizeDebounce = 0.1;
+
+// Meshes the CPU path rasterizes in software to hide what is behind them,
+// into a buffer this wide and as high as the aspect ratio asks.
+const vkMesh::MeshTypes sOccluderMeshes[] = { vkMesh::MeshTypes::GROUND };
+const uint32_t          sOcclusionWidth   = 256;
+// Instances tested per job.
+const uint32_t          sOcclusionBatch   = 256;
+
+}  // namespace
 
 void Engine::init(
   uint32_t width, uint32_t height, GLFWwindow* window, bool debugMode) {
@@ -42,31 +71,67 @@ void Engine::destroy() {
     printf("Destroying app...\n");
   }
 
+  mTextureStreamer->destroy();
+  delete mTextureStreamer;
+
+  mJobPool.destroy();
+
+  // Pipelines still compiling are collected so they can be destroyed.
+  wait_depth_prepass_pipelines();
+  mPipelineCompiler.destroy();
+
   mDevice.destroyCommandPool(mCommandPool);
 
   for (PipelineTypes pt : sPipelineTypes) {
     mDevice.destroyPipeline(mGraphicsPipeline[pt]);
     mDevice.destroyPipelineLayout(mPipelineLayout[pt]);
-    mDevice.destroyRenderPass(mRenderPass[pt]);
   }
+  mDevice.destroyPipeline(mDepthPrepassPipeline);
+  mDevice.destroyPipeline(mDepthTestedPipeline);
+  mDevice.destroyRenderPass(mRenderPass);
+  mDevice.destroyPipeline(mCullPipeline);
+  mDevice.destroyPipelineLayout(mCullPipelineLayout);
+  mDevice.destroyPipeline(mDepthPyramidPipeline);
+  mDevice.destroyPipelineLayout(mDepthPyramidPipelineLayout);
+  mDevice.destroySampler(mDepthPyramidSampler);
+  mDevice.destroyRenderPass(mEarlyRenderPass);
+  mDevice.destroyRenderPass(mLateRenderPass);
+  mPipelineCache.destroy();
 
   cleanup_swapchain();
 
+  for (vkUtil::FrameContext& f : mFrameContexts) {
+    f.destroy();
+  }
+
+  for (PipelineTypes pt : sPipelineTypes) {
+    mDevice.destroyDescriptorUpdateTemplate(mFrameUpdateTemplate[pt]);
+  }
+  mDevice.destroyDescriptorUpdateTemplate(mCullUpdateTemplate);
+  mDescriptorAllocator.destroy();
   for (PipelineTypes pt : sPipelineTypes) {
     mDevice.destroyDescriptorSetLayout(mFrameSetLayout[pt]);
   }
+  mDevice.destroyDescriptorSetLayout(mCullSetLayout);
+  mDevice.destroyDescriptorSetLayout(mDepthPyramidSetLayout);
 
   delete mMeshes;
+  mDevice.unmapMemory(mMeshTable.bufferMemory);
+  mDevice.freeMemory(mMeshTable.bufferMemory);
+  mDevice.destroyBuffer(mMeshTable.buffer);
 
   for (const auto& [_, texture] : mMaterials) {
     delete texture;
   }
+  delete mAtlas;
   delete mSkyCubeMap;
 
-  for (PipelineTypes pt : sPipelineTypes) {
-    mDevice.destroyDescriptorSetLayout(mMeshSetLayout[pt]);
-  }
-  mDevice.destroyDescriptorPool(mMeshDescriptorPool);
+  // Retired texture images and registry slots.
+  mDeletionQueue.flush();
+
+  delete mSamplerCache;
+
+  delete mTextureRegistry;
 
   mDevice.destroy();
   mInstance.destroySurfaceKHR(mSurface);
@@ -83,6 +148,85 @@ void Engine::destroy() {
   }
 }
 
+void Engine::load_scene(Scene* scene) {
+  for (const auto& [mesh, sphere] : mMeshBounds) {
+    scene->set_mesh_bounds(mesh, sphere);
+  }
+  scene->flush();
+  const uint32_t instanceCount =
+    static_cast<uint32_t>(scene->get_instance_count());
+  for (vkUtil::FrameContext& f : mFrameContexts) {
+    f.reserve_instances(instanceCount);
+  }
+
+  if (mHasDebug) {
+    printf("Instance buffers hold %u instances per frame.\n",
+           mFrameContexts[0].mInstanceCapacity);
+  }
+}
+
+void Engine::set_texture_budget(size_t budget) {
+  mTextureBudget = budget;
+  if (mTextureStreamer) {
+    mTextureStreamer->set_budget(budget);
+  }
+}
+
+void Engine::set_gpu_driven(bool gpuDriven) {
+  const bool hiZ = uses_depth_pyramid();
+  mGpuDriven = gpuDriven;
+  if (hiZ != uses_depth_pyramid()) {
+    remake_depth_buffers();
+  }
+}
+
+void Engine::set_depth_prepass(bool depthPrepass) {
+  if (depthPrepass) {
+    wait_depth_prepass_pipelines();
+  }
+  mDepthPrepass = depthPrepass;
+}
+
+void Engine::set_occlusion_culling(bool occlusionCulling) {
+  const bool hiZ = uses_depth_pyramid();
+  mOcclusionCulling = occlusionCulling;
+  if (hiZ != uses_depth_pyramid()) {
+    remake_depth_buffers();
+  }
+}
+
+bool Engine::uses_depth_pyramid() const {
+  return mGpuDriven && mOcclusionCulling && mDepthSampleable;
+}
+
+void Engine::remake_depth_buffers() {
+  // Before init, depth is made with the right usage to begin with.
+  if (mFrameContexts.empty() || !mFrameContexts[0].mDepthBuffer) {
+    return;
+  }
+
+  // Frames in flight keep the old depth buffers and the framebuffers using
+  // them, the deletion queue destroys both once their fences have signaled.
+  std::vector<vk::Framebuffer> oldFramebuffers;
+  for (vkUtil::SwapChainFrame& f : mSwapchainFrames) {
+    oldFramebuffers.insert(
+      oldFramebuffers.end(), f.mFramebuffer.begin(), f.mFramebuffer.end());
+    f.mFramebuffer.clear();
+  }
+  mDeletionQueue.push(
+    [device = mDevice, framebuffers = std::move(oldFramebuffers)]() {
+      for (vk::Framebuffer framebuffer : framebuffers) {
+        device.destroyFramebuffer(framebuffer);
+      }
+    });
+
+  for (vkUtil::FrameContext& f : mFrameContexts) {
+    f.retire_depth_resources(&mDeletionQueue);
+  }
+  make_depth_buffers();
+  make_framebuffers();
+}
+
 void Engine::make_instance() {
   mInstance = vkInit::make_instance(mHasDebug, "Engine");
   mDldi     = vk::DispatchLoaderDynamic(mInstance, vkGetInstanceProcAddr);
@@ -114,57 +258,140 @@ void Engine::make_device() {
   mGraphicsQueue = queues[0];
   mPresentQueue  = queues[1];
 
+  // The depth pyramid samples depth, so prefer formats that allow it and
+  // go without Hi-Z occlusion culling otherwise.
+  const std::vector<vk::Format> depthFormats = {
+    vk::Format::eD32Sfloat, vk::Format::eD24UnormS8Uint
+  };
+  mDepthSampleable = false;
+  for (vk::Format format : depthFormats) {
+    if (vkImage::is_format_supported(
+          mPhysicalDevice, format, vk::ImageTiling::eOptimal,
+          vk::FormatFeatureFlagBits::eDepthStencilAttachment
+            | vk::FormatFeatureFlagBits::eSampledImage)) {
+      mDepthFormat     = format;
+      mDepthSampleable = true;
+      break;
+    }
+  }
+  if (!mDepthSampleable) {
+    mDepthFormat = vkImage::find_supported_format(
+      mPhysicalDevice,
+      depthFormats,
+      vk::ImageTiling::eOptimal,
+      vk::FormatFeatureFlagBits::eDepthStencilAttachment);
+    if (mHasDebug) {
+      printf("Depth can not be sampled, no Hi-Z occlusion culling.\n");
+    }
+  }
+
+  const vk::PhysicalDeviceLimits limits =
+    mPhysicalDevice.getProperties().limits;
+  if (limits.timestampComputeAndGraphics) {
+    mTimestampPeriod = limits.timestampPeriod;
+  }
+
   make_swapchain();
 
   mFrameNumber = 0;
 }
 
 void Engine::make_swapchain() {
+  // The current swapchain, if any, is retired by the new one.
   vkInit::SwapChainBundle bundle = vkInit::create_swapchain(
-    mPhysicalDevice, mDevice, mSurface, mWidth, mHeight, mHasDebug);
+    mPhysicalDevice, mDevice, mSurface, mWidth, mHeight, mSwapchain,
+    mHasDebug);
   mSwapchain       = bundle.swapchain;
   mSwapchainFrames = bundle.frames;
   mSwapchainFormat = bundle.format;
   mSwapchainExtent = bundle.extent;
 
-  mMaxFramesInFlight = static_cast<uint32_t>(mSwapchainFrames.size());
-
   for (vkUtil::SwapChainFrame& frame : mSwapchainFrames) {
     frame.mDevice         = mDevice;
     frame.mPhysicalDevice = mPhysicalDevice;
-    frame.mWidth          = mSwapchainExtent.width;
-    frame.mHeight         = mSwapchainExtent.height;
-
-    frame.make_depth_resources();
+    frame.mRenderFinished = vkInit::make_semaphore(mDevice, mHasDebug);
   }
 }
 
 void Engine::recreate_swapchain() {
   int32_t w = 0;
   int32_t h = 0;
+  glfwGetFramebufferSize(mWindow, &w, &h);
+  // Minimized, there is nothing to present to until the window comes back.
   while (w == 0 || h == 0) {
-    glfwGetFramebufferSize(mWindow, &w, &h);
     glfwWaitEvents();
+    glfwGetFramebufferSize(mWindow, &w, &h);
   }
-  mWidth = w;
+  mWidth  = w;
   mHeight = h;
+  mSwapchainSuboptimal = false;
+  if (mHasDebug) {
+    printf("Recreating swapchain at %dx%d.\n", w, h);
+  }
 
-  mDevice.waitIdle();
-
-  cleanup_swapchain();
+  // Only what is sized by the swapchain is remade. Pipelines take the
+  // viewport from the command buffer and the pyramid descriptor sets are
+  // allocated for any size, so both survive the resize.
+  //
+  // Nothing waits for the device: frames in flight keep the old swapchain,
+  // framebuffers and depth buffers, which the deletion queue destroys once
+  // their fences have signaled.
+  const vk::SwapchainKHR oldSwapchain = mSwapchain;
+  std::vector<vkUtil::SwapChainFrame> oldFrames = std::move(mSwapchainFrames);
+  mSwapchainFrames.clear();
   make_swapchain();
+  mDeletionQueue.push(
+    [device = mDevice, oldSwapchain, frames = std::move(oldFrames)]() mutable {
+      for (vkUtil::SwapChainFrame& f : frames) {
+        f.destroy();
+      }
+      device.destroySwapchainKHR(oldSwapchain);
+    });
+
+  for (vkUtil::FrameContext& f : mFrameContexts) {
+    f.retire_depth_resources(&mDeletionQueue);
+  }
+  make_depth_buffers();
   make_framebuffers();
-  make_frame_resources();
+}
 
-  vkInit::CommandBufferInputChunk commandBufferInput{};
-  commandBufferInput.device      = mDevice;
-  commandBufferInput.frames      = &mSwapchainFrames;
-  commandBufferInput.commandPool = mCommandPool;
+bool Engine::resize_settled() {
+  int32_t w = 0;
+  int32_t h = 0;
+  glfwGetFramebufferSize(mWindow, &w, &h);
 
-  vkInit::make_frame_command_buffers(&commandBufferInput, mHasDebug);
+  const double now = glfwGetTime();
+  if (w != mResizeWidth || h != mResizeHeight) {
+    mResizeWidth  = w;
+    mResizeHeight = h;
+    mResizeTime   = now;
+  }
+
+  const bool resized = static_cast<uint32_t>(w) != mWidth
+    || static_cast<uint32_t>(h) != mHeight;
+  if (!resized && !mSwapchainSuboptimal) {
+    return false;
+  }
+  // Minimized windows are left alone, acquire reports them out of date.
+  if (w == 0 || h == 0) {
+    return false;
+  }
+  return now - mResizeTime >= sResizeDebounce;
 }
 
 void Engine::make_descriptor_set_layouts() {
+  vkUtil::DescriptorAllocatorInputChunk allocatorInfo {};
+  allocatorInfo.device         = mDevice;
+  allocatorInfo.setsPerPool    = 16;
+  allocatorInfo.maxSetsPerPool = 512;
+  allocatorInfo.poolRatios     = {
+    { vk::DescriptorType::eUniformBuffer, 1.0f },
+    { vk::DescriptorType::eStorageBuffer, 2.0f },
+    { vk::DescriptorType::eCombinedImageSampler, 2.0f },
+    { vk::DescriptorType::eStorageImage, 1.0f },
+  };
+  mDescriptorAllocator.init(allocatorInfo, mHasDebug);
+
   {
     vkInit::DescriptorSetLayoutData skyBindings;
     skyBindings.count = 1;
@@ -175,10 +402,18 @@ void Engine::make_descriptor_set_layouts() {
 
     mFrameSetLayout[PipelineTypes::SKY] =
       vkInit::make_descriptor_set_layout(mDevice, skyBindings, mHasDebug);
+    mFrameUpdateTemplate[PipelineTypes::SKY] =
+      vkInit::make_descriptor_update_template(
+        mDevice,
+        mFrameSetLayout[PipelineTypes::SKY],
+        skyBindings,
+        { offsetof(vkUtil::FrameDescriptors, cameraVectors) },
+        mHasDebug
+      );
   }
   {
     vkInit::DescriptorSetLayoutData frameBindings;
-    frameBindings.count = 2;
+    frameBindings.count = 3;
     frameBindings.indices.push_back(0);
     frameBindings.types.push_back(vk::DescriptorType::eUniformBuffer);
     frameBindings.counts.push_back(1);
@@ -189,89 +424,298 @@ void Engine::make_descriptor_set_layouts() {
     frameBindings.counts.push_back(1);
     frameBindings.stages.push_back(vk::ShaderStageFlagBits::eVertex);
 
+    frameBindings.indices.push_back(2);
+    frameBindings.types.push_back(vk::DescriptorType::eStorageBuffer);
+    frameBindings.counts.push_back(1);
+    frameBindings.stages.push_back(vk::ShaderStageFlagBits::eVertex);
+
     mFrameSetLayout[PipelineTypes::STANDARD] =
       vkInit::make_descriptor_set_layout(mDevice, frameBindings, mHasDebug);
+    mFrameUpdateTemplate[PipelineTypes::STANDARD] =
+      vkInit::make_descriptor_update_template(
+        mDevice,
+        mFrameSetLayout[PipelineTypes::STANDARD],
+        frameBindings,
+        {
+          offsetof(vkUtil::FrameDescriptors, cameraMatrix),
+          offsetof(vkUtil::FrameDescriptors, modelBuffer),
+          offsetof(vkUtil::FrameDescriptors, visibleInstances)
+        },
+        mHasDebug
+      );
+  }
+  {
+    vkInit::DescriptorSetLayoutData cullBindings;
+    cullBindings.count = 8;
+    cullBindings.types = {
+      vk::DescriptorType::eStorageBuffer,
+      vk::DescriptorType::eStorageBuffer,
+      vk::DescriptorType::eStorageBuffer,
+      vk::DescriptorType::eStorageBuffer,
+      vk::DescriptorType::eUniformBuffer,
+      vk::DescriptorType::eStorageBuffer,
+      vk::DescriptorType::eCombinedImageSampler,
+      vk::DescriptorType::eStorageBuffer
+    };
+    for (uint32_t i = 0; i < cullBindings.count; ++i) {
+      cullBindings.indices.push_back(i);
+      cullBindings.counts.push_back(1);
+      cullBindings.stages.push_back(vk::ShaderStageFlagBits::eCompute);
+    }
+    // The depth pyramid only exists with occlusion culling, so it is
+    // partially bound and written apart from the template.
+    cullBindings.bindingFlags.resize(cullBindings.count);
+    cullBindings.bindingFlags[6] =
+      vk::DescriptorBindingFlagBits::ePartiallyBound;
+
+    mCullSetLayout =
+      vkInit::make_descriptor_set_layout(mDevice, cullBindings, mHasDebug);
+
+    vkInit::DescriptorSetLayoutData cullEntries = cullBindings;
+    cullEntries.count = cullBindings.count - 1;
+    cullEntries.indices.erase(cullEntries.indices.begin() + 6);
+    cullEntries.types.erase(cullEntries.types.begin() + 6);
+    cullEntries.counts.erase(cullEntries.counts.begin() + 6);
+    cullEntries.stages.erase(cullEntries.stages.begin() + 6);
+    cullEntries.bindingFlags.clear();
+    mCullUpdateTemplate =
+      vkInit::make_descriptor_update_template(
+        mDevice,
+        mCullSetLayout,
+        cullEntries,
+        {
+          offsetof(vkUtil::FrameDescriptors, modelBuffer),
+          offsetof(vkUtil::FrameDescriptors, meshTable),
+          offsetof(vkUtil::FrameDescriptors, drawCommands),
+          offsetof(vkUtil::FrameDescriptors, drawCount),
+          offsetof(vkUtil::FrameDescriptors, cameraMatrix),
+          offsetof(vkUtil::FrameDescriptors, visibility),
+          offsetof(vkUtil::FrameDescriptors, visibleInstances)
+        },
+        mHasDebug
+      );
+  }
+  {
+    // Written directly per pyramid level, no template.
+    vkInit::DescriptorSetLayoutData pyramidBindings;
+    pyramidBindings.count = 2;
+    pyramidBindings.types = {
+      vk::DescriptorType::eCombinedImageSampler,
+      vk::DescriptorType::eStorageImage
+    };
+    for (uint32_t i = 0; i < pyramidBindings.count; ++i) {
+      pyramidBindings.indices.push_back(i);
+      pyramidBindings.counts.push_back(1);
+      pyramidBindings.stages.push_back(vk::ShaderStageFlagBits::eCompute);
+    }
+
+    mDepthPyramidSetLayout =
+      vkInit::make_descriptor_set_layout(mDevice, pyramidBindings, mHasDebug);
   }
   {
-    vkInit::DescriptorSetLayoutData meshBindings;
-    meshBindings.count = 1;
-    meshBindings.indices.push_back(0);
-    meshBindings.types.push_back(vk::DescriptorType::eCombinedImageSampler);
-    meshBindings.counts.push_back(1);
-    meshBindings.stages.push_back(vk::ShaderStageFlagBits::eFragment);
+    vkImage::TextureRegistryInputChunk registryInfo {};
+    registryInfo.device      = mDevice;
+    registryInfo.maxTextures = 1024;
 
-    mMeshSetLayout[PipelineTypes::SKY] =
-      vkInit::make_descriptor_set_layout(mDevice, meshBindings, mHasDebug);
-    mMeshSetLayout[PipelineTypes::STANDARD] =
-      vkInit::make_descriptor_set_layout(mDevice, meshBindings, mHasDebug);
+    mTextureRegistry = new vkImage::TextureRegistry();
+    mTextureRegistry->init(registryInfo, mHasDebug);
   }
 }
 
 void Engine::make_pipeline() {
+  auto start = std::chrono::steady_clock::now();
+
+  mPipelineCache.init(
+    mPhysicalDevice, mDevice, sPipelineCacheFile, mHasDebug);
+  mPipelineCompiler.init(
+    mDevice,
+    mPipelineCache.get(),
+    std::clamp(std::thread::hardware_concurrency(), 1u, 4u),
+    mHasDebug);
+
+  // The builder only describes pipelines, layouts and render passes are made
+  // here and the pipelines compile on the compiler's workers.
   vkInit::PipelineBuilder pipelineBuilder {};
-  pipelineBuilder.init(mDevice);
+  pipelineBuilder.init(mDevice, mPipelineCache.get(), mHasDebug);
 
+  // Geometry or the sky covers every pixel, so the color attachment is
+  // neither cleared nor loaded.
   pipelineBuilder.set_overwrite_mode(false);
-  pipelineBuilder.specify_vertex_shader("./bin/shaders/sky_shader.vert.spv");
-  pipelineBuilder.specify_fragment_shader("./bin/shaders/sky_shader.frag.spv");
-  pipelineBuilder.specify_swapchain_extent(mSwapchainExtent);
-  pipelineBuilder.clear_depth_attachment();
+  pipelineBuilder.specify_vertex_format(
+    vkMesh::getPosColorBindingDescription(),
+    vkMesh::getPosColorAttributeDescriptions()
+  );
+  pipelineBuilder.specify_vertex_shader("./bin/shaders/default.vert.spv");
+  pipelineBuilder.specify_fragment_shader("./bin/shaders/default.frag.spv");
+  pipelineBuilder.specify_depth_attachment(mDepthFormat, 1);
   pipelineBuilder.add_descriptor_set_layout(
-    mFrameSetLayout[PipelineTypes::SKY]
+    mFrameSetLayout[PipelineTypes::STANDARD]
   );
   pipelineBuilder.add_descriptor_set_layout(
-    mMeshSetLayout[PipelineTypes::SKY]
+    mTextureRegistry->get_layout()
+  );
+  pipelineBuilder.add_push_constant_range(
+    vk::ShaderStageFlagBits::eVertex,
+    0,
+    sizeof(vkUtil::DrawPushConstants)
   );
   pipelineBuilder.add_color_attachment(mSwapchainFormat, 0);
 
-  vkInit::GraphicsPipelineOutBundle output = pipelineBuilder.build();
+  vkInit::GraphicsPipelineDescription standard = pipelineBuilder.describe();
+  mRenderPass                              = standard.renderPass;
+  mPipelineLayout[PipelineTypes::STANDARD] = standard.pipelineLayout;
 
-  mPipelineLayout[PipelineTypes::SKY]   = output.pipelineLayout;
-  mRenderPass[PipelineTypes::SKY]       = output.renderPass;
-  mGraphicsPipeline[PipelineTypes::SKY] = output.graphicsPipeline;
+  // The same shaders tested against the prepass depth. Less-or-equal
+  // rather than equal keeps a pixel even if the two vertex shaders round
+  // differently.
+  pipelineBuilder.use_renderpass(mRenderPass);
+  pipelineBuilder.use_pipeline_layout(
+    mPipelineLayout[PipelineTypes::STANDARD]);
+  pipelineBuilder.set_depth_test(vk::CompareOp::eLessOrEqual, false);
+  vkInit::GraphicsPipelineDescription depthTested =
+    pipelineBuilder.describe();
 
   pipelineBuilder.reset();
 
-  pipelineBuilder.set_overwrite_mode(true);
+  // Depth prepass: positions only, no fragment shader and no color writes.
+  pipelineBuilder.use_renderpass(mRenderPass);
+  pipelineBuilder.use_pipeline_layout(
+    mPipelineLayout[PipelineTypes::STANDARD]);
   pipelineBuilder.specify_vertex_format(
-    vkMesh::getPosColorBindingDescription(),
-    vkMesh::getPosColorAttributeDescriptions()
+    vkMesh::getPositionBindingDescription(),
+    vkMesh::getPositionAttributeDescriptions()
   );
-  pipelineBuilder.specify_vertex_shader("./bin/shaders/default.vert.spv");
-  pipelineBuilder.specify_fragment_shader("./bin/shaders/default.frag.spv");
-  pipelineBuilder.specify_swapchain_extent(mSwapchainExtent);
-  pipelineBuilder.specify_depth_attachment(mSwapchainFrames[0].mDepthFormat, 1);
+  pipelineBuilder.specify_vertex_shader("./bin/shaders/depth.vert.spv");
+  pipelineBuilder.set_depth_test(vk::CompareOp::eLess, true);
+  pipelineBuilder.set_color_write_mask(vk::ColorComponentFlags());
+  vkInit::GraphicsPipelineDescription depthPrepass =
+    pipelineBuilder.describe();
+
+  // With occlusion culling the frame draws in two passes over the same
+  // attachments: the early one keeps its depth for the pyramid, the late
+  // one loads and continues it. Both are compatible with mRenderPass.
+  pipelineBuilder.reset();
+  pipelineBuilder.set_overwrite_mode(false);
+  pipelineBuilder.set_depth_store(true);
+  pipelineBuilder.add_color_attachment(mSwapchainFormat, 0);
+  pipelineBuilder.specify_depth_attachment(mDepthFormat, 1);
+  mEarlyRenderPass = pipelineBuilder.build_renderpass();
+
+  pipelineBuilder.reset();
+  pipelineBuilder.set_overwrite_mode(true);
+  pipelineBuilder.add_color_attachment(mSwapchainFormat, 0);
+  pipelineBuilder.specify_depth_attachment(mDepthFormat, 1);
+  mLateRenderPass = pipelineBuilder.build_renderpass();
+
+  pipelineBuilder.reset();
+  pipelineBuilder.set_overwrite_mode(false);
+
+  // The sky is drawn last in the same pass at the far plane, it passes the
+  // depth test only where the cleared depth is left.
+  pipelineBuilder.use_renderpass(mRenderPass);
+  pipelineBuilder.specify_vertex_shader("./bin/shaders/sky_shader.vert.spv");
+  pipelineBuilder.specify_fragment_shader("./bin/shaders/sky_shader.frag.spv");
+  pipelineBuilder.set_depth_test(vk::CompareOp::eLessOrEqual, false);
   pipelineBuilder.add_descriptor_set_layout(
-    mFrameSetLayout[PipelineTypes::STANDARD]
+    mFrameSetLayout[PipelineTypes::SKY]
   );
   pipelineBuilder.add_descriptor_set_layout(
-    mMeshSetLayout[PipelineTypes::STANDARD]
+    mTextureRegistry->get_layout()
   );
-  pipelineBuilder.add_color_attachment(mSwapchainFormat, 0);
 
-  output = pipelineBuilder.build();
+  vkInit::GraphicsPipelineDescription sky = pipelineBuilder.describe();
+  mPipelineLayout[PipelineTypes::SKY] = sky.pipelineLayout;
+
+  vk::PushConstantRange cullRange {};
+  cullRange.stageFlags = vk::ShaderStageFlagBits::eCompute;
+  cullRange.offset     = 0;
+  cullRange.size       = sizeof(vkUtil::CullPushConstants);
+
+  vkInit::ComputePipelineDescription cull {};
+  cull.shader         = "./bin/shaders/cull.comp.spv";
+  cull.pipelineLayout =
+    vkInit::make_pipeline_layout(mDevice, { mCullSetLayout }, { cullRange });
+  mCullPipelineLayout = cull.pipelineLayout;
+
+  vkInit::ComputePipelineDescription pyramid {};
+  pyramid.shader         = "./bin/shaders/depth_pyramid.comp.spv";
+  pyramid.pipelineLayout =
+    vkInit::make_pipeline_layout(mDevice, { mDepthPyramidSetLayout }, {});
+  mDepthPyramidPipelineLayout = pyramid.pipelineLayout;
+
+  // What the first frame draws with goes first, the prepass variants only
+  // once the prepass is switched on.
+  using Ticket = vkInit::PipelineCompiler::Ticket;
+  const Ticket standardTicket = mPipelineCompiler.submit(standard);
+  const Ticket skyTicket      = mPipelineCompiler.submit(sky);
+  const Ticket cullTicket     = mPipelineCompiler.submit(cull);
+  const Ticket pyramidTicket  = mPipelineCompiler.submit(pyramid);
+  mDepthPrepassTicket = mPipelineCompiler.submit(depthPrepass);
+  mDepthTestedTicket  = mPipelineCompiler.submit(depthTested);
+
+  // Only read with texelFetch, the filter never applies.
+  vk::SamplerCreateInfo samplerInfo {};
+  samplerInfo.magFilter    = vk::Filter::eNearest;
+  samplerInfo.minFilter    = vk::Filter::eNearest;
+  samplerInfo.mipmapMode   = vk::SamplerMipmapMode::eNearest;
+  samplerInfo.addressModeU = vk::SamplerAddressMode::eClampToEdge;
+  samplerInfo.addressModeV = vk::SamplerAddressMode::eClampToEdge;
+  samplerInfo.addressModeW = vk::SamplerAddressMode::eClampToEdge;
+  samplerInfo.maxLod       = VK_LOD_CLAMP_NONE;
+  try {
+    mDepthPyramidSampler = mDevice.createSampler(samplerInfo);
+  } catch (vk::SystemError err) {
+    printf("Error while creating depth pyramid sampler. Error: %s\n",
+           err.what());
+  }
+
+  mGraphicsPipeline[PipelineTypes::STANDARD] =
+    mPipelineCompiler.wait(standardTicket);
+  mGraphicsPipeline[PipelineTypes::SKY] = mPipelineCompiler.wait(skyTicket);
+  mCullPipeline         = mPipelineCompiler.wait(cullTicket);
+  mDepthPyramidPipeline = mPipelineCompiler.wait(pyramidTicket);
 
-  mPipelineLayout[PipelineTypes::STANDARD]   = output.pipelineLayout;
-  mRenderPass[PipelineTypes::STANDARD]       = output.renderPass;
-  mGraphicsPipeline[PipelineTypes::STANDARD] = output.graphicsPipeline;
+  if (mHasDebug) {
+    auto end = std::chrono::steady_clock::now();
+    printf("First frame pipelines built in %.2f ms with a %s pipeline "
+           "cache.\n",
+           std::chrono::duration<double, std::milli>(end - start).count(),
+           mPipelineCache.is_warm() ? "warm" : "cold");
+  }
 }
 
-void Engine::finalize_setup() {
-  make_framebuffers();
+void Engine::wait_depth_prepass_pipelines() {
+  if (!mDepthPrepassPipeline) {
+    mDepthPrepassPipeline = mPipelineCompiler.wait(mDepthPrepassTicket);
+  }
+  if (!mDepthTestedPipeline) {
+    mDepthTestedPipeline = mPipelineCompiler.wait(mDepthTestedTicket);
+  }
+}
 
+void Engine::finalize_setup() {
   mCommandPool =
     vkInit::make_command_pool(mDevice, mPhysicalDevice, mSurface, mHasDebug);
 
   vkInit::CommandBufferInputChunk commandBufferInput{};
   commandBufferInput.device      = mDevice;
-  commandBufferInput.frames      = &mSwapchainFrames;
+  commandBufferInput.frames      = &mFrameContexts;
   commandBufferInput.commandPool = mCommandPool;
 
   mMainCommandBuffer =
     vkInit::make_command_buffer(&commandBufferInput, mHasDebug);
-  vkInit::make_frame_command_buffers(&commandBufferInput, mHasDebug);
 
-  make_frame_resources();
+  // The main thread only waits while the workers record.
+  uint32_t workerCount = std::clamp(
+    std::thread::hardware_concurrency(), 1u, 8u);
+  mJobPool.init(workerCount);
+  if (mHasDebug) {
+    printf("Recording draw commands on %u threads.\n", workerCount);
+  }
+
+  make_frame_contexts();
+  make_depth_buffers();
+  make_framebuffers();
 }
 
 void Engine::make_assets() {
@@ -307,6 +751,18 @@ void Engine::make_assets() {
   for (const auto& [key, value] : model_filenames) {
     vkMesh::ObjMesh obj(value[0], value[1], preTransforms[key]);
     mMeshes->consume(key, obj.vertices, obj.indices);
+    mMeshBounds[key] = obj.boundingSphere;
+
+    if (std::find(std::begin(sOccluderMeshes), std::end(sOccluderMeshes), key)
+        != std::end(sOccluderMeshes)) {
+      vkUtil::OccluderMesh& occluder = mOccluderMeshes[key];
+      for (size_t i = 0; i < obj.vertices.size();
+           i += vkMesh::VERTEX_COMPONENTS) {
+        occluder.positions.emplace_back(
+          obj.vertices[i], obj.vertices[i + 1], obj.vertices[i + 2]);
+      }
+      occluder.indices = obj.indices;
+    }
   }
 
   VertexMenagerie::FinalizationChunk finalizationChunk {};
@@ -316,36 +772,81 @@ void Engine::make_assets() {
   finalizationChunk.commandBuffer  = mMainCommandBuffer;
 
   mMeshes->finalize(finalizationChunk);
+  make_mesh_table();
 
   // Materials
+  mSamplerCache = new vkImage::SamplerCache();
+  mSamplerCache->init(mDevice);
+
   std::unordered_map<vkMesh::MeshTypes, const char*> filenames = {
     std::make_pair(vkMesh::MeshTypes::GROUND, "./res/tex/ground.jpg"),
     std::make_pair(vkMesh::MeshTypes::GIRL, "./res/tex/none.png"),
     std::make_pair(vkMesh::MeshTypes::SKULL, "./res/tex/skull.png") };
 
-  vkInit::DescriptorSetLayoutData bindings;
-  bindings.count = 1;
-  bindings.types.push_back(vk::DescriptorType::eCombinedImageSampler);
-  mMeshDescriptorPool = vkInit::make_descriptor_pool(
-    mDevice,
-    static_cast<uint32_t>(filenames.size()) + 1, // 1 for the sky cubemap
-    bindings,
-    mHasDebug
-  );
-
   {
     vkImage::TextureInputChunk textureInfo {};
     textureInfo.commandBuffer  = mMainCommandBuffer;
     textureInfo.queue          = mGraphicsQueue;
     textureInfo.device         = mDevice;
     textureInfo.physicalDevice = mPhysicalDevice;
-    textureInfo.layout         = mMeshSetLayout[PipelineTypes::STANDARD];
-    textureInfo.descriptorPool = mMeshDescriptorPool;
-
+    textureInfo.registry       = mTextureRegistry;
+    textureInfo.samplerCache   = mSamplerCache;
+    // Only the mips up to this size are loaded up front, the streamer brings
+    // in the rest once the textures are seen close enough.
+    textureInfo.coarseExtent   = 64;
+    textureInfo.debug          = mHasDebug;
+
+    vkImage::TextureStreamerInputChunk streamerInfo {};
+    streamerInfo.device         = mDevice;
+    streamerInfo.physicalDevice = mPhysicalDevice;
+    streamerInfo.surface        = mSurface;
+    streamerInfo.queue          = mGraphicsQueue;
+    streamerInfo.deletionQueue  = &mDeletionQueue;
+    streamerInfo.budget         = mTextureBudget;
+    mTextureStreamer = new vkImage::TextureStreamer();
+    mTextureStreamer->init(streamerInfo, mHasDebug);
+
+    vkImage::TextureAtlasInputChunk atlasInfo {};
+    atlasInfo.device         = mDevice;
+    atlasInfo.physicalDevice = mPhysicalDevice;
+    atlasInfo.commandBuffer  = mMainCommandBuffer;
+    atlasInfo.queue          = mGraphicsQueue;
+    atlasInfo.registry       = mTextureRegistry;
+    atlasInfo.samplerCache   = mSamplerCache;
+    atlasInfo.maxExtent      = 64;
+    atlasInfo.debug          = mHasDebug;
+    mAtlas = new vkImage::TextureAtlas();
+    mAtlas->init(atlasInfo);
+
+    size_t memorySavings = 0;
     for (const auto& [type, filename] : filenames) {
+      if (mAtlas->accepts(filename)) {
+        mAtlasRegions[type] = mAtlas->add(filename);
+        continue;
+      }
+
       textureInfo.filename = filename;
       mMaterials[type] = new vkImage::Texture{};
       mMaterials[type]->init(textureInfo);
+      memorySavings += mMaterials[type]->get_memory_savings();
+      mTextureStreamer->add(mMaterials[type]);
+    }
+    mAtlas->finalize();
+
+    // Push constants of every material, indexed like the draw keys.
+    uint32_t materialCount = 0;
+    for (const auto& [type, _] : filenames) {
+      materialCount = std::max(materialCount, static_cast<uint32_t>(type) + 1);
+    }
+    mMaterialConstants.resize(materialCount);
+    for (const auto& [type, _] : filenames) {
+      mMaterialConstants[static_cast<uint32_t>(type)] =
+        make_draw_constants(type);
+    }
+
+    if (mHasDebug) {
+      printf("Channel aware texture formats saved %zu bytes.\n",
+             memorySavings);
     }
   }
 
@@ -355,8 +856,8 @@ void Engine::make_assets() {
     cubeMapInfo.queue          = mGraphicsQueue;
     cubeMapInfo.device         = mDevice;
     cubeMapInfo.physicalDevice = mPhysicalDevice;
-    cubeMapInfo.layout = mMeshSetLayout[PipelineTypes::SKY];
-    cubeMapInfo.descriptorPool = mMeshDescriptorPool;
+    cubeMapInfo.registry       = mTextureRegistry;
+    cubeMapInfo.samplerCache   = mSamplerCache;
     cubeMapInfo.filenames = { {
       "./res/tex/sky_front.png",
       "./res/tex/sky_back.png",
@@ -368,11 +869,59 @@ void Engine::make_assets() {
     mSkyCubeMap = new vkImage::CubeMap {};
     mSkyCubeMap->init(cubeMapInfo);
   }
+
+  if (mHasDebug) {
+    printf("%zu textures share %zu samplers.\n",
+           mMaterials.size() + mAtlas->get_region_count() + 1,
+           mSamplerCache->size());
+  }
 }
 
-void Engine::prepare_scene(vk::CommandBuffer commandBuffer) {
+void Engine::make_mesh_table() {
+  uint32_t meshCount = 0;
+  for (const auto& [key, _] : mMeshBounds) {
+    meshCount = std::max(meshCount, static_cast<uint32_t>(key) + 1);
+  }
+
+  std::vector<vkUtil::MeshRecord>& records = mMeshRecords;
+  records.assign(meshCount, {});
+  mMeshSpheres.assign(meshCount, glm::vec4(0.0f));
+  for (const auto& [key, sphere] : mMeshBounds) {
+    records[static_cast<uint32_t>(key)].indexCount = mMeshes->getSize(key);
+    records[static_cast<uint32_t>(key)].firstIndex = mMeshes->getOffset(key);
+    mMeshSpheres[static_cast<uint32_t>(key)] = sphere;
+  }
+
+  vkUtil::BufferInputChunk input {};
+  input.physicalDevice   = mPhysicalDevice;
+  input.device           = mDevice;
+  input.memoryProperties = vk::MemoryPropertyFlagBits::eHostVisible
+    | vk::MemoryPropertyFlagBits::eHostCoherent;
+  input.size             = records.size() * sizeof(vkUtil::MeshRecord);
+  input.usage            = vk::BufferUsageFlagBits::eStorageBuffer;
+  mMeshTable = vkUtil::createBuffer(input);
+
+  void* writeLocation =
+    mDevice.mapMemory(mMeshTable.bufferMemory, 0, input.size);
+  memcpy(writeLocation, records.data(), input.size);
+
+  for (vkUtil::FrameContext& f : mFrameContexts) {
+    f.mDescriptors.meshTable.buffer = mMeshTable.buffer;
+    f.mDescriptors.meshTable.offset = 0;
+    f.mDescriptors.meshTable.range  = input.size;
+    f.mDescriptorsDirty = true;
+    f.make_draw_buffers(meshCount);
+  }
+}
+
+void Engine::prepare_scene(
+  vk::CommandBuffer commandBuffer,
+  bool positionsOnly
+) const {
   vk::Buffer vertexBuffers[] = {
-    mMeshes->getVertexBuffer().buffer 
+    positionsOnly
+      ? mMeshes->getPositionBuffer().buffer
+      : mMeshes->getVertexBuffer().buffer
   };
 
   vk::DeviceSize offsets[] = { 0 };
@@ -381,8 +930,7 @@ void Engine::prepare_scene(vk::CommandBuffer commandBuffer) {
                                 0, vk::IndexType::eUint32);
 }
 
-void Engine::prepare_frame(uint32_t frameIndex, Scene* scene) {
-  vkUtil::SwapChainFrame& frame = mSwapchainFrames[frameIndex];
+void Engine::prepare_frame(vkUtil::FrameContext& frame, Scene* scene) {
 
   glm::vec4 cam_vec_forwards = {  1.0f,  0.0f,  0.0f, 0.0f };
   glm::vec4 cam_vec_right    = {  0.0f, -1.0f,  0.0f, 0.0f };
@@ -396,19 +944,13 @@ void Engine::prepare_frame(uint32_t frameIndex, Scene* scene) {
          &frame.mCameraVectorsData,
          sizeof(vkUtil::CameraVectors));
 
-  glm::vec3 eye    = { -1.0f,  0.0f,  1.0f };
-  glm::vec3 center = {  1.0f,  0.0f,  1.0f };
-  glm::vec3 up     = {  0.0f,  0.0f,  1.0f };
-
-  glm::mat4 view = glm::lookAt(eye, center, up);
+  glm::mat4 view = glm::lookAt(sCameraEye, sCameraCenter, sCameraUp);
 
-  float povAngle = glm::radians(45.0f);
   float aspectRatio =
     static_cast<float>(mSwapchainExtent.width) /
     static_cast<float>(mSwapchainExtent.height);
-  float near = 0.1f;
-  float far = 100.0f;
-  glm::mat4 proj = glm::perspective(povAngle, aspectRatio, near, far);
+  glm::mat4 proj =
+    glm::perspective(sCameraFov, aspectRatio, sCameraNear, sCameraFar);
   proj[1][1] *= -1;
 
   frame.mCameraMatrixData.view = view;
@@ -419,195 +961,888 @@ void Engine::prepare_frame(uint32_t frameIndex, Scene* scene) {
          &frame.mCameraMatrixData,
          sizeof(vkUtil::CameraMatrices));
 
-  size_t i = 0;
-  for (const auto& [key, value] : scene->positions) {
-    for (const glm::vec3& position : value) {
-      frame.mModelTransforms[i] = glm::translate(glm::mat4(1.0f), position);
-      ++i;
+  const std::array<glm::vec4, 6> planes =
+    vkUtil::make_frustum_planes(frame.mCameraMatrixData.viewProjection);
+
+  // The frame's fence has signaled, so its buffers can be replaced.
+  frame.reserve_instances(
+    static_cast<uint32_t>(scene->get_instance_count()));
+
+  // Every context catches up on the moves of the frames it skipped.
+  const std::vector<uint32_t>& changed = scene->get_changed();
+  for (vkUtil::FrameContext& f : mFrameContexts) {
+    f.mChangedInstances.insert(
+      f.mChangedInstances.end(), changed.begin(), changed.end());
+  }
+  scene->clear_changed();
+
+  // The GPU driven path culls in the compute pass over the object data of
+  // every instance, kept in scene order so each mesh's instances and its
+  // region of the visible instance buffer line up.
+  if (mGpuDriven) {
+    if (!frame.mObjectsResident
+        || frame.mSceneVersion != scene->get_version()) {
+      const uint32_t count =
+        static_cast<uint32_t>(scene->get_instance_count());
+      for (uint32_t index = 0; index < count; ++index) {
+        write_object_data(frame, index, scene, index);
+      }
+      frame.mInstanceCount = count;
+
+      const std::vector<Scene::DrawRange>& meshRanges =
+        scene->get_mesh_ranges();
+      for (uint32_t mesh = 0; mesh < frame.mMeshCount; ++mesh) {
+        vk::DrawIndexedIndirectCommand& command =
+          frame.mDrawTemplateLocation[mesh];
+        command.indexCount    = mMeshRecords[mesh].indexCount;
+        command.instanceCount = 0;
+        command.firstIndex    = mMeshRecords[mesh].firstIndex;
+        command.vertexOffset  = 0;
+        command.firstInstance =
+          mesh < meshRanges.size() ? meshRanges[mesh].first : 0;
+      }
+
+      frame.mObjectsResident = true;
+      frame.mSceneVersion    = scene->get_version();
+    } else {
+      for (uint32_t index : frame.mChangedInstances) {
+        write_object_data(frame, index, scene, index);
+      }
+    }
+    frame.mChangedInstances.clear();
+  } else {
+    mDrawPackets.clear();
+    mFrustumInstances.clear();
+    scene->query_frustum(planes, &mFrustumInstances);
+
+    mCullStats = {};
+    mCullStats.frustumCulled = static_cast<uint32_t>(
+      scene->get_instance_count() - mFrustumInstances.size());
+    if (mOcclusionCulling) {
+      mCullStats.occlusionCulled = cull_occluded(
+        scene, frame.mCameraMatrixData.viewProjection);
+    }
+
+    for (uint32_t index : mFrustumInstances) {
+      if (scene->flags[index] & INSTANCE_FLAG_HIDDEN) {
+        continue;
+      }
+
+      const float distance =
+        glm::length(glm::vec3(scene->bounds[index]) - sCameraEye);
+      vkUtil::DrawPacket packet {};
+      packet.key = vkUtil::make_draw_key(
+        0,
+        static_cast<uint32_t>(PipelineTypes::STANDARD),
+        scene->materials[index],
+        static_cast<uint32_t>(scene->meshes[index]),
+        vkUtil::make_depth_bucket(distance, sCameraFar));
+      packet.instance = index;
+      mDrawPackets.push_back(packet);
+    }
+    vkUtil::radix_sort(&mDrawPackets, &mDrawPacketScratch);
+    mCullStats.drawCount = static_cast<uint32_t>(mDrawPackets.size());
+
+    // Instances are uploaded in packet order so each draw group is a
+    // contiguous run of them.
+    for (uint32_t i = 0; i < mDrawPackets.size(); ++i) {
+      write_object_data(frame, i, scene, mDrawPackets[i].instance);
     }
+    frame.mInstanceCount   = static_cast<uint32_t>(mDrawPackets.size());
+    frame.mObjectsResident = false;
+    frame.mChangedInstances.clear();
   }
-  memcpy(frame.mModelBufferWriteLocation,
-         frame.mModelTransforms.data(),
-         i * sizeof(glm::mat4));
 
   frame.write_descriptor_set();
 }
 
+void Engine::write_object_data(
+  vkUtil::FrameContext& frame,
+  uint32_t slot,
+  Scene* scene,
+  uint32_t index
+) {
+  const vkUtil::DrawPushConstants& draw =
+    mMaterialConstants[scene->materials[index]];
+  const uint32_t mesh = static_cast<uint32_t>(scene->meshes[index]);
+
+  vkUtil::ObjectData object {};
+  object.model       = scene->get_model(index);
+  object.uvTransform = draw.uvTransform;
+  object.bounds      = mMeshSpheres[mesh];
+  object.mesh        = mesh;
+  object.material    = draw.material;
+  object.flags       = draw.flags;
+  if (scene->flags[index] & INSTANCE_FLAG_HIDDEN) {
+    object.flags |= vkUtil::DRAW_FLAG_HIDDEN;
+  }
+  frame.mModelBufferWriteLocation[slot] = object;
+}
+
+uint32_t Engine::cull_occluded(
+  Scene* scene,
+  const glm::mat4& viewProjection
+) {
+  mOcclusionBuffer.resize(
+    sOcclusionWidth,
+    sOcclusionWidth * mSwapchainExtent.height / mSwapchainExtent.width);
+  mOcclusionBuffer.begin(viewProjection);
+  for (uint32_t index : mFrustumInstances) {
+    auto occluder = mOccluderMeshes.find(scene->meshes[index]);
+    if (occluder != mOccluderMeshes.end()
+        && !(scene->flags[index] & INSTANCE_FLAG_HIDDEN)) {
+      mOcclusionBuffer.add_occluder(occluder->second, scene->get_model(index));
+    }
+  }
+  if (!mOcclusionBuffer.get_triangle_count()) {
+    return 0;
+  }
+
+  // Bands of tile rows are independent, and so are the tests once every
+  // band is drawn.
+  mJobPool.dispatch(
+    mOcclusionBuffer.get_band_count(),
+    [this](uint32_t band) { mOcclusionBuffer.rasterize(band); });
+
+  const uint32_t count = static_cast<uint32_t>(mFrustumInstances.size());
+  mOccluded.assign(count, 0);
+  mJobPool.dispatch(
+    (count + sOcclusionBatch - 1) / sOcclusionBatch,
+    [this, scene, count](uint32_t job) {
+      const uint32_t last = std::min(count, (job + 1) * sOcclusionBatch);
+      for (uint32_t i = job * sOcclusionBatch; i < last; ++i) {
+        const uint32_t index = mFrustumInstances[i];
+        // Occluders are drawn, they would only hide each other.
+        if (!mOccluderMeshes.count(scene->meshes[index])) {
+          mOccluded[i] = mOcclusionBuffer.is_occluded(scene->bounds[index]);
+        }
+      }
+    });
+
+  uint32_t visible = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    if (!mOccluded[i]) {
+      mFrustumInstances[visible++] = mFrustumInstances[i];
+    }
+  }
+  mFrustumInstances.resize(visible);
+
+  return count - visible;
+}
+
+void Engine::update_streaming(Scene* scene) {
+  // Projected diameter of each instance's bounding sphere, in pixels.
+  const float pixelsPerUnit =
+    static_cast<float>(mSwapchainExtent.height) / std::tan(sCameraFov * 0.5f);
+
+  for (const Scene::DrawRange& range : scene->get_draw_ranges()) {
+    // Atlased materials are small enough to stay resident.
+    auto material =
+      mMaterials.find(static_cast<vkMesh::MeshTypes>(range.material));
+    if (material == mMaterials.end()) {
+      continue;
+    }
+
+    vkImage::Texture* texture = material->second;
+    for (uint32_t index = range.first;
+         index < range.first + range.count;
+         ++index) {
+      const glm::vec4& sphere = scene->bounds[index];
+      float distance = std::max(
+        glm::length(glm::vec3(sphere) - sCameraEye), sCameraNear);
+      mTextureStreamer->request(texture, sphere.w / distance * pixelsPerUnit);
+    }
+  }
+
+  // The material constants and the resident object data carry the bindless
+  // slot of each material, refresh them when streaming moved one.
+  if (mTextureStreamer->update()) {
+    for (const auto& [type, _] : mMaterials) {
+      mMaterialConstants[static_cast<uint32_t>(type)] =
+        make_draw_constants(type);
+    }
+    for (vkUtil::FrameContext& f : mFrameContexts) {
+      f.mObjectsResident = false;
+    }
+  }
+}
+
 void Engine::make_framebuffers() {
   vkInit::FramebufferInput framebufferInput{};
   framebufferInput.device          = mDevice;
   framebufferInput.renderPass      = mRenderPass;
   framebufferInput.swapchainExtent = mSwapchainExtent;
+  for (const vkUtil::FrameContext& f : mFrameContexts) {
+    framebufferInput.depthViews.push_back(f.mDepthBufferView);
+  }
 
   vkInit::make_framebuffers(framebufferInput, &mSwapchainFrames, mHasDebug);
 }
 
-void Engine::make_frame_resources() {
-  vkInit::DescriptorSetLayoutData bindings;
-  bindings.count = 1;
-  bindings.types.push_back(vk::DescriptorType::eUniformBuffer);
-  mFrameDescriptorPool = vkInit::make_descriptor_pool(
-    mDevice,
-    static_cast<uint32_t>(mSwapchainFrames.size()) * 2,
-    bindings,
-    mHasDebug);
+void Engine::make_depth_buffers() {
+  const bool hiZ = uses_depth_pyramid();
+  for (vkUtil::FrameContext& f : mFrameContexts) {
+    f.make_depth_resources(mDepthFormat, mSwapchainExtent, hiZ);
+  }
+
+  if (mHasDebug && hiZ) {
+    printf("Depth: %zu stored buffers with %zu level pyramids.\n",
+           mFrameContexts.size(),
+           mFrameContexts[0].mDepthPyramidExtents.size());
+  } else if (mHasDebug) {
+    // Committed depth memory at 4K, against one buffer per swapchain image.
+    const size_t bytesPerBuffer = 3840ull * 2160 * 4;
+    const size_t perImage = mSwapchainFrames.size() * bytesPerBuffer;
+    const size_t perContext = mFrameContexts[0].mDepthLazilyAllocated
+      ? 0
+      : mFrameContexts.size() * bytesPerBuffer;
+    printf("Depth: %zu transient buffers%s, at 3840x2160 %.1f MiB instead "
+           "of %.1f MiB for %zu swapchain images.\n",
+           mFrameContexts.size(),
+           mFrameContexts[0].mDepthLazilyAllocated
+             ? " in lazily allocated memory"
+             : "",
+           perContext / (1024.0 * 1024.0),
+           perImage / (1024.0 * 1024.0),
+           mSwapchainFrames.size());
+  }
+}
+
+void Engine::make_frame_contexts() {
+  mFrameContexts.resize(mMaxFramesInFlight);
+
+  vkInit::CommandBufferInputChunk commandBufferInput{};
+  commandBufferInput.device      = mDevice;
+  commandBufferInput.frames      = &mFrameContexts;
+  commandBufferInput.commandPool = mCommandPool;
+  vkInit::make_frame_command_buffers(&commandBufferInput, mHasDebug);
+
+  for (vkUtil::FrameContext& f : mFrameContexts) {
+    f.mDevice              = mDevice;
+    f.mPhysicalDevice      = mPhysicalDevice;
+    f.mDepthPyramidSampler = mDepthPyramidSampler;
+
+    for (uint32_t i = 0; i < mJobPool.get_worker_count(); ++i) {
+      vk::CommandPool pool = vkInit::make_command_pool(
+        mDevice, mPhysicalDevice, mSurface, mHasDebug);
+
+      // One secondary buffer for the main pass, one for the prepass.
+      vk::CommandBufferAllocateInfo allocInfo {};
+      allocInfo.commandPool        = pool;
+      allocInfo.level              = vk::CommandBufferLevel::eSecondary;
+      allocInfo.commandBufferCount = 2;
+
+      f.mJobCommandPools.push_back(pool);
+      try {
+        std::vector<vk::CommandBuffer> buffers =
+          mDevice.allocateCommandBuffers(allocInfo);
+        f.mJobCommandBuffers.push_back(buffers[0]);
+        f.mJobPrepassCommandBuffers.push_back(buffers[1]);
+      } catch (vk::SystemError err) {
+        printf("Error while creating secondary command buffer. Error %s\n",
+               err.what());
+      }
+    }
 
-  for (vkUtil::SwapChainFrame& f : mSwapchainFrames) {
-    vkUtil::SwapChainFrame::SyncObjects so {};
     f.mInFlight = vkInit::make_fence(mDevice, mHasDebug);
     f.mImageAvailable = vkInit::make_semaphore(mDevice, mHasDebug);
-    f.mRenderFinished = vkInit::make_semaphore(mDevice, mHasDebug);
+
+    if (mTimestampPeriod > 0.0f) {
+      vk::QueryPoolCreateInfo queryInfo {};
+      queryInfo.queryType  = vk::QueryType::eTimestamp;
+      queryInfo.queryCount = 2;
+      try {
+        f.mTimestampPool = mDevice.createQueryPool(queryInfo);
+      } catch (vk::SystemError err) {
+        printf("Error while creating timestamp query pool. Error %s\n",
+               err.what());
+      }
+    }
 
     f.make_descriptor_resources();
 
-    f.mDescriptorSet[PipelineTypes::SKY] =
-      vkInit::allocate_descriptor_set(
-        mDevice,
-        mFrameDescriptorPool,
-        mFrameSetLayout[PipelineTypes::SKY],
-        mHasDebug
-      );
-    f.mDescriptorSet[PipelineTypes::STANDARD] =
-      vkInit::allocate_descriptor_set(
-        mDevice,
-        mFrameDescriptorPool,
-        mFrameSetLayout[PipelineTypes::STANDARD],
-        mHasDebug
-      );
+    for (PipelineTypes pt : sPipelineTypes) {
+      f.mDescriptorSet[pt] =
+        mDescriptorAllocator.allocate(mFrameSetLayout[pt]);
+    }
+    f.mCullDescriptorSet = mDescriptorAllocator.allocate(mCullSetLayout);
+    // Enough for any swapchain size, so a resize only rewrites them.
+    for (uint32_t level = 0; level < vkUtil::sMaxPyramidLevels; ++level) {
+      f.mDepthPyramidSets.push_back(
+        mDescriptorAllocator.allocate(mDepthPyramidSetLayout));
+    }
 
-    f.record_write_operations();
+    // The sets are first written by prepare_frame, once the mesh table
+    // exists.
+    f.mUpdateTemplate     = mFrameUpdateTemplate;
+    f.mCullUpdateTemplate = mCullUpdateTemplate;
   }
 }
 
-void Engine::render_objects(vk::CommandBuffer commandBuffer,
-                           vkMesh::MeshTypes objType,
-                           uint32_t* startInstance, uint32_t instanceCount) {
-  uint32_t firstIndex = mMeshes->getOffset(objType);
-  uint32_t indexCount = mMeshes->getSize(objType);
-  mMaterials[objType]->use(
-    commandBuffer,
-    mPipelineLayout[PipelineTypes::STANDARD]
-  );
-  commandBuffer.drawIndexed(
-    indexCount, instanceCount, firstIndex, 0, *startInstance);
-  *startInstance += instanceCount;
+vkUtil::DrawBindings Engine::make_draw_bindings(
+  vk::DescriptorSet frameSet,
+  bool depthPrepass
+) const {
+  vkUtil::DrawBindings bindings {};
+  bindings.layout         = mPipelineLayout.at(PipelineTypes::STANDARD);
+  bindings.pipeline       =
+    depthPrepass ? mDepthPrepassPipeline : get_standard_pipeline();
+  bindings.descriptorSets = {
+    frameSet, mTextureRegistry->get_descriptor_set()
+  };
+  bindings.vertexBuffer   = depthPrepass
+    ? mMeshes->getPositionBuffer().buffer
+    : mMeshes->getVertexBuffer().buffer;
+  bindings.indexBuffer    = mMeshes->getIndexBuffer().buffer;
+  return bindings;
 }
 
-void Engine::record_draw_commands_standard(
+vkUtil::DrawPushConstants Engine::make_draw_constants(
+  vkMesh::MeshTypes objType
+) const {
+  vkUtil::DrawPushConstants draw {};
+
+  std::optional<uint32_t> index;
+  auto region = mAtlasRegions.find(objType);
+  if (region != mAtlasRegions.end()) {
+    draw.uvTransform = mAtlas->get_uv_transform(region->second);
+    draw.flags       = vkUtil::DRAW_FLAG_ATLAS;
+    index            = mAtlas->get_index();
+  } else {
+    draw.uvTransform = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+    draw.flags       = 0;
+    index            = mMaterials.at(objType)->get_index();
+  }
+
+  if (index) {
+    draw.material = *index;
+  } else {
+    draw.material = 0;
+    draw.flags   |= vkUtil::DRAW_FLAG_UNTEXTURED;
+  }
+
+  return draw;
+}
+
+void Engine::record_cull_commands(
   vk::CommandBuffer commandBuffer,
-  uint32_t imageIndex,
-  Scene* scene
+  vkUtil::FrameContext& frame,
+  vkUtil::CullPhase phase
 ) {
-  vk::ClearValue clearColor  =
-    { { 1.0f, 0.5f, 0.25f, 1.0f } };
-  vk::ClearValue clearDepth {};
-  clearDepth.depthStencil = vk::ClearDepthStencilValue(1.0f, 0);
-  std::vector<vk::ClearValue> clearValues = { { clearColor, clearDepth } };
-
-  vk::RenderPassBeginInfo renderPassInfo {};
-  renderPassInfo.renderPass          = mRenderPass[PipelineTypes::STANDARD];
-  renderPassInfo.framebuffer         =
-    mSwapchainFrames[imageIndex].mFramebuffer[PipelineTypes::STANDARD];
-  renderPassInfo.renderArea.offset.x = 0;
-  renderPassInfo.renderArea.offset.y = 0;
-  renderPassInfo.renderArea.extent = mSwapchainExtent;
-  renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-  renderPassInfo.pClearValues = clearValues.data();
+  // The late phase rewrites the commands and visible instances the early
+  // draws read.
+  if (phase == vkUtil::CULL_PHASE_LATE) {
+    commandBuffer.pipelineBarrier(
+      vk::PipelineStageFlagBits::eDrawIndirect
+        | vk::PipelineStageFlagBits::eVertexShader,
+      vk::PipelineStageFlagBits::eTransfer
+        | vk::PipelineStageFlagBits::eComputeShader,
+      vk::DependencyFlags(),
+      nullptr, nullptr, nullptr);
+  }
 
-  commandBuffer.beginRenderPass(&renderPassInfo, vk::SubpassContents::eInline);
+  // Every phase starts from empty per mesh commands. The drawn instance
+  // count restarts every phase, the statistics every frame.
+  vk::BufferCopy templateRegion {};
+  templateRegion.size =
+    frame.mMeshCount * sizeof(vk::DrawIndexedIndirectCommand);
+  commandBuffer.copyBuffer(
+    frame.mDrawTemplateBuffer.buffer,
+    frame.mDrawCommandBuffer.buffer,
+    templateRegion);
+  commandBuffer.fillBuffer(
+    frame.mDrawCountBuffer.buffer,
+    0,
+    phase == vkUtil::CULL_PHASE_LATE
+      ? sizeof(uint32_t)
+      : sizeof(vkUtil::CullCounters),
+    0);
+  if (!frame.mVisibilityCleared) {
+    commandBuffer.fillBuffer(
+      frame.mVisibilityBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+    frame.mVisibilityCleared = true;
+  }
 
+  vk::MemoryBarrier resetBarrier {};
+  resetBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+  resetBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead
+    | vk::AccessFlagBits::eShaderWrite;
+  commandBuffer.pipelineBarrier(
+    vk::PipelineStageFlagBits::eTransfer,
+    vk::PipelineStageFlagBits::eComputeShader,
+    vk::DependencyFlags(),
+    resetBarrier, nullptr, nullptr);
+
+  vkUtil::CullPushConstants cull {};
+  const std::array<glm::vec4, 6> planes =
+    vkUtil::make_frustum_planes(frame.mCameraMatrixData.viewProjection);
+  std::copy(planes.begin(), planes.end(), cull.planes);
+  cull.instanceCount = frame.mInstanceCount;
+  cull.maxDraws      = frame.mMeshCount;
+  cull.phase         = phase;
+
+  commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, mCullPipeline);
   commandBuffer.bindDescriptorSets(
-    vk::PipelineBindPoint::eGraphics,
-    mPipelineLayout[PipelineTypes::STANDARD],
+    vk::PipelineBindPoint::eCompute,
+    mCullPipelineLayout,
     0,
-    mSwapchainFrames[imageIndex].mDescriptorSet[PipelineTypes::STANDARD],
+    frame.mCullDescriptorSet,
     nullptr
   );
+  commandBuffer.pushConstants(
+    mCullPipelineLayout,
+    vk::ShaderStageFlagBits::eCompute,
+    0,
+    sizeof(vkUtil::CullPushConstants),
+    &cull
+  );
+  commandBuffer.dispatch((frame.mInstanceCount + 63) / 64, 1, 1);
+
+  std::array<vk::BufferMemoryBarrier, 3> drawBarriers {};
+  for (vk::BufferMemoryBarrier& barrier : drawBarriers) {
+    barrier.srcAccessMask       = vk::AccessFlagBits::eShaderWrite;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.offset              = 0;
+    barrier.size                = VK_WHOLE_SIZE;
+  }
+  drawBarriers[0].buffer        = frame.mDrawCommandBuffer.buffer;
+  drawBarriers[0].dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead;
+  drawBarriers[1].buffer        = frame.mDrawCountBuffer.buffer;
+  drawBarriers[1].dstAccessMask = vk::AccessFlagBits::eTransferRead;
+  drawBarriers[2].buffer        = frame.mVisibleInstanceBuffer.buffer;
+  drawBarriers[2].dstAccessMask = vk::AccessFlagBits::eShaderRead;
+  commandBuffer.pipelineBarrier(
+    vk::PipelineStageFlagBits::eComputeShader,
+    vk::PipelineStageFlagBits::eDrawIndirect
+      | vk::PipelineStageFlagBits::eVertexShader
+      | vk::PipelineStageFlagBits::eTransfer,
+    vk::DependencyFlags(),
+    nullptr, drawBarriers, nullptr);
+
+  // The last phase of the frame holds the statistics, copied for the host
+  // to read once the fence signals.
+  if (phase != vkUtil::CULL_PHASE_EARLY) {
+    vk::BufferCopy region {};
+    region.size = sizeof(vkUtil::CullCounters);
+    commandBuffer.copyBuffer(
+      frame.mDrawCountBuffer.buffer, frame.mCullReadbackBuffer.buffer, region);
+
+    vk::BufferMemoryBarrier readbackBarrier {};
+    readbackBarrier.srcAccessMask       = vk::AccessFlagBits::eTransferWrite;
+    readbackBarrier.dstAccessMask       = vk::AccessFlagBits::eHostRead;
+    readbackBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    readbackBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    readbackBarrier.buffer              = frame.mCullReadbackBuffer.buffer;
+    readbackBarrier.offset              = 0;
+    readbackBarrier.size                = VK_WHOLE_SIZE;
+    commandBuffer.pipelineBarrier(
+      vk::PipelineStageFlagBits::eTransfer,
+      vk::PipelineStageFlagBits::eHost,
+      vk::DependencyFlags(),
+      nullptr, readbackBarrier, nullptr);
+    frame.mCullReadbackWritten = true;
+  }
+}
+
+void Engine::record_depth_pyramid(
+  vk::CommandBuffer commandBuffer,
+  const vkUtil::FrameContext& frame
+) {
+  // The transition covers every aspect of the image, the sampled view only
+  // the depth one.
+  vk::ImageSubresourceRange depthRange {};
+  depthRange.aspectMask     = vk::ImageAspectFlagBits::eDepth;
+  if (vkImage::has_stencil_component(mDepthFormat)) {
+    depthRange.aspectMask |= vk::ImageAspectFlagBits::eStencil;
+  }
+  depthRange.baseMipLevel   = 0;
+  depthRange.levelCount     = 1;
+  depthRange.baseArrayLayer = 0;
+  depthRange.layerCount     = 1;
+
+  vk::ImageMemoryBarrier depthBarrier {};
+  depthBarrier.srcAccessMask       =
+    vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+  depthBarrier.dstAccessMask       = vk::AccessFlagBits::eShaderRead;
+  depthBarrier.oldLayout           =
+    vk::ImageLayout::eDepthStencilAttachmentOptimal;
+  depthBarrier.newLayout           = vk::ImageLayout::eShaderReadOnlyOptimal;
+  depthBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  depthBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  depthBarrier.image               = frame.mDepthBuffer;
+  depthBarrier.subresourceRange    = depthRange;
+
+  // Last frame's contents are not needed, the whole pyramid is rewritten.
+  vk::ImageMemoryBarrier pyramidBarrier {};
+  pyramidBarrier.srcAccessMask       = vk::AccessFlagBits::eShaderRead;
+  pyramidBarrier.dstAccessMask       = vk::AccessFlagBits::eShaderWrite;
+  pyramidBarrier.oldLayout           = vk::ImageLayout::eUndefined;
+  pyramidBarrier.newLayout           = vk::ImageLayout::eGeneral;
+  pyramidBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  pyramidBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  pyramidBarrier.image               = frame.mDepthPyramid;
+  pyramidBarrier.subresourceRange.aspectMask     =
+    vk::ImageAspectFlagBits::eColor;
+  pyramidBarrier.subresourceRange.baseMipLevel   = 0;
+  pyramidBarrier.subresourceRange.levelCount     = VK_REMAINING_MIP_LEVELS;
+  pyramidBarrier.subresourceRange.baseArrayLayer = 0;
+  pyramidBarrier.subresourceRange.layerCount     = 1;
+
+  commandBuffer.pipelineBarrier(
+    vk::PipelineStageFlagBits::eLateFragmentTests
+      | vk::PipelineStageFlagBits::eComputeShader,
+    vk::PipelineStageFlagBits::eComputeShader,
+    vk::DependencyFlags(),
+    nullptr, nullptr, { depthBarrier, pyramidBarrier });
 
   commandBuffer.bindPipeline(
-    vk::PipelineBindPoint::eGraphics,
-    mGraphicsPipeline[PipelineTypes::STANDARD]
-  );
+    vk::PipelineBindPoint::eCompute, mDepthPyramidPipeline);
+
+  // Each level reads the one written just before it.
+  for (size_t level = 0; level < frame.mDepthPyramidExtents.size(); ++level) {
+    const vk::Extent2D extent = frame.mDepthPyramidExtents[level];
+    commandBuffer.bindDescriptorSets(
+      vk::PipelineBindPoint::eCompute,
+      mDepthPyramidPipelineLayout,
+      0,
+      frame.mDepthPyramidSets[level],
+      nullptr
+    );
+    commandBuffer.dispatch((extent.width + 7) / 8, (extent.height + 7) / 8, 1);
+
+    vk::ImageMemoryBarrier levelBarrier = pyramidBarrier;
+    levelBarrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+    levelBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+    levelBarrier.oldLayout     = vk::ImageLayout::eGeneral;
+    levelBarrier.subresourceRange.baseMipLevel =
+      static_cast<uint32_t>(level);
+    levelBarrier.subresourceRange.levelCount   = 1;
+    commandBuffer.pipelineBarrier(
+      vk::PipelineStageFlagBits::eComputeShader,
+      vk::PipelineStageFlagBits::eComputeShader,
+      vk::DependencyFlags(),
+      nullptr, nullptr, levelBarrier);
+  }
 
-  prepare_scene(commandBuffer);
+  depthBarrier.srcAccessMask = vk::AccessFlagBits::eShaderRead;
+  depthBarrier.dstAccessMask =
+    vk::AccessFlagBits::eDepthStencilAttachmentRead
+    | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+  depthBarrier.oldLayout     = vk::ImageLayout::eShaderReadOnlyOptimal;
+  depthBarrier.newLayout     = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+  commandBuffer.pipelineBarrier(
+    vk::PipelineStageFlagBits::eComputeShader,
+    vk::PipelineStageFlagBits::eEarlyFragmentTests
+      | vk::PipelineStageFlagBits::eLateFragmentTests,
+    vk::DependencyFlags(),
+    nullptr, nullptr, depthBarrier);
+}
 
-  {
-    uint32_t startInstance = 0;
-    for (const auto& [key, val] : scene->positions) {
-      render_objects(
-        commandBuffer,
-        key,
-        &startInstance,
-        static_cast<uint32_t>(val.size())
-      );
-    }
+void Engine::record_indirect_draws(
+  vk::CommandBuffer commandBuffer,
+  const vkUtil::FrameContext& frame
+) {
+  const vk::PipelineLayout layout =
+    mPipelineLayout.at(PipelineTypes::STANDARD);
+  const vk::DescriptorSet frameSet =
+    frame.mDescriptorSet.at(PipelineTypes::STANDARD);
+  commandBuffer.bindDescriptorSets(
+    vk::PipelineBindPoint::eGraphics, layout, 0, frameSet, nullptr);
+  mTextureRegistry->use(commandBuffer, layout);
+
+  vkUtil::DrawPushConstants draw {};
+  draw.flags = vkUtil::DRAW_FLAG_GPU_DRIVEN;
+  commandBuffer.pushConstants(
+    layout,
+    vk::ShaderStageFlagBits::eVertex,
+    0,
+    sizeof(vkUtil::DrawPushConstants),
+    &draw
+  );
+
+  // The prepass replays the same indirect commands with positions only.
+  if (mDepthPrepass) {
+    commandBuffer.bindPipeline(
+      vk::PipelineBindPoint::eGraphics, mDepthPrepassPipeline);
+    prepare_scene(commandBuffer, true);
+    commandBuffer.drawIndexedIndirect(
+      frame.mDrawCommandBuffer.buffer, 0,
+      frame.mMeshCount,
+      sizeof(vk::DrawIndexedIndirectCommand)
+    );
   }
 
-  commandBuffer.endRenderPass();
+  commandBuffer.bindPipeline(
+    vk::PipelineBindPoint::eGraphics, get_standard_pipeline());
+  prepare_scene(commandBuffer);
+  commandBuffer.drawIndexedIndirect(
+    frame.mDrawCommandBuffer.buffer, 0,
+    frame.mMeshCount,
+    sizeof(vk::DrawIndexedIndirectCommand)
+  );
 }
 
-void Engine::record_draw_commands_sky(
+void Engine::record_draw_commands(
   vk::CommandBuffer commandBuffer,
-  uint32_t imageIndex,
-  Scene* scene
+  uint32_t imageIndex
 ) {
   vk::ClearValue clearColor  =
     { { 1.0f, 0.5f, 0.25f, 1.0f } };
-  std::vector<vk::ClearValue> clearValues = { { clearColor } };
+  vk::ClearValue clearDepth {};
+  clearDepth.depthStencil = vk::ClearDepthStencilValue(1.0f, 0);
+  std::vector<vk::ClearValue> clearValues = { { clearColor, clearDepth } };
 
   vk::RenderPassBeginInfo renderPassInfo {};
-  renderPassInfo.renderPass          = mRenderPass[PipelineTypes::SKY];
+  renderPassInfo.renderPass          = mRenderPass;
   renderPassInfo.framebuffer         =
-    mSwapchainFrames[imageIndex].mFramebuffer[PipelineTypes::SKY];
+    mSwapchainFrames[imageIndex].mFramebuffer[mFrameNumber];
   renderPassInfo.renderArea.offset.x = 0;
   renderPassInfo.renderArea.offset.y = 0;
   renderPassInfo.renderArea.extent = mSwapchainExtent;
   renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
   renderPassInfo.pClearValues = clearValues.data();
 
-  commandBuffer.beginRenderPass(&renderPassInfo, vk::SubpassContents::eInline);
+  vkUtil::FrameContext& context = mFrameContexts[mFrameNumber];
+  vk::DescriptorSet frameSet =
+    context.mDescriptorSet[PipelineTypes::STANDARD];
+
+  if (mGpuDriven) {
+    // Dynamic state lasts for the whole command buffer, across passes.
+    record_viewport(commandBuffer);
+
+    // The cull pass writes the commands, a single draw covers the scene
+    // whatever its instance count.
+    if (!uses_depth_pyramid()) {
+      record_cull_commands(commandBuffer, context, vkUtil::CULL_PHASE_ALL);
+      commandBuffer.beginRenderPass(
+        &renderPassInfo, vk::SubpassContents::eInline);
+      record_indirect_draws(commandBuffer, context);
+      record_sky_commands(commandBuffer);
+      commandBuffer.endRenderPass();
+      return;
+    }
+
+    // Early phase: what was visible last time, drawn to get occluders.
+    record_cull_commands(commandBuffer, context, vkUtil::CULL_PHASE_EARLY);
+    renderPassInfo.renderPass = mEarlyRenderPass;
+    commandBuffer.beginRenderPass(
+      &renderPassInfo, vk::SubpassContents::eInline);
+    record_indirect_draws(commandBuffer, context);
+    commandBuffer.endRenderPass();
+
+    // Late phase: everything against the pyramid of the early depth, only
+    // what was not drawn yet is drawn, so nothing pops in a frame late.
+    record_depth_pyramid(commandBuffer, context);
+    record_cull_commands(commandBuffer, context, vkUtil::CULL_PHASE_LATE);
+
+    vk::MemoryBarrier colorBarrier {};
+    colorBarrier.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+    colorBarrier.dstAccessMask = vk::AccessFlagBits::eColorAttachmentRead
+      | vk::AccessFlagBits::eColorAttachmentWrite;
+    commandBuffer.pipelineBarrier(
+      vk::PipelineStageFlagBits::eColorAttachmentOutput,
+      vk::PipelineStageFlagBits::eColorAttachmentOutput,
+      vk::DependencyFlags(),
+      colorBarrier, nullptr, nullptr);
+
+    renderPassInfo.renderPass = mLateRenderPass;
+    commandBuffer.beginRenderPass(
+      &renderPassInfo, vk::SubpassContents::eInline);
+    record_indirect_draws(commandBuffer, context);
+    record_sky_commands(commandBuffer);
+    commandBuffer.endRenderPass();
+    return;
+  }
+
+  commandBuffer.beginRenderPass(
+    &renderPassInfo, vk::SubpassContents::eSecondaryCommandBuffers);
+
+  // Draw groups are split in contiguous chunks, one per job, each recorded
+  // into the job's secondary buffer. The last job also draws the sky after
+  // its groups, so there is always at least one. With the prepass each job
+  // records its groups twice, and all prepass buffers run first so the main
+  // pass sees the depth of the whole scene.
+  vkUtil::make_draw_groups(
+    mDrawPackets, mMeshRecords, mMaterialConstants, &mDrawGroups);
+  const std::vector<vkUtil::DrawGroup>& groups = mDrawGroups;
+  const uint32_t jobCount = std::max(1u, std::min(
+    mJobPool.get_worker_count(), static_cast<uint32_t>(groups.size())));
+
+  vk::CommandBufferInheritanceInfo inheritanceInfo {};
+  inheritanceInfo.renderPass  = renderPassInfo.renderPass;
+  inheritanceInfo.subpass     = 0;
+  inheritanceInfo.framebuffer = renderPassInfo.framebuffer;
+
+  const vkUtil::DrawBindings mainBindings =
+    make_draw_bindings(frameSet, false);
+  const vkUtil::DrawBindings prepassBindings =
+    make_draw_bindings(frameSet, true);
+
+  std::vector<vkUtil::DrawStats> jobStats(jobCount);
+  mJobPool.dispatch(jobCount, [&](uint32_t job) {
+    const size_t first = groups.size() * job / jobCount;
+    const size_t last  = groups.size() * (job + 1) / jobCount;
+
+    mDevice.resetCommandPool(context.mJobCommandPools[job]);
+
+    vk::CommandBufferBeginInfo beginInfo {};
+    beginInfo.flags = vk::CommandBufferUsageFlagBits::eRenderPassContinue
+      | vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    if (mDepthPrepass) {
+      vk::CommandBuffer prepass = context.mJobPrepassCommandBuffers[job];
+      prepass.begin(beginInfo);
+      record_viewport(prepass);
+      vkUtil::record_draw_groups(
+        prepass, prepassBindings, groups, first, last);
+      prepass.end();
+    }
+
+    vk::CommandBuffer secondary = context.mJobCommandBuffers[job];
+    secondary.begin(beginInfo);
+    record_viewport(secondary);
+
+    jobStats[job] = vkUtil::record_draw_groups(
+      secondary, mainBindings, groups, first, last);
+    if (job == jobCount - 1) {
+      record_sky_commands(secondary);
+    }
+
+    secondary.end();
+  });
+
+  mDrawStats = {};
+  for (uint32_t job = 0; job < jobCount; ++job) {
+    mDrawStats.pipelineBinds   += jobStats[job].pipelineBinds;
+    mDrawStats.descriptorBinds += jobStats[job].descriptorBinds;
+    mDrawStats.pushConstants   += jobStats[job].pushConstants;
+    mDrawStats.draws           += jobStats[job].draws;
+  }
+
+  if (mDepthPrepass) {
+    commandBuffer.executeCommands(
+      jobCount, context.mJobPrepassCommandBuffers.data());
+  }
+  commandBuffer.executeCommands(jobCount, context.mJobCommandBuffers.data());
+
+  commandBuffer.endRenderPass();
+}
+
+void Engine::record_sky_commands(vk::CommandBuffer commandBuffer) const {
+  const vk::PipelineLayout layout = mPipelineLayout.at(PipelineTypes::SKY);
 
   commandBuffer.bindDescriptorSets(
     vk::PipelineBindPoint::eGraphics,
-    mPipelineLayout[PipelineTypes::SKY],
+    layout,
     0,
-    mSwapchainFrames[imageIndex].mDescriptorSet[PipelineTypes::SKY],
+    mFrameContexts[mFrameNumber].mDescriptorSet.at(PipelineTypes::SKY),
     nullptr
   );
 
   commandBuffer.bindPipeline(
     vk::PipelineBindPoint::eGraphics,
-    mGraphicsPipeline[PipelineTypes::SKY]
+    mGraphicsPipeline.at(PipelineTypes::SKY)
   );
 
-  mSkyCubeMap->use(commandBuffer, mPipelineLayout[PipelineTypes::SKY]);
+  mTextureRegistry->use(commandBuffer, layout);
 
-  commandBuffer.draw(6, 1, 0, 0);
-  commandBuffer.endRenderPass();
+  commandBuffer.draw(3, 1, 0, 0);
+}
+
+void Engine::record_viewport(vk::CommandBuffer commandBuffer) const {
+  vk::Viewport viewport {};
+  viewport.x        = 0.0f;
+  viewport.y        = 0.0f;
+  viewport.width    = static_cast<float>(mSwapchainExtent.width);
+  viewport.height   = static_cast<float>(mSwapchainExtent.height);
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+
+  vk::Rect2D scissor {};
+  scissor.offset.x = 0;
+  scissor.offset.y = 0;
+  scissor.extent   = mSwapchainExtent;
+
+  commandBuffer.setViewport(0, viewport);
+  commandBuffer.setScissor(0, scissor);
+}
+
+vk::Pipeline Engine::get_standard_pipeline() const {
+  return mDepthPrepass
+    ? mDepthTestedPipeline
+    : mGraphicsPipeline.at(PipelineTypes::STANDARD);
+}
+
+void Engine::read_timestamps(vkUtil::FrameContext& frame) {
+  if (!frame.mTimestampsWritten) {
+    return;
+  }
+
+  uint64_t timestamps[2];
+  vk::Result result = mDevice.getQueryPoolResults(
+    frame.mTimestampPool,
+    0,
+    2,
+    sizeof(timestamps),
+    timestamps,
+    sizeof(uint64_t),
+    vk::QueryResultFlagBits::e64
+  );
+  if (result == vk::Result::eSuccess) {
+    mGpuTime = static_cast<float>(timestamps[1] - timestamps[0])
+      * mTimestampPeriod / 1e6f;
+  }
+}
+
+void Engine::read_cull_stats(vkUtil::FrameContext& frame) {
+  if (!frame.mCullReadbackWritten) {
+    return;
+  }
+
+  memcpy(&mCullStats, frame.mCullReadbackLocation, sizeof(mCullStats));
+  frame.mCullReadbackWritten = false;
 }
 
 void Engine::render(Scene* scene) {
-  vk::Fence inFlight = mSwapchainFrames[mFrameNumber].mInFlight;
+  scene->flush();
+
+  vkUtil::FrameContext& context = mFrameContexts[mFrameNumber];
+  vk::Fence inFlight = context.mInFlight;
   mDevice.waitForFences(
     1, &inFlight, VK_TRUE, UINT64_MAX);
 
+  read_timestamps(context);
+  read_cull_stats(context);
+  update_streaming(scene);
+
+  // A resized window keeps presenting, scaled, until its size settles. Out
+  // of date swapchains cannot present at all and are recreated at once.
+  if (resize_settled()) {
+    recreate_swapchain();
+  }
+
   uint32_t imageIndex;
   try {
     vk::ResultValue acquire =
       mDevice.acquireNextImageKHR(
         mSwapchain, UINT64_MAX,
-        mSwapchainFrames[mFrameNumber].mImageAvailable, nullptr);
+        context.mImageAvailable, nullptr);
     imageIndex = acquire.value;
   } catch (vk::OutOfDateKHRError) {
     recreate_swapchain();
     return;
   }
 
-  vk::CommandBuffer commandBuffer =
-    mSwapchainFrames[mFrameNumber].mCommandBuffer;
+  // Only now is this frame going to be submitted. Advancing on a frame
+  // that returned early would count a fence that was already waited on.
+  mDeletionQueue.advance(mMaxFramesInFlight);
+
+  vk::CommandBuffer commandBuffer = context.mCommandBuffer;
   commandBuffer.reset();
 
-  prepare_frame(imageIndex, scene);
+  prepare_frame(context, scene);
 
   vk::CommandBufferBeginInfo beginInfo {};
   try {
@@ -619,8 +1854,17 @@ void Engine::render(Scene* scene) {
     }
   }
 
-  record_draw_commands_sky(commandBuffer, imageIndex, scene);
-  record_draw_commands_standard(commandBuffer, imageIndex, scene);
+  if (context.mTimestampPool) {
+    commandBuffer.resetQueryPool(context.mTimestampPool, 0, 2);
+    commandBuffer.writeTimestamp(
+      vk::PipelineStageFlagBits::eTopOfPipe, context.mTimestampPool, 0);
+  }
+  record_draw_commands(commandBuffer, imageIndex);
+  if (context.mTimestampPool) {
+    commandBuffer.writeTimestamp(
+      vk::PipelineStageFlagBits::eBottomOfPipe, context.mTimestampPool, 1);
+    context.mTimestampsWritten = true;
+  }
 
   try {
     commandBuffer.end();
@@ -632,9 +1876,9 @@ void Engine::render(Scene* scene) {
   }
 
   vk::Semaphore waitSemaphores[] =
-    { mSwapchainFrames[mFrameNumber].mImageAvailable };
+    { context.mImageAvailable };
   vk::Semaphore signalSemaphores[] =
-    { mSwapchainFrames[mFrameNumber].mRenderFinished };
+    { mSwapchainFrames[imageIndex].mRenderFinished };
   vk::PipelineStageFlags waitStages[] =
     { vk::PipelineStageFlagBits::eColorAttachmentOutput };
   vk::SubmitInfo submitInfo {};
@@ -673,11 +1917,10 @@ void Engine::render(Scene* scene) {
     present = vk::Result::eErrorOutOfDateKHR;
   }
 
-  if (present == vk::Result::eErrorOutOfDateKHR
-      || present == vk::Result::eSuboptimalKHR) {
-    printf("Recreating...\n");
+  if (present == vk::Result::eErrorOutOfDateKHR) {
     recreate_swapchain();
-    return;
+  } else if (present == vk::Result::eSuboptimalKHR) {
+    mSwapchainSuboptimal = true;
   }
 
   mFrameNumber = (mFrameNumber + 1) % mMaxFramesInFlight;
@@ -687,7 +1930,8 @@ void Engine::cleanup_swapchain() {
   for (vkUtil::SwapChainFrame& f : mSwapchainFrames) {
     f.destroy();
   }
+  for (vkUtil::FrameContext& f : mFrameContexts) {
+    f.destroy_depth_resources();
+  }
   mDevice.destroySwapchainKHR(mSwapchain);
-
-  mDevice.destroyDescriptorPool(mFrameDescriptorPool);
 }
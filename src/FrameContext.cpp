@@ -0,0 +1,411 @@
+// Copyright (c) 2024 Meerkat
+#include "../inc/FrameContext.h"
+#include "../inc/DeletionQueue.h"
+#include "../inc/Image.h"
+#include <algorithm>
+#include <array>
+
+vkUtil::FrameContext::FrameContext() {
+}
+
+vkUtil::FrameContext::~FrameContext() {
+}
+
+void vkUtil::FrameContext::make_descriptor_resources() {
+  BufferInputChunk input {};
+
+  {
+    input.physicalDevice   = mPhysicalDevice;
+    input.device           = mDevice;
+    input.memoryProperties = vk::MemoryPropertyFlagBits::eHostVisible
+      | vk::MemoryPropertyFlagBits::eHostCoherent;
+    input.size             = sizeof(CameraMatrices);
+    input.usage            = vk::BufferUsageFlagBits::eUniformBuffer;
+
+    mCameraMatrixBuffer = createBuffer(input);
+
+    mCameraMatrixWriteLocation = mDevice.mapMemory(
+      mCameraMatrixBuffer.bufferMemory,
+      0,
+      sizeof(CameraMatrices)
+    );
+  }
+
+  {
+    input.size             = sizeof(CameraVectors);
+
+    mCameraVectorsBuffer = createBuffer(input);
+
+    mCameraVectorsWriteLocation = mDevice.mapMemory(
+      mCameraVectorsBuffer.bufferMemory,
+      0,
+      sizeof(CameraVectors)
+    );
+  }
+
+  {
+    input.memoryProperties = vk::MemoryPropertyFlagBits::eDeviceLocal;
+    input.size             = sizeof(CullCounters);
+    input.usage            = vk::BufferUsageFlagBits::eStorageBuffer
+      | vk::BufferUsageFlagBits::eIndirectBuffer
+      | vk::BufferUsageFlagBits::eTransferSrc
+      | vk::BufferUsageFlagBits::eTransferDst;
+
+    mDrawCountBuffer = createBuffer(input);
+  }
+
+  {
+    input.memoryProperties = vk::MemoryPropertyFlagBits::eHostVisible
+      | vk::MemoryPropertyFlagBits::eHostCoherent;
+    input.size             = sizeof(CullCounters);
+    input.usage            = vk::BufferUsageFlagBits::eTransferDst;
+
+    mCullReadbackBuffer = createBuffer(input);
+
+    mCullReadbackLocation = mDevice.mapMemory(
+      mCullReadbackBuffer.bufferMemory, 0, sizeof(CullCounters));
+  }
+
+  mDescriptors.cameraMatrix.buffer = mCameraMatrixBuffer.buffer;
+  mDescriptors.cameraMatrix.offset = 0;
+  mDescriptors.cameraMatrix.range  = sizeof(CameraMatrices);
+
+  mDescriptors.cameraVectors.buffer = mCameraVectorsBuffer.buffer;
+  mDescriptors.cameraVectors.offset = 0;
+  mDescriptors.cameraVectors.range  = sizeof(CameraVectors);
+
+  mDescriptors.drawCount.buffer = mDrawCountBuffer.buffer;
+  mDescriptors.drawCount.offset = 0;
+  mDescriptors.drawCount.range  = sizeof(CullCounters);
+
+  make_instance_buffers();
+}
+
+void vkUtil::FrameContext::reserve_instances(uint32_t count) {
+  if (count <= mInstanceCapacity) {
+    return;
+  }
+
+  destroy_instance_buffers();
+  mInstanceCapacity = std::max(count, 2 * mInstanceCapacity);
+  make_instance_buffers();
+}
+
+void vkUtil::FrameContext::make_draw_buffers(uint32_t meshCount) {
+  mMeshCount = meshCount;
+  const size_t size = meshCount * sizeof(vk::DrawIndexedIndirectCommand);
+
+  BufferInputChunk input {};
+  input.physicalDevice   = mPhysicalDevice;
+  input.device           = mDevice;
+  input.memoryProperties = vk::MemoryPropertyFlagBits::eDeviceLocal;
+  input.size             = size;
+  input.usage            = vk::BufferUsageFlagBits::eStorageBuffer
+    | vk::BufferUsageFlagBits::eIndirectBuffer
+    | vk::BufferUsageFlagBits::eTransferDst;
+
+  mDrawCommandBuffer = createBuffer(input);
+
+  input.memoryProperties = vk::MemoryPropertyFlagBits::eHostVisible
+    | vk::MemoryPropertyFlagBits::eHostCoherent;
+  input.usage            = vk::BufferUsageFlagBits::eTransferSrc;
+
+  mDrawTemplateBuffer   = createBuffer(input);
+  mDrawTemplateLocation = static_cast<vk::DrawIndexedIndirectCommand*>(
+    mDevice.mapMemory(mDrawTemplateBuffer.bufferMemory, 0, size));
+
+  mDescriptors.drawCommands.buffer = mDrawCommandBuffer.buffer;
+  mDescriptors.drawCommands.offset = 0;
+  mDescriptors.drawCommands.range  = size;
+
+  mDescriptorsDirty = true;
+}
+
+void vkUtil::FrameContext::make_instance_buffers() {
+  BufferInputChunk input {};
+  input.physicalDevice   = mPhysicalDevice;
+  input.device           = mDevice;
+  input.memoryProperties = vk::MemoryPropertyFlagBits::eHostVisible
+    | vk::MemoryPropertyFlagBits::eHostCoherent;
+  input.size             = mInstanceCapacity * sizeof(ObjectData);
+  input.usage            = vk::BufferUsageFlagBits::eStorageBuffer;
+
+  mModelBuffer = createBuffer(input);
+
+  mModelBufferWriteLocation = static_cast<ObjectData*>(mDevice.mapMemory(
+    mModelBuffer.bufferMemory, 0, mInstanceCapacity * sizeof(ObjectData)));
+  mObjectsResident = false;
+
+  input.memoryProperties = vk::MemoryPropertyFlagBits::eDeviceLocal;
+  input.size             = mInstanceCapacity * sizeof(uint32_t);
+  input.usage            = vk::BufferUsageFlagBits::eStorageBuffer;
+
+  mVisibleInstanceBuffer = createBuffer(input);
+
+  input.size             = mInstanceCapacity * sizeof(uint32_t);
+  input.usage            = vk::BufferUsageFlagBits::eStorageBuffer
+    | vk::BufferUsageFlagBits::eTransferDst;
+
+  mVisibilityBuffer   = createBuffer(input);
+  mVisibilityCleared  = false;
+
+  mDescriptors.modelBuffer.buffer = mModelBuffer.buffer;
+  mDescriptors.modelBuffer.offset = 0;
+  mDescriptors.modelBuffer.range  = mInstanceCapacity * sizeof(ObjectData);
+
+  mDescriptors.visibleInstances.buffer = mVisibleInstanceBuffer.buffer;
+  mDescriptors.visibleInstances.offset = 0;
+  mDescriptors.visibleInstances.range  =
+    mInstanceCapacity * sizeof(uint32_t);
+
+  mDescriptors.visibility.buffer = mVisibilityBuffer.buffer;
+  mDescriptors.visibility.offset = 0;
+  mDescriptors.visibility.range  = mInstanceCapacity * sizeof(uint32_t);
+
+  mDescriptorsDirty = true;
+}
+
+void vkUtil::FrameContext::destroy_instance_buffers() {
+  mDevice.unmapMemory(mModelBuffer.bufferMemory);
+  mDevice.freeMemory(mModelBuffer.bufferMemory);
+  mDevice.destroyBuffer(mModelBuffer.buffer);
+
+  mDevice.freeMemory(mVisibleInstanceBuffer.bufferMemory);
+  mDevice.destroyBuffer(mVisibleInstanceBuffer.buffer);
+
+  mDevice.freeMemory(mVisibilityBuffer.bufferMemory);
+  mDevice.destroyBuffer(mVisibilityBuffer.buffer);
+}
+
+void vkUtil::FrameContext::make_depth_resources(
+  vk::Format format,
+  vk::Extent2D extent,
+  bool hiZ
+) {
+  vkImage::ImageInputChunk imageInfo {};
+  imageInfo.device           = mDevice;
+  imageInfo.physicalDevice   = mPhysicalDevice;
+  imageInfo.tiling           = vk::ImageTiling::eOptimal;
+  imageInfo.usage            = vk::ImageUsageFlagBits::eDepthStencilAttachment
+    | (hiZ
+       ? vk::ImageUsageFlagBits::eSampled
+       : vk::ImageUsageFlagBits::eTransientAttachment);
+  imageInfo.memoryProperties = vk::MemoryPropertyFlagBits::eDeviceLocal;
+  imageInfo.width            = extent.width;
+  imageInfo.height           = extent.height;
+  imageInfo.arraySize        = 1;
+  imageInfo.format           = format;
+
+  mDepthBuffer = vkImage::make_image(imageInfo);
+
+  mDepthLazilyAllocated = false;
+  if (!hiZ) {
+    vk::MemoryRequirements requirements =
+      mDevice.getImageMemoryRequirements(mDepthBuffer);
+    vk::MemoryPropertyFlags lazyProperties =
+      vk::MemoryPropertyFlagBits::eDeviceLocal
+      | vk::MemoryPropertyFlagBits::eLazilyAllocated;
+    mDepthLazilyAllocated = hasMemoryType(
+      mPhysicalDevice, requirements.memoryTypeBits, lazyProperties);
+    if (mDepthLazilyAllocated) {
+      imageInfo.memoryProperties = lazyProperties;
+    }
+  }
+
+  mDepthBufferMemory = vkImage::make_image_memory(imageInfo, mDepthBuffer);
+  mDepthBufferView   = vkImage::make_image_view(
+    mDevice,
+    mDepthBuffer,
+    format,
+    vk::ImageAspectFlagBits::eDepth,
+    vk::ImageViewType::e2D,
+    1
+  );
+
+  mDepthPyramidExtents.clear();
+  if (!hiZ) {
+    mDepthPyramid       = nullptr;
+    mDepthPyramidMemory = nullptr;
+    mDepthPyramidView   = nullptr;
+    mDescriptors.depthPyramid = vk::DescriptorImageInfo();
+    return;
+  }
+
+  // Level 0 halves the depth buffer, rounding up, down to 1x1.
+  vk::Extent2D levelExtent = extent;
+  do {
+    levelExtent.width  = std::max(1u, (levelExtent.width + 1) / 2);
+    levelExtent.height = std::max(1u, (levelExtent.height + 1) / 2);
+    mDepthPyramidExtents.push_back(levelExtent);
+  } while ((levelExtent.width > 1 || levelExtent.height > 1)
+           && mDepthPyramidExtents.size() < sMaxPyramidLevels);
+  const uint32_t levelCount =
+    static_cast<uint32_t>(mDepthPyramidExtents.size());
+
+  imageInfo.usage     = vk::ImageUsageFlagBits::eStorage
+    | vk::ImageUsageFlagBits::eSampled;
+  imageInfo.width     = mDepthPyramidExtents[0].width;
+  imageInfo.height    = mDepthPyramidExtents[0].height;
+  imageInfo.format    = vk::Format::eR32Sfloat;
+  imageInfo.mipLevels = levelCount;
+
+  mDepthPyramid       = vkImage::make_image(imageInfo);
+  mDepthPyramidMemory = vkImage::make_image_memory(imageInfo, mDepthPyramid);
+  mDepthPyramidView   = vkImage::make_image_view(
+    mDevice,
+    mDepthPyramid,
+    vk::Format::eR32Sfloat,
+    vk::ImageAspectFlagBits::eColor,
+    vk::ImageViewType::e2D,
+    1,
+    vk::ComponentMapping(),
+    levelCount
+  );
+  for (uint32_t level = 0; level < levelCount; ++level) {
+    mDepthPyramidLevelViews.push_back(vkImage::make_image_view(
+      mDevice,
+      mDepthPyramid,
+      vk::Format::eR32Sfloat,
+      vk::ImageAspectFlagBits::eColor,
+      vk::ImageViewType::e2D,
+      1,
+      vk::ComponentMapping(),
+      1,
+      level
+    ));
+  }
+
+  mDescriptors.depthPyramid.sampler     = mDepthPyramidSampler;
+  mDescriptors.depthPyramid.imageView   = mDepthPyramidView;
+  mDescriptors.depthPyramid.imageLayout = vk::ImageLayout::eGeneral;
+  mDescriptorsDirty = true;
+}
+
+void vkUtil::FrameContext::destroy_depth_resources() {
+  for (vk::ImageView view : mDepthPyramidLevelViews) {
+    mDevice.destroyImageView(view);
+  }
+  mDepthPyramidLevelViews.clear();
+  mDevice.destroyImageView(mDepthPyramidView);
+  mDevice.destroyImage(mDepthPyramid);
+  mDevice.freeMemory(mDepthPyramidMemory);
+
+  mDevice.destroyImageView(mDepthBufferView);
+  mDevice.destroyImage(mDepthBuffer);
+  mDevice.freeMemory(mDepthBufferMemory);
+}
+
+void vkUtil::FrameContext::retire_depth_resources(
+  DeletionQueue* deletionQueue
+) {
+  vk::Device                 device            = mDevice;
+  std::vector<vk::ImageView> pyramidLevelViews = mDepthPyramidLevelViews;
+  vk::ImageView              pyramidView       = mDepthPyramidView;
+  vk::Image                  pyramid           = mDepthPyramid;
+  vk::DeviceMemory           pyramidMemory     = mDepthPyramidMemory;
+  vk::ImageView              depthView         = mDepthBufferView;
+  vk::Image                  depth             = mDepthBuffer;
+  vk::DeviceMemory           depthMemory       = mDepthBufferMemory;
+  deletionQueue->push([=]() {
+    for (vk::ImageView view : pyramidLevelViews) {
+      device.destroyImageView(view);
+    }
+    device.destroyImageView(pyramidView);
+    device.destroyImage(pyramid);
+    device.freeMemory(pyramidMemory);
+
+    device.destroyImageView(depthView);
+    device.destroyImage(depth);
+    device.freeMemory(depthMemory);
+  });
+
+  mDepthPyramidLevelViews.clear();
+}
+
+void vkUtil::FrameContext::write_descriptor_set() {
+  if (!mDescriptorsDirty) {
+    return;
+  }
+
+  for (PipelineTypes pt : sPipelineTypes) {
+    mDevice.updateDescriptorSetWithTemplate(
+      mDescriptorSet[pt], mUpdateTemplate[pt], &mDescriptors);
+  }
+  mDevice.updateDescriptorSetWithTemplate(
+    mCullDescriptorSet, mCullUpdateTemplate, &mDescriptors);
+
+  // Partially bound, only the late cull phase samples the pyramid.
+  if (mDepthPyramidView) {
+    vk::WriteDescriptorSet pyramidWrite {};
+    pyramidWrite.dstSet          = mCullDescriptorSet;
+    pyramidWrite.dstBinding      = 6;
+    pyramidWrite.descriptorCount = 1;
+    pyramidWrite.descriptorType  = vk::DescriptorType::eCombinedImageSampler;
+    pyramidWrite.pImageInfo      = &mDescriptors.depthPyramid;
+    mDevice.updateDescriptorSets(pyramidWrite, nullptr);
+  }
+
+  // Each pyramid level reads the one below, level 0 reads the depth.
+  for (size_t level = 0; level < mDepthPyramidLevelViews.size(); ++level) {
+    vk::DescriptorImageInfo sourceInfo {};
+    sourceInfo.sampler     = mDepthPyramidSampler;
+    sourceInfo.imageView   = level == 0
+      ? mDepthBufferView
+      : mDepthPyramidLevelViews[level - 1];
+    sourceInfo.imageLayout = level == 0
+      ? vk::ImageLayout::eShaderReadOnlyOptimal
+      : vk::ImageLayout::eGeneral;
+
+    vk::DescriptorImageInfo destinationInfo {};
+    destinationInfo.imageView   = mDepthPyramidLevelViews[level];
+    destinationInfo.imageLayout = vk::ImageLayout::eGeneral;
+
+    std::array<vk::WriteDescriptorSet, 2> writes {};
+    writes[0].dstSet          = mDepthPyramidSets[level];
+    writes[0].dstBinding      = 0;
+    writes[0].descriptorCount = 1;
+    writes[0].descriptorType  = vk::DescriptorType::eCombinedImageSampler;
+    writes[0].pImageInfo      = &sourceInfo;
+    writes[1].dstSet          = mDepthPyramidSets[level];
+    writes[1].dstBinding      = 1;
+    writes[1].descriptorCount = 1;
+    writes[1].descriptorType  = vk::DescriptorType::eStorageImage;
+    writes[1].pImageInfo      = &destinationInfo;
+    mDevice.updateDescriptorSets(writes, nullptr);
+  }
+  mDescriptorsDirty = false;
+}
+
+void vkUtil::FrameContext::destroy() {
+  for (vk::CommandPool pool : mJobCommandPools) {
+    mDevice.destroyCommandPool(pool);
+  }
+  mDevice.destroyQueryPool(mTimestampPool);
+
+  mDevice.destroyFence(mInFlight);
+  mDevice.destroySemaphore(mImageAvailable);
+
+  mDevice.unmapMemory(mCameraMatrixBuffer.bufferMemory);
+  mDevice.freeMemory(mCameraMatrixBuffer.bufferMemory);
+  mDevice.destroyBuffer(mCameraMatrixBuffer.buffer);
+
+  mDevice.unmapMemory(mCameraVectorsBuffer.bufferMemory);
+  mDevice.freeMemory(mCameraVectorsBuffer.bufferMemory);
+  mDevice.destroyBuffer(mCameraVectorsBuffer.buffer);
+
+  destroy_instance_buffers();
+
+  mDevice.freeMemory(mDrawCommandBuffer.bufferMemory);
+  mDevice.destroyBuffer(mDrawCommandBuffer.buffer);
+
+  mDevice.unmapMemory(mDrawTemplateBuffer.bufferMemory);
+  mDevice.freeMemory(mDrawTemplateBuffer.bufferMemory);
+  mDevice.destroyBuffer(mDrawTemplateBuffer.buffer);
+
+  mDevice.freeMemory(mDrawCountBuffer.bufferMemory);
+  mDevice.destroyBuffer(mDrawCountBuffer.buffer);
+
+  mDevice.unmapMemory(mCullReadbackBuffer.bufferMemory);
+  mDevice.freeMemory(mCullReadbackBuffer.bufferMemory);
+  mDevice.destroyBuffer(mCullReadbackBuffer.buffer);
+}
@@ -1,13 +1,14 @@
 // Copyright (c) 2024 Meerkat
 #include "../inc/Image.h"
 #include "../inc/Memory.h"
+#include <algorithm>
 
 vk::Image vkImage::make_image(const ImageInputChunk& input) {
   vk::ImageCreateInfo imageInfo {};
   imageInfo.flags         = vk::ImageCreateFlagBits() | input.flags;
   imageInfo.imageType     = vk::ImageType::e2D;
   imageInfo.extent        = vk::Extent3D(input.width, input.height, 1);
-  imageInfo.mipLevels     = 1;
+  imageInfo.mipLevels     = std::max(1u, input.mipLevels);
   imageInfo.arrayLayers   = input.arraySize;
   imageInfo.format        = input.format;
   imageInfo.tiling        = input.tiling;
@@ -52,43 +53,75 @@ vk::DeviceMemory vkImage::make_image_memory(const ImageInputChunk& input,
 void vkImage::transition_image_layout(const ImageLayoutTransitionJob& job) {
   vkUtil::start_job(job.commandBuffer);
 
+  record_layout_transition(
+    job.commandBuffer,
+    job.image,
+    job.oldLayout,
+    job.newLayout,
+    0,
+    std::max(1u, job.mipLevels),
+    job.arraySize
+  );
+
+  vkUtil::end_job(job.commandBuffer, job.queue);
+}
+
+void vkImage::record_layout_transition(
+  vk::CommandBuffer commandBuffer,
+  vk::Image image,
+  vk::ImageLayout oldLayout,
+  vk::ImageLayout newLayout,
+  uint32_t baseMipLevel,
+  uint32_t levelCount,
+  uint32_t arraySize
+) {
   vk::ImageSubresourceRange access {};
   access.aspectMask     = vk::ImageAspectFlagBits::eColor;
-  access.baseMipLevel   = 0;
-  access.levelCount     = 1;
+  access.baseMipLevel   = baseMipLevel;
+  access.levelCount     = levelCount;
   access.baseArrayLayer = 0;
-  access.layerCount     = job.arraySize;
+  access.layerCount     = arraySize;
 
   vk::ImageMemoryBarrier barrier {};
-  barrier.oldLayout = job.oldLayout;
-  barrier.newLayout = job.newLayout;
+  barrier.oldLayout = oldLayout;
+  barrier.newLayout = newLayout;
   barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
   barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  barrier.image = job.image;
+  barrier.image = image;
   barrier.subresourceRange = access;
 
+  auto layout_access = [](vk::ImageLayout layout,
+                          vk::AccessFlags* accessMask,
+                          vk::PipelineStageFlags* stage) {
+    switch (layout) {
+      case vk::ImageLayout::eTransferDstOptimal:
+        *accessMask = vk::AccessFlagBits::eTransferWrite;
+        *stage      = vk::PipelineStageFlagBits::eTransfer;
+        break;
+      case vk::ImageLayout::eTransferSrcOptimal:
+        *accessMask = vk::AccessFlagBits::eTransferRead;
+        *stage      = vk::PipelineStageFlagBits::eTransfer;
+        break;
+      case vk::ImageLayout::eShaderReadOnlyOptimal:
+        *accessMask = vk::AccessFlagBits::eShaderRead;
+        *stage      = vk::PipelineStageFlagBits::eFragmentShader;
+        break;
+      default:
+        *accessMask = vk::AccessFlagBits::eNoneKHR;
+        *stage      = vk::PipelineStageFlagBits::eTopOfPipe;
+        break;
+    }
+  };
+
   vk::PipelineStageFlags srcStage {};
   vk::PipelineStageFlags dstStage {};
-  if (job.oldLayout == vk::ImageLayout::eUndefined) {
-    barrier.srcAccessMask = vk::AccessFlagBits::eNoneKHR;
-    barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
-
-    srcStage = vk::PipelineStageFlagBits::eTopOfPipe;
-    dstStage = vk::PipelineStageFlagBits::eTransfer;
-  } else {
-    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-    barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
-
-    srcStage = vk::PipelineStageFlagBits::eTransfer;
-    dstStage = vk::PipelineStageFlagBits::eFragmentShader;
-  }
+  layout_access(oldLayout, &barrier.srcAccessMask, &srcStage);
+  layout_access(newLayout, &barrier.dstAccessMask, &dstStage);
 
-  job.commandBuffer.pipelineBarrier(srcStage, dstStage,
-                                    vk::DependencyFlags(),
-                                    nullptr, nullptr,
-                                    barrier);
-
-  vkUtil::end_job(job.commandBuffer, job.queue);
+  commandBuffer.pipelineBarrier(srcStage, dstStage,
+                                vk::DependencyFlags(),
+                                nullptr, nullptr,
+                                barrier);
 }
 
 void vkImage::copy_buffer_to_image(const BufferImageCopyJob& job) {
@@ -124,18 +157,18 @@ vk::ImageView vkImage::make_image_view(
   vk::Format format,
   vk::ImageAspectFlags aspectFlags,
   vk::ImageViewType type,
-  uint32_t arraySize
+  uint32_t arraySize,
+  const vk::ComponentMapping& components,
+  uint32_t mipLevels,
+  uint32_t baseMipLevel
 ) {
   vk::ImageViewCreateInfo createInfo{};
   createInfo.image        = image;
   createInfo.viewType     = type;
-  createInfo.components.r = vk::ComponentSwizzle::eIdentity;
-  createInfo.components.g = vk::ComponentSwizzle::eIdentity;
-  createInfo.components.b = vk::ComponentSwizzle::eIdentity;
-  createInfo.components.a = vk::ComponentSwizzle::eIdentity;
+  createInfo.components   = components;
   createInfo.subresourceRange.aspectMask     = aspectFlags;
-  createInfo.subresourceRange.baseMipLevel   = 0;
-  createInfo.subresourceRange.levelCount     = 1;
+  createInfo.subresourceRange.baseMipLevel   = baseMipLevel;
+  createInfo.subresourceRange.levelCount     = mipLevels;
   createInfo.subresourceRange.baseArrayLayer = 0;
   createInfo.subresourceRange.layerCount     = arraySize;
   createInfo.format = format;
@@ -166,3 +199,24 @@ vk::Format vkImage::find_supported_format(
   printf("Error: Unable to find suitable format.\n");
   throw std::runtime_error("");
 }
+
+bool vkImage::is_format_supported(
+  vk::PhysicalDevice physicalDevice,
+  vk::Format format,
+  vk::ImageTiling tiling,
+  vk::FormatFeatureFlags features) {
+  vk::FormatProperties properties =
+    physicalDevice.getFormatProperties(format);
+
+  if (tiling == vk::ImageTiling::eLinear) {
+    return (properties.linearTilingFeatures & features) == features;
+  }
+  return (properties.optimalTilingFeatures & features) == features;
+}
+
+bool vkImage::has_stencil_component(vk::Format format) {
+  return format == vk::Format::eD16UnormS8Uint
+    || format == vk::Format::eD24UnormS8Uint
+    || format == vk::Format::eD32SfloatS8Uint
+    || format == vk::Format::eS8Uint;
+}
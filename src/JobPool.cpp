@@ -0,0 +1,75 @@
+// Copyright (c) 2024 Meerkat
+#include "../inc/JobPool.h"
+
+vkUtil::JobPool::JobPool() {
+}
+
+vkUtil::JobPool::~JobPool() {
+  destroy();
+}
+
+void vkUtil::JobPool::init(uint32_t workerCount) {
+  mRunning = true;
+  for (uint32_t i = 0; i < workerCount; ++i) {
+    mWorkers.emplace_back(&JobPool::work, this);
+  }
+}
+
+void vkUtil::JobPool::destroy() {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mRunning = false;
+  }
+  mWakeUp.notify_all();
+
+  for (std::thread& worker : mWorkers) {
+    worker.join();
+  }
+  mWorkers.clear();
+}
+
+uint32_t vkUtil::JobPool::get_worker_count() const {
+  return static_cast<uint32_t>(mWorkers.size());
+}
+
+void vkUtil::JobPool::dispatch(uint32_t jobCount, const Job& job) {
+  if (jobCount == 0) {
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(mMutex);
+  mJob         = &job;
+  mJobCount    = jobCount;
+  mNextJob     = 0;
+  mBusyWorkers = static_cast<uint32_t>(mWorkers.size());
+  ++mGeneration;
+  mWakeUp.notify_all();
+
+  mDone.wait(lock, [this]() { return mBusyWorkers == 0; });
+  mJob = nullptr;
+}
+
+void vkUtil::JobPool::work() {
+  uint64_t generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mWakeUp.wait(lock, [this, generation]() {
+        return !mRunning || mGeneration != generation;
+      });
+      if (!mRunning) {
+        return;
+      }
+      generation = mGeneration;
+    }
+
+    for (uint32_t i = mNextJob++; i < mJobCount; i = mNextJob++) {
+      (*mJob)(i);
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (--mBusyWorkers == 0) {
+      mDone.notify_one();
+    }
+  }
+}
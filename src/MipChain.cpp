@@ -0,0 +1,190 @@
+// Copyright (c) 2024 Meerkat
+#include "../inc/MipChain.h"
+#include "../inc/Image.h"
+#include "../ext/stb/stb_image.h"
+#include <algorithm>
+
+namespace {
+
+// Picks the smallest format that keeps the channels the texels actually use
+// and returns, in sourceChannels, which source channel feeds each stored one.
+void choose_format(
+  const stbi_uc* pixels,
+  vk::PhysicalDevice physicalDevice,
+  vkImage::MipChain* chain,
+  std::vector<uint32_t>* sourceChannels
+) {
+  const size_t texelCount = static_cast<size_t>(chain->width) * chain->height;
+  const uint32_t channels = chain->channels;
+
+  // Grayscale sources are stored in R, real alpha always in the last channel.
+  bool hasColor = false;
+  bool hasAlpha = false;
+  for (size_t i = 0; i < texelCount; ++i) {
+    const stbi_uc* texel = pixels + i * channels;
+    if (channels >= 3 && (texel[0] != texel[1] || texel[0] != texel[2])) {
+      hasColor = true;
+    }
+    if ((channels == 2 || channels == 4) && texel[channels - 1] != 255) {
+      hasAlpha = true;
+    }
+  }
+
+  // Swizzles expand the stored channels back to rgba so the shaders can keep
+  // sampling a regular sampler2D.
+  const vk::ComponentSwizzle r   = vk::ComponentSwizzle::eR;
+  const vk::ComponentSwizzle g   = vk::ComponentSwizzle::eG;
+  const vk::ComponentSwizzle b   = vk::ComponentSwizzle::eB;
+  const vk::ComponentSwizzle a   = vk::ComponentSwizzle::eA;
+  const vk::ComponentSwizzle one = vk::ComponentSwizzle::eOne;
+
+  if (!hasColor && !hasAlpha) {
+    chain->format   = vk::Format::eR8Unorm;
+    chain->swizzle  = vk::ComponentMapping(r, r, r, one);
+    *sourceChannels = { 0 };
+  } else if (!hasColor) {
+    chain->format   = vk::Format::eR8G8Unorm;
+    chain->swizzle  = vk::ComponentMapping(r, r, r, g);
+    *sourceChannels = { 0, channels - 1 };
+  } else if (!hasAlpha && vkImage::is_format_supported(
+               physicalDevice,
+               vk::Format::eR8G8B8Unorm,
+               vk::ImageTiling::eOptimal,
+               vk::FormatFeatureFlagBits::eSampledImage
+               | vk::FormatFeatureFlagBits::eTransferSrc
+               | vk::FormatFeatureFlagBits::eTransferDst)) {
+    chain->format   = vk::Format::eR8G8B8Unorm;
+    chain->swizzle  = vk::ComponentMapping(r, g, b, one);
+    *sourceChannels = { 0, 1, 2 };
+  } else {
+    chain->format   = vk::Format::eR8G8B8A8Unorm;
+    chain->swizzle  = vk::ComponentMapping(r, g, b, hasAlpha ? a : one);
+    *sourceChannels = { 0, 1, 2, 3 };
+  }
+  chain->bytesPerPixel = static_cast<uint32_t>(sourceChannels->size());
+}
+
+std::vector<unsigned char> downsample(
+  const std::vector<unsigned char>& src,
+  vk::Extent2D srcExtent,
+  vk::Extent2D dstExtent,
+  uint32_t bytesPerPixel
+) {
+  std::vector<unsigned char> dst(
+    static_cast<size_t>(dstExtent.width) * dstExtent.height * bytesPerPixel);
+
+  for (uint32_t y = 0; y < dstExtent.height; ++y) {
+    uint32_t y0 = std::min(2 * y, srcExtent.height - 1);
+    uint32_t y1 = std::min(2 * y + 1, srcExtent.height - 1);
+    for (uint32_t x = 0; x < dstExtent.width; ++x) {
+      uint32_t x0 = std::min(2 * x, srcExtent.width - 1);
+      uint32_t x1 = std::min(2 * x + 1, srcExtent.width - 1);
+      for (uint32_t c = 0; c < bytesPerPixel; ++c) {
+        uint32_t sum =
+          src[(y0 * srcExtent.width + x0) * bytesPerPixel + c]
+          + src[(y0 * srcExtent.width + x1) * bytesPerPixel + c]
+          + src[(y1 * srcExtent.width + x0) * bytesPerPixel + c]
+          + src[(y1 * srcExtent.width + x1) * bytesPerPixel + c];
+        dst[(y * dstExtent.width + x) * bytesPerPixel + c] =
+          static_cast<unsigned char>((sum + 2) / 4);
+      }
+    }
+  }
+
+  return dst;
+}
+
+}  // namespace
+
+uint32_t vkImage::mip_level_count(uint32_t width, uint32_t height) {
+  uint32_t levels = 1;
+  uint32_t size = std::max(width, height);
+  while (size > 1) {
+    size >>= 1;
+    ++levels;
+  }
+  return levels;
+}
+
+vk::Extent2D vkImage::mip_level_extent(
+  uint32_t width,
+  uint32_t height,
+  uint32_t level
+) {
+  return vk::Extent2D(std::max(1u, width >> level),
+                      std::max(1u, height >> level));
+}
+
+bool vkImage::load_mip_chain(
+  const char* filename,
+  vk::PhysicalDevice physicalDevice,
+  uint32_t firstLevel,
+  uint32_t lastLevel,
+  uint32_t maxExtent,
+  MipChain* chain
+) {
+  int width = 0;
+  int height = 0;
+  int channels = 0;
+  stbi_uc* pixels =
+    stbi_load(filename, &width, &height, &channels, STBI_default);
+
+  if (!pixels) {
+    printf("Error while loading image: %s\n", filename);
+    return false;
+  }
+
+  chain->width      = static_cast<uint32_t>(width);
+  chain->height     = static_cast<uint32_t>(height);
+  chain->channels   = static_cast<uint32_t>(channels);
+  chain->levelCount = mip_level_count(chain->width, chain->height);
+
+  if (lastLevel == 0 || lastLevel > chain->levelCount) {
+    lastLevel = chain->levelCount;
+  }
+  if (maxExtent > 0) {
+    while (firstLevel + 1 < lastLevel) {
+      vk::Extent2D extent =
+        mip_level_extent(chain->width, chain->height, firstLevel);
+      if (std::max(extent.width, extent.height) <= maxExtent) {
+        break;
+      }
+      ++firstLevel;
+    }
+  }
+  chain->firstLevel = std::min(firstLevel, lastLevel - 1);
+
+  std::vector<uint32_t> sourceChannels;
+  choose_format(pixels, physicalDevice, chain, &sourceChannels);
+
+  // Repack into the chosen layout. Channels missing from the source (alpha on
+  // an RGB image) are filled with opaque white.
+  const size_t texelCount = static_cast<size_t>(chain->width) * chain->height;
+  std::vector<unsigned char> level(texelCount * chain->bytesPerPixel);
+  for (size_t i = 0; i < texelCount; ++i) {
+    const stbi_uc* texel = pixels + i * chain->channels;
+    for (uint32_t c = 0; c < chain->bytesPerPixel; ++c) {
+      uint32_t source = sourceChannels[c];
+      level[i * chain->bytesPerPixel + c] =
+        source < chain->channels ? texel[source] : 255;
+    }
+  }
+  stbi_image_free(pixels);
+
+  chain->levels.clear();
+  for (uint32_t l = 0; l < lastLevel; ++l) {
+    if (l >= chain->firstLevel) {
+      chain->levels.push_back(level);
+    }
+    if (l + 1 < lastLevel) {
+      level = downsample(
+        level,
+        mip_level_extent(chain->width, chain->height, l),
+        mip_level_extent(chain->width, chain->height, l + 1),
+        chain->bytesPerPixel
+      );
+    }
+  }
+
+  return true;
+}
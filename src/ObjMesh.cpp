@@ -1,5 +1,6 @@
 #include "../inc/ObjMesh.h"
 
+#include <algorithm>
 #include <fstream>
 
 vkMesh::ObjMesh::ObjMesh(
@@ -73,6 +74,8 @@ vkMesh::ObjMesh::ObjMesh(
   }
 
   file.close();
+
+  compute_bounds();
 }
 
 void vkMesh::ObjMesh::read_vertex_data(const std::vector<std::string>& words) {
@@ -150,3 +153,23 @@ void vkMesh::ObjMesh::read_corner(const std::string& vertex_description) {
   vertices.push_back(normal[1]);
   vertices.push_back(normal[2]);
 }
+
+void vkMesh::ObjMesh::compute_bounds() {
+  boundsMin = glm::vec3(0.0f);
+  boundsMax = glm::vec3(0.0f);
+  if (!v.empty()) {
+    boundsMin = v[0];
+    boundsMax = v[0];
+  }
+  for (const glm::vec3& position : v) {
+    boundsMin = glm::min(boundsMin, position);
+    boundsMax = glm::max(boundsMax, position);
+  }
+
+  const glm::vec3 center = 0.5f * (boundsMin + boundsMax);
+  float radius = 0.0f;
+  for (const glm::vec3& position : v) {
+    radius = std::max(radius, glm::length(position - center));
+  }
+  boundingSphere = glm::vec4(center, radius);
+}
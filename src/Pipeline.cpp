@@ -1,5 +1,226 @@
 #include "../inc/Pipeline.h"
 
+namespace {
+
+vk::PipelineShaderStageCreateInfo make_shader_info(
+  const vk::ShaderModule& shaderModule,
+  const vk::ShaderStageFlagBits& stage
+) {
+  vk::PipelineShaderStageCreateInfo shaderInfo {};
+  shaderInfo.flags  = vk::PipelineShaderStageCreateFlags();
+  shaderInfo.stage  = stage;
+  shaderInfo.module = shaderModule,
+  shaderInfo.pName  = "main";
+
+  return shaderInfo;
+}
+
+vk::PipelineInputAssemblyStateCreateInfo make_input_assembly_info() {
+  vk::PipelineInputAssemblyStateCreateInfo inputAssemblyInfo {};
+  inputAssemblyInfo.flags    = vk::PipelineInputAssemblyStateCreateFlags();
+  inputAssemblyInfo.topology = vk::PrimitiveTopology::eTriangleList;
+
+  return inputAssemblyInfo;
+}
+
+vk::PipelineRasterizationStateCreateInfo make_rasterizer_info() {
+  vk::PipelineRasterizationStateCreateInfo rasterizerInfo {};
+  rasterizerInfo.flags                   =
+    vk::PipelineRasterizationStateCreateFlags();
+  rasterizerInfo.depthClampEnable        = VK_FALSE;
+  rasterizerInfo.rasterizerDiscardEnable = VK_FALSE;
+  rasterizerInfo.polygonMode             = vk::PolygonMode::eFill;
+  rasterizerInfo.lineWidth               = 1.0f;
+  rasterizerInfo.cullMode                = vk::CullModeFlagBits::eBack;
+  rasterizerInfo.frontFace               = vk::FrontFace::eCounterClockwise;
+  rasterizerInfo.depthBiasEnable         = VK_FALSE;
+
+  return rasterizerInfo;
+}
+
+vk::PipelineMultisampleStateCreateInfo make_multisampling_info() {
+  vk::PipelineMultisampleStateCreateInfo multisamplingInfo {};
+  multisamplingInfo.flags                =
+    vk::PipelineMultisampleStateCreateFlags();
+  multisamplingInfo.sampleShadingEnable  = VK_FALSE;
+  multisamplingInfo.rasterizationSamples = vk::SampleCountFlagBits::e1;
+
+  return multisamplingInfo;
+}
+
+const vk::ColorComponentFlags sAllColorComponents =
+  vk::ColorComponentFlagBits::eR |
+  vk::ColorComponentFlagBits::eG |
+  vk::ColorComponentFlagBits::eB |
+  vk::ColorComponentFlagBits::eA;
+
+}  // namespace
+
+vk::PipelineLayout vkInit::make_pipeline_layout(
+  vk::Device device,
+  const std::vector<vk::DescriptorSetLayout>& descriptorSetLayouts,
+  const std::vector<vk::PushConstantRange>& pushConstantRanges
+) {
+  vk::PipelineLayoutCreateInfo layoutInfo {};
+  layoutInfo.flags = vk::PipelineLayoutCreateFlags();
+  layoutInfo.setLayoutCount =
+    static_cast<uint32_t>(descriptorSetLayouts.size());
+  layoutInfo.pSetLayouts = descriptorSetLayouts.data();
+  layoutInfo.pushConstantRangeCount =
+    static_cast<uint32_t>(pushConstantRanges.size());
+  layoutInfo.pPushConstantRanges = pushConstantRanges.data();
+
+  try {
+    return device.createPipelineLayout(layoutInfo);
+  } catch (vk::SystemError err) {
+    printf("Error while creating pipeline layout. Error: %s\n", err.what());
+  }
+  return nullptr;
+}
+
+vk::Pipeline vkInit::make_graphics_pipeline(
+  vk::Device device,
+  vk::PipelineCache pipelineCache,
+  const GraphicsPipelineDescription& description,
+  bool debug
+) {
+  // All the create infos live on this stack, so concurrent calls share
+  // nothing but the device and the cache.
+  std::vector<vk::ShaderModule> shaderModules;
+  std::vector<vk::PipelineShaderStageCreateInfo> shaderStages;
+  shaderModules.push_back(
+    vkUtil::createModule(description.vertexShader, device, debug));
+  shaderStages.push_back(make_shader_info(
+    shaderModules.back(), vk::ShaderStageFlagBits::eVertex));
+  if (!description.fragmentShader.empty()) {
+    shaderModules.push_back(
+      vkUtil::createModule(description.fragmentShader, device, debug));
+    shaderStages.push_back(make_shader_info(
+      shaderModules.back(), vk::ShaderStageFlagBits::eFragment));
+  }
+
+  vk::PipelineVertexInputStateCreateInfo vertexInputInfo {};
+  vertexInputInfo.flags = vk::PipelineVertexInputStateCreateFlags();
+  vertexInputInfo.vertexBindingDescriptionCount   =
+    static_cast<uint32_t>(description.bindingDescriptions.size());
+  vertexInputInfo.pVertexBindingDescriptions      =
+    description.bindingDescriptions.data();
+  vertexInputInfo.vertexAttributeDescriptionCount =
+    static_cast<uint32_t>(description.attributeDescriptions.size());
+  vertexInputInfo.pVertexAttributeDescriptions    =
+    description.attributeDescriptions.data();
+
+  const vk::PipelineInputAssemblyStateCreateInfo inputAssemblyInfo =
+    make_input_assembly_info();
+
+  // Viewport and scissor are set by each command buffer, so a pipeline
+  // outlives swapchain resizes.
+  vk::PipelineViewportStateCreateInfo viewportState {};
+  viewportState.flags         = vk::PipelineViewportStateCreateFlags();
+  viewportState.viewportCount = 1;
+  viewportState.scissorCount  = 1;
+
+  const std::array<vk::DynamicState, 2> dynamicStates = {
+    vk::DynamicState::eViewport,
+    vk::DynamicState::eScissor
+  };
+  vk::PipelineDynamicStateCreateInfo dynamicState {};
+  dynamicState.flags             = vk::PipelineDynamicStateCreateFlags();
+  dynamicState.dynamicStateCount =
+    static_cast<uint32_t>(dynamicStates.size());
+  dynamicState.pDynamicStates    = dynamicStates.data();
+
+  const vk::PipelineRasterizationStateCreateInfo rasterizerInfo =
+    make_rasterizer_info();
+  const vk::PipelineMultisampleStateCreateInfo multisamplingInfo =
+    make_multisampling_info();
+
+  vk::PipelineDepthStencilStateCreateInfo depthState {};
+  depthState.flags                 =
+    vk::PipelineDepthStencilStateCreateFlags();
+  depthState.depthTestEnable       = true;
+  depthState.depthWriteEnable      = description.depthWrite;
+  depthState.depthCompareOp        = description.depthCompareOp;
+  depthState.depthBoundsTestEnable = false;
+  depthState.stencilTestEnable     = false;
+
+  vk::PipelineColorBlendAttachmentState colorBlendAttachment {};
+  colorBlendAttachment.colorWriteMask = description.colorWriteMask;
+  colorBlendAttachment.blendEnable    = VK_FALSE;
+
+  vk::PipelineColorBlendStateCreateInfo colorBlendingInfo {};
+  colorBlendingInfo.flags = vk::PipelineColorBlendStateCreateFlags();
+  colorBlendingInfo.logicOpEnable = VK_FALSE;
+  colorBlendingInfo.logicOp  =vk::LogicOp::eCopy;
+  colorBlendingInfo.attachmentCount = 1;
+  colorBlendingInfo.pAttachments = &colorBlendAttachment;
+  colorBlendingInfo.blendConstants[0] = 0.0f;
+  colorBlendingInfo.blendConstants[1] = 0.0f;
+  colorBlendingInfo.blendConstants[2] = 0.0f;
+  colorBlendingInfo.blendConstants[3] = 0.0f;
+
+  vk::GraphicsPipelineCreateInfo pipelineInfo {};
+  pipelineInfo.flags               = vk::PipelineCreateFlags();
+  pipelineInfo.stageCount          =
+    static_cast<uint32_t>(shaderStages.size());
+  pipelineInfo.pStages             = shaderStages.data();
+  pipelineInfo.pVertexInputState   = &vertexInputInfo;
+  pipelineInfo.pInputAssemblyState = &inputAssemblyInfo;
+  pipelineInfo.pViewportState      = &viewportState;
+  pipelineInfo.pRasterizationState = &rasterizerInfo;
+  pipelineInfo.pMultisampleState   = &multisamplingInfo;
+  pipelineInfo.pDepthStencilState  =
+    description.depthTest ? &depthState : nullptr;
+  pipelineInfo.pColorBlendState    = &colorBlendingInfo;
+  pipelineInfo.pDynamicState       = &dynamicState;
+  pipelineInfo.layout              = description.pipelineLayout;
+  pipelineInfo.renderPass          = description.renderPass;
+  pipelineInfo.subpass             = 0;
+  pipelineInfo.basePipelineHandle  = nullptr;
+
+  vk::Pipeline graphicsPipeline;
+  try {
+    graphicsPipeline =
+      device.createGraphicsPipeline(pipelineCache, pipelineInfo).value;
+  } catch (vk::SystemError err) {
+    printf("Error while creating pipeline. Error: %s\n", err.what());
+  }
+
+  for (vk::ShaderModule shaderModule : shaderModules) {
+    device.destroyShaderModule(shaderModule);
+  }
+
+  return graphicsPipeline;
+}
+
+vk::Pipeline vkInit::make_compute_pipeline(
+  vk::Device device,
+  vk::PipelineCache pipelineCache,
+  const ComputePipelineDescription& description,
+  bool debug
+) {
+  vk::ShaderModule shaderModule =
+    vkUtil::createModule(description.shader, device, debug);
+
+  vk::ComputePipelineCreateInfo pipelineInfo {};
+  pipelineInfo.stage.stage  = vk::ShaderStageFlagBits::eCompute;
+  pipelineInfo.stage.module = shaderModule;
+  pipelineInfo.stage.pName  = "main";
+  pipelineInfo.layout       = description.pipelineLayout;
+
+  vk::Pipeline computePipeline;
+  try {
+    computePipeline =
+      device.createComputePipeline(pipelineCache, pipelineInfo).value;
+  } catch (vk::SystemError err) {
+    printf("Error while creating compute pipeline. Error: %s\n", err.what());
+  }
+
+  device.destroyShaderModule(shaderModule);
+
+  return computePipeline;
+}
+
 vkInit::PipelineBuilder::PipelineBuilder() {
 }
 
@@ -7,94 +228,66 @@ vkInit::PipelineBuilder::~PipelineBuilder() {
   reset();
 }
 
-void vkInit::PipelineBuilder::init(vk::Device device) {
-  mDevice = device;
+void vkInit::PipelineBuilder::init(
+  vk::Device device,
+  vk::PipelineCache pipelineCache,
+  bool debug
+) {
+  mDevice        = device;
+  mPipelineCache = pipelineCache;
+  mHasDebug      = debug;
 
   reset();
-
-  configure_input_assembly();
-  make_rasterizer_info();
-  configure_multisampling();
-  configure_color_blending();
-  mPipelineInfo.basePipelineHandle = nullptr;
 }
 
 void vkInit::PipelineBuilder::reset() {
-  mPipelineInfo.flags = vk::PipelineCreateFlags();
-
   reset_vertex_format();
-  reset_shader_modules();
+  reset_shaders();
   reset_renderpass_attachments();
   reset_descriptor_set_layout();
+  reset_push_constant_ranges();
+  clear_depth_attachment();
+  mColorWriteMask = sAllColorComponents;
+  mRenderPass     = nullptr;
+  mPipelineLayout = nullptr;
+  mDepthStore     = false;
 }
 
 void vkInit::PipelineBuilder::specify_vertex_format(
   vk::VertexInputBindingDescription bindingDescription,
   std::vector<vk::VertexInputAttributeDescription> attributeDescriptions
 ) {
-  mBindingDescription = bindingDescription;
+  mBindingDescriptions   = { bindingDescription };
   mAttributeDescriptions = attributeDescriptions;
-
-  mVertexInputInfo.vertexBindingDescriptionCount   = 1;
-  mVertexInputInfo.pVertexBindingDescriptions      = &mBindingDescription;
-  mVertexInputInfo.vertexAttributeDescriptionCount =
-    static_cast<uint32_t>(mAttributeDescriptions.size());
-  mVertexInputInfo.pVertexAttributeDescriptions    =
-    mAttributeDescriptions.data();
 }
 
 void vkInit::PipelineBuilder::specify_vertex_shader(const char* filename) {
-  if (mVertexShader) {
-    mDevice.destroyShaderModule(mVertexShader);
-    mVertexShader = nullptr;
-  }
-  mVertexShader = vkUtil::createModule(filename, mDevice, true);
-  mVertexShaderInfo = make_shader_info(
-    mVertexShader,
-    vk::ShaderStageFlagBits::eVertex
-  );
-  mShaderStages.push_back(mVertexShaderInfo);
+  mVertexShader = filename;
 }
 
 void vkInit::PipelineBuilder::specify_fragment_shader(const char* filename) {
-  if (mFragmentShader) {
-    mDevice.destroyShaderModule(mFragmentShader);
-    mFragmentShader = nullptr;
-  }
-  mFragmentShader = vkUtil::createModule(filename, mDevice, true);
-  mFragmentShaderInfo = make_shader_info(
-    mFragmentShader,
-    vk::ShaderStageFlagBits::eFragment
-  );
-  mShaderStages.push_back(mFragmentShaderInfo);
-}
-
-void vkInit::PipelineBuilder::specify_swapchain_extent(
-  vk::Extent2D screen_size
-) {
-  mSwapchainExtent = screen_size;
+  mFragmentShader = filename;
 }
 
 void vkInit::PipelineBuilder::specify_depth_attachment(
   const vk::Format& depthFormat,
   uint32_t attachment_index
 ) {
-  mDepthState.flags                 =
-    vk::PipelineDepthStencilStateCreateFlags();
-  mDepthState.depthTestEnable       = true;
-  mDepthState.depthWriteEnable      = true;
-  mDepthState.depthCompareOp        = vk::CompareOp::eLess;
-  mDepthState.depthBoundsTestEnable = false;
-  mDepthState.stencilTestEnable     = false;
+  set_depth_test(vk::CompareOp::eLess, true);
 
-  mPipelineInfo.pDepthStencilState = &mDepthState;
   mAttachmentDescriptions.insert({
     attachment_index,
     make_renderpass_attachment(
       depthFormat,
-      vk::AttachmentLoadOp::eClear,
-      vk::AttachmentStoreOp::eDontCare,
-      vk::ImageLayout::eUndefined,
+      mOverwrite
+        ? vk::AttachmentLoadOp::eLoad
+        : vk::AttachmentLoadOp::eClear,
+      mDepthStore
+        ? vk::AttachmentStoreOp::eStore
+        : vk::AttachmentStoreOp::eDontCare,
+      mOverwrite
+        ? vk::ImageLayout::eDepthStencilAttachmentOptimal
+        : vk::ImageLayout::eUndefined,
       vk::ImageLayout::eDepthStencilAttachmentOptimal
     )
   });
@@ -108,7 +301,16 @@ void vkInit::PipelineBuilder::specify_depth_attachment(
 }
 
 void vkInit::PipelineBuilder::clear_depth_attachment() {
-  mPipelineInfo.pDepthStencilState = nullptr;
+  mDepthTest = false;
+}
+
+void vkInit::PipelineBuilder::set_depth_test(
+  vk::CompareOp compareOp,
+  bool write
+) {
+  mDepthTest      = true;
+  mDepthWrite     = write;
+  mDepthCompareOp = compareOp;
 }
 
 void vkInit::PipelineBuilder::add_color_attachment(
@@ -153,41 +355,60 @@ void vkInit::PipelineBuilder::set_overwrite_mode(bool mode) {
   mOverwrite = mode;
 }
 
-vkInit::GraphicsPipelineOutBundle vkInit::PipelineBuilder::build() {
-  mPipelineInfo.pVertexInputState   = &mVertexInputInfo;
-  mPipelineInfo.pInputAssemblyState = &mInputAssemblyInfo;
-
-  make_viewport_state();
-  mPipelineInfo.pViewportState = &mViewportState;
+void vkInit::PipelineBuilder::set_depth_store(bool store) {
+  mDepthStore = store;
+}
 
-  mPipelineInfo.pRasterizationState = &mRasterizerInfo;
+vk::RenderPass vkInit::PipelineBuilder::build_renderpass() {
+  return make_renderpass();
+}
 
-  mPipelineInfo.stageCount = mShaderStages.size();
-  mPipelineInfo.pStages    = mShaderStages.data();
+void vkInit::PipelineBuilder::use_renderpass(vk::RenderPass renderPass) {
+  mRenderPass = renderPass;
+}
 
-  mPipelineInfo.pMultisampleState = &mMultisamplingInfo;
+void vkInit::PipelineBuilder::use_pipeline_layout(
+  vk::PipelineLayout pipelineLayout
+) {
+  mPipelineLayout = pipelineLayout;
+}
 
-  mPipelineInfo.pColorBlendState = &mColorBlendingInfo;
+void vkInit::PipelineBuilder::set_color_write_mask(
+  vk::ColorComponentFlags mask
+) {
+  mColorWriteMask = mask;
+}
 
-  vk::PipelineLayout pipelineLayout = make_pipeline_layout();
-  mPipelineInfo.layout = pipelineLayout;
+vkInit::GraphicsPipelineDescription vkInit::PipelineBuilder::describe() {
+  vk::PipelineLayout pipelineLayout = mPipelineLayout
+    ? mPipelineLayout
+    : make_pipeline_layout(
+        mDevice, mDescriptorSetLayouts, mPushConstantRanges);
+  vk::RenderPass renderPass = mRenderPass ? mRenderPass : make_renderpass();
 
-  vk::RenderPass renderpass = make_renderpass();
-  mPipelineInfo.renderPass = renderpass;
-  mPipelineInfo.subpass    = 0;
+  // In declaration order.
+  return GraphicsPipelineDescription {
+    mVertexShader,
+    mFragmentShader,
+    mBindingDescriptions,
+    mAttributeDescriptions,
+    mDepthTest,
+    mDepthWrite,
+    mDepthCompareOp,
+    mColorWriteMask,
+    pipelineLayout,
+    renderPass
+  };
+}
 
-  vk::Pipeline graphicsPipeline;
-  try {
-    graphicsPipeline =
-      mDevice.createGraphicsPipeline(nullptr, mPipelineInfo).value;
-  } catch (vk::SystemError err) {
-    printf("Error while creating pipeline. Error: %s\n", err.what());
-  }
+vkInit::GraphicsPipelineOutBundle vkInit::PipelineBuilder::build() {
+  const GraphicsPipelineDescription description = describe();
 
   GraphicsPipelineOutBundle output {};
-  output.pipelineLayout   = pipelineLayout;
-  output.renderPass       = renderpass;
-  output.graphicsPipeline = graphicsPipeline;
+  output.pipelineLayout   = description.pipelineLayout;
+  output.renderPass       = description.renderPass;
+  output.graphicsPipeline =
+    make_graphics_pipeline(mDevice, mPipelineCache, description, mHasDebug);
 
   return output;
 }
@@ -202,24 +423,30 @@ void vkInit::PipelineBuilder::reset_descriptor_set_layout() {
   mDescriptorSetLayouts.clear();
 }
 
+void vkInit::PipelineBuilder::add_push_constant_range(
+  vk::ShaderStageFlags stages,
+  uint32_t offset,
+  uint32_t size
+) {
+  vk::PushConstantRange range {};
+  range.stageFlags = stages;
+  range.offset     = offset;
+  range.size       = size;
+  mPushConstantRanges.push_back(range);
+}
+
+void vkInit::PipelineBuilder::reset_push_constant_ranges() {
+  mPushConstantRanges.clear();
+}
+
 void vkInit::PipelineBuilder::reset_vertex_format() {
-  mVertexInputInfo.flags = vk::PipelineVertexInputStateCreateFlags();
-  mVertexInputInfo.vertexBindingDescriptionCount   = 0;
-  mVertexInputInfo.pVertexBindingDescriptions      = nullptr;
-  mVertexInputInfo.vertexAttributeDescriptionCount = 0;
-  mVertexInputInfo.pVertexAttributeDescriptions    = nullptr;
+  mBindingDescriptions.clear();
+  mAttributeDescriptions.clear();
 }
 
-void vkInit::PipelineBuilder::reset_shader_modules() {
-  if (mVertexShader) {
-    mDevice.destroyShaderModule(mVertexShader);
-    mVertexShader = nullptr;
-  }
-  if (mFragmentShader) {
-    mDevice.destroyShaderModule(mFragmentShader);
-    mFragmentShader = nullptr;
-  }
-  mShaderStages.clear();
+void vkInit::PipelineBuilder::reset_shaders() {
+  mVertexShader.clear();
+  mFragmentShader.clear();
 }
 
 void vkInit::PipelineBuilder::reset_renderpass_attachments() {
@@ -259,100 +486,6 @@ vk::AttachmentReference vkInit::PipelineBuilder::make_attachment_reference(
   return attachmentRef;
 }
 
-void vkInit::PipelineBuilder::configure_input_assembly() {
-  mInputAssemblyInfo.flags    = vk::PipelineInputAssemblyStateCreateFlags();
-  mInputAssemblyInfo.topology = vk::PrimitiveTopology::eTriangleList;
-}
-
-vk::PipelineShaderStageCreateInfo vkInit::PipelineBuilder::make_shader_info(
-  const vk::ShaderModule& shaderModule,
-  const vk::ShaderStageFlagBits& stage
-) {
-  vk::PipelineShaderStageCreateInfo shaderInfo {};
-  shaderInfo.flags  = vk::PipelineShaderStageCreateFlags();
-  shaderInfo.stage  = stage;
-  shaderInfo.module = shaderModule,
-  shaderInfo.pName  = "main";
-
-  return shaderInfo;
-}
-
-vk::PipelineViewportStateCreateInfo 
-vkInit::PipelineBuilder::make_viewport_state() {
-  mViewport.x        = 0.0f;
-  mViewport.y        = 0.0f;
-  mViewport.width    = static_cast<float>(mSwapchainExtent.width);
-  mViewport.height   = static_cast<float>(mSwapchainExtent.height);
-  mViewport.minDepth = 0.0f;
-  mViewport.maxDepth = 1.0f;
-
-  mScissor.offset.x = 0.0f;
-  mScissor.offset.y = 0.0f;
-  mScissor.extent   = mSwapchainExtent;
-
-  mViewportState.flags         = vk::PipelineViewportStateCreateFlags();
-  mViewportState.viewportCount = 1;
-  mViewportState.pViewports    = &mViewport;
-  mViewportState.scissorCount  = 1;
-  mViewportState.pScissors     = &mScissor;
-
-  return mViewportState;
-}
-
-void vkInit::PipelineBuilder::make_rasterizer_info() {
-  mRasterizerInfo.flags                   =
-    vk::PipelineRasterizationStateCreateFlags();
-  mRasterizerInfo.depthClampEnable        = VK_FALSE;
-  mRasterizerInfo.rasterizerDiscardEnable = VK_FALSE;
-  mRasterizerInfo.polygonMode             = vk::PolygonMode::eFill;
-  mRasterizerInfo.lineWidth               = 1.0f;
-  mRasterizerInfo.cullMode                = vk::CullModeFlagBits::eBack;
-  mRasterizerInfo.frontFace               = vk::FrontFace::eCounterClockwise;
-  mRasterizerInfo.depthBiasEnable         = VK_FALSE;
-}
-
-void vkInit::PipelineBuilder::configure_multisampling() {
-  mMultisamplingInfo.flags                =
-    vk::PipelineMultisampleStateCreateFlags();
-  mMultisamplingInfo.sampleShadingEnable  = VK_FALSE;
-  mMultisamplingInfo.rasterizationSamples = vk::SampleCountFlagBits::e1;
-}
-
-void vkInit::PipelineBuilder::configure_color_blending() {
-  mColorBlendAttachment.colorWriteMask =
-    vk::ColorComponentFlagBits::eR |
-    vk::ColorComponentFlagBits::eG |
-    vk::ColorComponentFlagBits::eB |
-    vk::ColorComponentFlagBits::eA;
-  mColorBlendAttachment.blendEnable = VK_FALSE;
-
-  mColorBlendingInfo.flags = vk::PipelineColorBlendStateCreateFlags();
-  mColorBlendingInfo.logicOpEnable = VK_FALSE;
-  mColorBlendingInfo.logicOp  =vk::LogicOp::eCopy;
-  mColorBlendingInfo.attachmentCount = 1;
-  mColorBlendingInfo.pAttachments = &mColorBlendAttachment;
-  mColorBlendingInfo.blendConstants[0] = 0.0f;
-  mColorBlendingInfo.blendConstants[1] = 0.0f;
-  mColorBlendingInfo.blendConstants[2] = 0.0f;
-  mColorBlendingInfo.blendConstants[3] = 0.0f;
-}
-
-vk::PipelineLayout vkInit::PipelineBuilder::make_pipeline_layout() {
-  vk::PipelineLayoutCreateInfo layoutInfo {};
-  layoutInfo.flags = vk::PipelineLayoutCreateFlags();
-  layoutInfo.setLayoutCount =
-    static_cast<uint32_t>(mDescriptorSetLayouts.size());
-  layoutInfo.pSetLayouts = mDescriptorSetLayouts.data();
-  layoutInfo.pushConstantRangeCount = 0;
-
-  try {
-    return mDevice.createPipelineLayout(layoutInfo);
-  } catch (vk::SystemError err) {
-    printf("Error while creating pipeline layout. Error: %s\n", err.what());
-  }
-  return nullptr;
-}
-
 vk::RenderPass vkInit::PipelineBuilder::make_renderpass() {
   mFlattenedAttachmentDescriptions.clear();
   mFlattenedAttachmentReferences.clear();
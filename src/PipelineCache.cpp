@@ -0,0 +1,131 @@
+// Copyright (c) 2024 Meerkat
+#include "../inc/PipelineCache.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+// VkPipelineCacheHeaderVersionOne, read field by field since the data has
+// no alignment guarantee.
+constexpr size_t sHeaderLengthOffset  = 0;
+constexpr size_t sHeaderVersionOffset = 4;
+constexpr size_t sVendorOffset        = 8;
+constexpr size_t sDeviceOffset        = 12;
+constexpr size_t sUuidOffset          = 16;
+constexpr size_t sHeaderSize          = sUuidOffset + VK_UUID_SIZE;
+
+uint32_t read_u32(const std::vector<char>& data, size_t offset) {
+  uint32_t value;
+  memcpy(&value, data.data() + offset, sizeof(value));
+  return value;
+}
+
+}  // namespace
+
+void vkInit::PipelineCache::init(
+  vk::PhysicalDevice physicalDevice,
+  vk::Device device,
+  const std::string& filename,
+  bool debug
+) {
+  mDevice     = device;
+  mProperties = physicalDevice.getProperties();
+  mFilename   = filename;
+  mDebug      = debug;
+
+  // A missing file is the normal first launch, not an error.
+  std::vector<char> data;
+  std::ifstream file(filename, std::ios::binary);
+  if (file.is_open()) {
+    data.assign(std::istreambuf_iterator<char>(file),
+                std::istreambuf_iterator<char>());
+  }
+
+  mWarm = is_compatible(data);
+  if (debug && !data.empty() && !mWarm) {
+    printf("Pipeline cache %s is from another device or driver, "
+           "starting empty.\n", filename.c_str());
+  }
+
+  vk::PipelineCacheCreateInfo cacheInfo {};
+  cacheInfo.flags           = vk::PipelineCacheCreateFlags();
+  cacheInfo.initialDataSize = mWarm ? data.size() : 0;
+  cacheInfo.pInitialData    = mWarm ? data.data() : nullptr;
+
+  try {
+    mCache = device.createPipelineCache(cacheInfo);
+  } catch (vk::SystemError err) {
+    printf("Error while creating pipeline cache. Error: %s\n", err.what());
+    mWarm = false;
+  }
+}
+
+void vkInit::PipelineCache::destroy() {
+  if (!mCache) {
+    return;
+  }
+
+  save();
+  mDevice.destroyPipelineCache(mCache);
+  mCache = nullptr;
+}
+
+vk::PipelineCache vkInit::PipelineCache::get() const {
+  return mCache;
+}
+
+bool vkInit::PipelineCache::is_warm() const {
+  return mWarm;
+}
+
+bool vkInit::PipelineCache::is_compatible(
+  const std::vector<char>& data
+) const {
+  if (data.size() < sHeaderSize) {
+    return false;
+  }
+
+  return read_u32(data, sHeaderLengthOffset) >= sHeaderSize
+    && read_u32(data, sHeaderVersionOffset)
+      == static_cast<uint32_t>(VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
+    && read_u32(data, sVendorOffset) == mProperties.vendorID
+    && read_u32(data, sDeviceOffset) == mProperties.deviceID
+    && memcmp(data.data() + sUuidOffset,
+              mProperties.pipelineCacheUUID.data(), VK_UUID_SIZE) == 0;
+}
+
+void vkInit::PipelineCache::save() const {
+  std::vector<uint8_t> data;
+  try {
+    data = mDevice.getPipelineCacheData(mCache);
+  } catch (vk::SystemError err) {
+    printf("Error while reading pipeline cache. Error: %s\n", err.what());
+    return;
+  }
+
+  // Written aside and renamed over the old file, so an interrupted write
+  // never leaves a truncated cache behind.
+  const std::string temporary = mFilename + ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    if (!file) {
+      printf("Failed to write pipeline cache %s.\n", temporary.c_str());
+      return;
+    }
+  }
+
+  if (std::rename(temporary.c_str(), mFilename.c_str()) != 0) {
+    printf("Failed to replace pipeline cache %s. Error: %s\n",
+           mFilename.c_str(), strerror(errno));
+    return;
+  }
+
+  if (mDebug) {
+    printf("Saved %zu bytes of pipeline cache to %s.\n",
+           data.size(), mFilename.c_str());
+  }
+}
@@ -0,0 +1,103 @@
+// Copyright (c) 2024 Meerkat
+#include "../inc/PipelineCompiler.h"
+
+vkInit::PipelineCompiler::PipelineCompiler() {
+}
+
+vkInit::PipelineCompiler::~PipelineCompiler() {
+  destroy();
+}
+
+void vkInit::PipelineCompiler::init(
+  vk::Device device,
+  vk::PipelineCache pipelineCache,
+  uint32_t workerCount,
+  bool debug
+) {
+  mDevice        = device;
+  mPipelineCache = pipelineCache;
+  mDebug         = debug;
+
+  mRunning = true;
+  for (uint32_t i = 0; i < workerCount; ++i) {
+    mWorkers.emplace_back(&PipelineCompiler::work, this);
+  }
+}
+
+void vkInit::PipelineCompiler::destroy() {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mRunning = false;
+  }
+  mWakeUp.notify_all();
+
+  for (std::thread& worker : mWorkers) {
+    worker.join();
+  }
+  mWorkers.clear();
+}
+
+vkInit::PipelineCompiler::Ticket vkInit::PipelineCompiler::submit(
+  GraphicsPipelineDescription description
+) {
+  return enqueue([this, description]() {
+    return make_graphics_pipeline(
+      mDevice, mPipelineCache, description, mDebug);
+  });
+}
+
+vkInit::PipelineCompiler::Ticket vkInit::PipelineCompiler::submit(
+  ComputePipelineDescription description
+) {
+  return enqueue([this, description]() {
+    return make_compute_pipeline(
+      mDevice, mPipelineCache, description, mDebug);
+  });
+}
+
+vk::Pipeline vkInit::PipelineCompiler::wait(Ticket ticket) {
+  std::unique_lock<std::mutex> lock(mMutex);
+  mDone.wait(lock, [this, ticket]() { return mTasks[ticket].done; });
+  return mTasks[ticket].pipeline;
+}
+
+vkInit::PipelineCompiler::Ticket vkInit::PipelineCompiler::enqueue(
+  std::function<vk::Pipeline()> compile
+) {
+  Ticket ticket;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    ticket = static_cast<Ticket>(mTasks.size());
+    mTasks.emplace_back();
+    mTasks.back().compile = std::move(compile);
+  }
+  mWakeUp.notify_one();
+
+  return ticket;
+}
+
+void vkInit::PipelineCompiler::work() {
+  while (true) {
+    Task* task;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mWakeUp.wait(lock, [this]() {
+        return !mRunning || mNextTask < mTasks.size();
+      });
+      // Queued work still runs after destroy, nothing submitted is lost.
+      if (mNextTask == mTasks.size()) {
+        return;
+      }
+      task = &mTasks[mNextTask++];
+    }
+
+    vk::Pipeline pipeline = task->compile();
+
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      task->pipeline = pipeline;
+      task->done     = true;
+    }
+    mDone.notify_all();
+  }
+}
@@ -0,0 +1,127 @@
+// Copyright (c) 2024 Meerkat
+#include "../inc/SamplerCache.h"
+#include <functional>
+
+namespace {
+
+template <typename T>
+void hash_combine(size_t* seed, const T& value) {
+  *seed ^= std::hash<T>{}(value) + 0x9e3779b9 + (*seed << 6) + (*seed >> 2);
+}
+
+}  // namespace
+
+size_t vkImage::SamplerInfoHash::operator()(
+  const vk::SamplerCreateInfo& info
+) const {
+  size_t seed = 0;
+  hash_combine(&seed, static_cast<VkSamplerCreateFlags>(info.flags));
+  hash_combine(&seed, static_cast<uint32_t>(info.magFilter));
+  hash_combine(&seed, static_cast<uint32_t>(info.minFilter));
+  hash_combine(&seed, static_cast<uint32_t>(info.mipmapMode));
+  hash_combine(&seed, static_cast<uint32_t>(info.addressModeU));
+  hash_combine(&seed, static_cast<uint32_t>(info.addressModeV));
+  hash_combine(&seed, static_cast<uint32_t>(info.addressModeW));
+  hash_combine(&seed, info.mipLodBias);
+  hash_combine(&seed, info.anisotropyEnable);
+  hash_combine(&seed, info.maxAnisotropy);
+  hash_combine(&seed, info.compareEnable);
+  hash_combine(&seed, static_cast<uint32_t>(info.compareOp));
+  hash_combine(&seed, info.minLod);
+  hash_combine(&seed, info.maxLod);
+  hash_combine(&seed, static_cast<uint32_t>(info.borderColor));
+  hash_combine(&seed, info.unnormalizedCoordinates);
+  return seed;
+}
+
+bool vkImage::SamplerInfoEqual::operator()(
+  const vk::SamplerCreateInfo& a,
+  const vk::SamplerCreateInfo& b
+) const {
+  return a.flags                 == b.flags
+    && a.magFilter               == b.magFilter
+    && a.minFilter               == b.minFilter
+    && a.mipmapMode              == b.mipmapMode
+    && a.addressModeU            == b.addressModeU
+    && a.addressModeV            == b.addressModeV
+    && a.addressModeW            == b.addressModeW
+    && a.mipLodBias              == b.mipLodBias
+    && a.anisotropyEnable        == b.anisotropyEnable
+    && a.maxAnisotropy           == b.maxAnisotropy
+    && a.compareEnable           == b.compareEnable
+    && a.compareOp               == b.compareOp
+    && a.minLod                  == b.minLod
+    && a.maxLod                  == b.maxLod
+    && a.borderColor             == b.borderColor
+    && a.unnormalizedCoordinates == b.unnormalizedCoordinates;
+}
+
+vkImage::SamplerCache::SamplerCache() {
+}
+
+vkImage::SamplerCache::~SamplerCache() {
+  destroy();
+}
+
+void vkImage::SamplerCache::init(vk::Device device) {
+  mDevice = device;
+}
+
+void vkImage::SamplerCache::destroy() {
+  for (const auto& [_, entry] : mSamplers) {
+    mDevice.destroySampler(entry.sampler);
+  }
+  mSamplers.clear();
+  mKeys.clear();
+}
+
+vk::Sampler vkImage::SamplerCache::acquire(
+  const vk::SamplerCreateInfo& samplerInfo
+) {
+  // The key only covers the core fields, so a chained struct (reduction mode,
+  // YCbCr conversion) would be dropped or matched against a sampler without
+  // it. Such samplers are created outside the cache.
+  if (samplerInfo.pNext) {
+    printf("Error: sampler cache does not take extension structs.\n");
+    return nullptr;
+  }
+
+  auto found = mSamplers.find(samplerInfo);
+  if (found != mSamplers.end()) {
+    ++found->second.references;
+    return found->second.sampler;
+  }
+
+  vk::Sampler sampler = nullptr;
+  try {
+    sampler = mDevice.createSampler(samplerInfo);
+  } catch (vk::SystemError err) {
+    printf("Error while creating image sampler. Error: %s\n", err.what());
+    return nullptr;
+  }
+
+  mSamplers.insert({ samplerInfo, { sampler, 1 } });
+  mKeys.insert({ static_cast<VkSampler>(sampler), samplerInfo });
+
+  return sampler;
+}
+
+void vkImage::SamplerCache::release(vk::Sampler sampler) {
+  auto key = mKeys.find(static_cast<VkSampler>(sampler));
+  if (key == mKeys.end()) {
+    return;
+  }
+
+  auto found = mSamplers.find(key->second);
+  if (--found->second.references > 0) {
+    return;
+  }
+
+  mDevice.destroySampler(found->second.sampler);
+  mSamplers.erase(found);
+  mKeys.erase(key);
+}
+
+size_t vkImage::SamplerCache::size() const {
+  return mSamplers.size();
+}
@@ -1,20 +1,273 @@
 // Copyright (c) 2024 Meerkat
 #include "../inc/Scene.h"
+#include "../inc/Frustum.h"
+#include <algorithm>
+#include <numeric>
+#include <type_traits>
 
 Scene::Scene() {
 }
 
 void Scene::init() {
-  positions.insert({ vkMesh::MeshTypes::GROUND, {} });
-  positions.insert({ vkMesh::MeshTypes::GIRL,   {} });
-  positions.insert({ vkMesh::MeshTypes::SKULL,  {} });
-
-  positions[vkMesh::MeshTypes::GROUND]
-    .push_back(glm::vec3(10.0f, 0.0f, 0.0f));
-  positions[vkMesh::MeshTypes::GIRL]
-    .push_back(glm::vec3(17.0f, 0.0f, 0.0f));
-  positions[vkMesh::MeshTypes::SKULL]
-    .push_back(glm::vec3(15.0f, -5.0f, 0.0f));
-  positions[vkMesh::MeshTypes::SKULL]
-    .push_back(glm::vec3(15.0f, 5.0f, 0.0f));
+  add(vkMesh::MeshTypes::GROUND, glm::vec3(10.0f, 0.0f, 0.0f));
+  add(vkMesh::MeshTypes::GIRL,   glm::vec3(17.0f, 0.0f, 0.0f));
+  add(vkMesh::MeshTypes::SKULL,  glm::vec3(15.0f, -5.0f, 0.0f));
+  add(vkMesh::MeshTypes::SKULL,  glm::vec3(15.0f, 5.0f, 0.0f));
+
+  flush();
+}
+
+InstanceHandle Scene::add(
+  vkMesh::MeshTypes mesh,
+  uint32_t material,
+  const glm::vec3& position,
+  const glm::quat& rotation,
+  const glm::vec3& scale,
+  uint32_t instanceFlags
+) {
+  uint32_t slot;
+  if (mFreeSlots.empty()) {
+    slot = static_cast<uint32_t>(mSlotIndex.size());
+    mSlotIndex.push_back(0);
+    mSlotGeneration.push_back(0);
+  } else {
+    slot = mFreeSlots.back();
+    mFreeSlots.pop_back();
+  }
+
+  mSlotIndex[slot] = static_cast<uint32_t>(positions.size());
+  mInstanceSlot.push_back(slot);
+
+  positions.push_back(position);
+  rotations.push_back(rotation);
+  scales.push_back(scale);
+  meshes.push_back(mesh);
+  materials.push_back(material);
+  flags.push_back(instanceFlags);
+
+  mDirty = true;
+
+  return { slot, mSlotGeneration[slot] };
+}
+
+InstanceHandle Scene::add(vkMesh::MeshTypes mesh, const glm::vec3& position) {
+  return add(mesh, static_cast<uint32_t>(mesh), position);
+}
+
+void Scene::remove(InstanceHandle handle) {
+  if (!contains(handle)) {
+    return;
+  }
+
+  // Move the last instance into the hole, flush restores the order.
+  const uint32_t index = mSlotIndex[handle.slot];
+  const uint32_t last  = static_cast<uint32_t>(positions.size()) - 1;
+  swap_instances(index, last);
+
+  positions.pop_back();
+  rotations.pop_back();
+  scales.pop_back();
+  meshes.pop_back();
+  materials.pop_back();
+  flags.pop_back();
+  mInstanceSlot.pop_back();
+
+  ++mSlotGeneration[handle.slot];
+  mFreeSlots.push_back(handle.slot);
+
+  mDirty = true;
+}
+
+void Scene::set_transform(
+  InstanceHandle handle,
+  const glm::vec3& position,
+  const glm::quat& rotation,
+  const glm::vec3& scale
+) {
+  if (!contains(handle)) {
+    return;
+  }
+
+  const uint32_t index = mSlotIndex[handle.slot];
+  positions[index] = position;
+  rotations[index] = rotation;
+  scales[index]    = scale;
+  mMoved.push_back(index);
+}
+
+void Scene::set_mesh_bounds(
+  vkMesh::MeshTypes mesh,
+  const glm::vec4& sphere
+) {
+  mMeshBounds[mesh] = sphere;
+  mDirty = true;
+}
+
+bool Scene::contains(InstanceHandle handle) const {
+  return handle.slot < mSlotGeneration.size()
+    && mSlotGeneration[handle.slot] == handle.generation;
+}
+
+uint32_t Scene::get_index(InstanceHandle handle) const {
+  return mSlotIndex[handle.slot];
+}
+
+void Scene::flush() {
+  if (!mDirty) {
+    if (!mMoved.empty()) {
+      for (uint32_t index : mMoved) {
+        bounds[index] = get_world_bounds(index);
+      }
+      mBvh.refit(bounds, mMoved);
+      mChanged.insert(mChanged.end(), mMoved.begin(), mMoved.end());
+      mMoved.clear();
+    }
+    return;
+  }
+
+  const uint32_t count = static_cast<uint32_t>(positions.size());
+
+  std::vector<uint32_t> order(count);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+    [this](uint32_t a, uint32_t b) {
+      if (meshes[a] != meshes[b]) {
+        return meshes[a] < meshes[b];
+      }
+      return materials[a] < materials[b];
+    });
+
+  auto gather = [&order](auto& values) {
+    std::remove_reference_t<decltype(values)> sorted;
+    sorted.reserve(values.size());
+    for (uint32_t index : order) {
+      sorted.push_back(values[index]);
+    }
+    values.swap(sorted);
+  };
+  gather(positions);
+  gather(rotations);
+  gather(scales);
+  gather(meshes);
+  gather(materials);
+  gather(flags);
+  gather(mInstanceSlot);
+
+  for (uint32_t i = 0; i < count; ++i) {
+    mSlotIndex[mInstanceSlot[i]] = i;
+  }
+
+  mDrawRanges.clear();
+  for (uint32_t i = 0; i < count; ++i) {
+    if (mDrawRanges.empty()
+        || mDrawRanges.back().mesh != meshes[i]
+        || mDrawRanges.back().material != materials[i]) {
+      mDrawRanges.push_back({ meshes[i], materials[i], i, 0 });
+    }
+    ++mDrawRanges.back().count;
+  }
+
+  // Sorted by mesh first, so each mesh is one run of its draw ranges.
+  mMeshRanges.clear();
+  for (const DrawRange& range : mDrawRanges) {
+    const size_t mesh = static_cast<size_t>(range.mesh);
+    if (mesh >= mMeshRanges.size()) {
+      mMeshRanges.resize(mesh + 1, { vkMesh::MeshTypes(), 0, 0, 0 });
+    }
+    if (!mMeshRanges[mesh].count) {
+      mMeshRanges[mesh] = { range.mesh, range.material, range.first, 0 };
+    }
+    mMeshRanges[mesh].count += range.count;
+  }
+
+  bounds.resize(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    bounds[i] = get_world_bounds(i);
+  }
+  mBvh.build(bounds);
+  mMoved.clear();
+  mChanged.clear();
+  ++mVersion;
+
+  mDirty = false;
+}
+
+void Scene::query_frustum(
+  const std::array<glm::vec4, 6>& planes,
+  std::vector<uint32_t>* indices
+) const {
+  mBvh.query_frustum(planes, indices);
+}
+
+void Scene::query_sphere(
+  const glm::vec3& center,
+  float radius,
+  std::vector<uint32_t>* indices
+) const {
+  mBvh.query_sphere(center, radius, indices);
+}
+
+bool Scene::raycast(
+  const glm::vec3& origin,
+  const glm::vec3& direction,
+  float maxDistance,
+  uint32_t* index,
+  float* distance
+) const {
+  return mBvh.raycast(origin, direction, maxDistance, index, distance);
+}
+
+uint64_t Scene::get_version() const {
+  return mVersion;
+}
+
+const std::vector<uint32_t>& Scene::get_changed() const {
+  return mChanged;
+}
+
+void Scene::clear_changed() {
+  mChanged.clear();
+}
+
+size_t Scene::get_instance_count() const {
+  return positions.size();
+}
+
+const std::vector<Scene::DrawRange>& Scene::get_draw_ranges() const {
+  return mDrawRanges;
+}
+
+const std::vector<Scene::DrawRange>& Scene::get_mesh_ranges() const {
+  return mMeshRanges;
+}
+
+glm::mat4 Scene::get_model(uint32_t index) const {
+  return glm::translate(glm::mat4(1.0f), positions[index])
+    * glm::mat4_cast(rotations[index])
+    * glm::scale(glm::mat4(1.0f), scales[index]);
+}
+
+glm::vec4 Scene::get_world_bounds(uint32_t index) const {
+  auto sphere = mMeshBounds.find(meshes[index]);
+  if (sphere == mMeshBounds.end()) {
+    return glm::vec4(positions[index], 0.0f);
+  }
+  return vkUtil::transform_sphere(get_model(index), sphere->second);
+}
+
+void Scene::swap_instances(uint32_t a, uint32_t b) {
+  if (a == b) {
+    return;
+  }
+
+  std::swap(positions[a], positions[b]);
+  std::swap(rotations[a], rotations[b]);
+  std::swap(scales[a], scales[b]);
+  std::swap(meshes[a], meshes[b]);
+  std::swap(materials[a], materials[b]);
+  std::swap(flags[a], flags[b]);
+  std::swap(mInstanceSlot[a], mInstanceSlot[b]);
+
+  mSlotIndex[mInstanceSlot[a]] = a;
+  mSlotIndex[mInstanceSlot[b]] = b;
 }
@@ -0,0 +1,444 @@
+// Copyright (c) 2024 Meerkat
+#include "../inc/SoftwareOcclusion.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define OCCLUSION_X86
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define OCCLUSION_NEON
+#endif
+
+namespace {
+
+using Triangle = vkUtil::OcclusionBuffer::Triangle;
+
+constexpr uint32_t sLanes = 8;
+
+// Triangles smaller than this in pixels cover no pixel center worth testing.
+constexpr float sMinArea = 1e-6f;
+
+// Keeps the nearer depth of the pixels [first, last] of the row inside the
+// triangle. first is a multiple of eight and the row a whole number of
+// eight pixel blocks, the pixels of a block outside the triangle fail its
+// edge test.
+using ShadeSpan = void (*)(
+  const Triangle& triangle,
+  float y,
+  int32_t first,
+  int32_t last,
+  float* row
+);
+
+#if defined(OCCLUSION_X86)
+
+__attribute__((target("avx2")))
+void shade_span_avx2(
+  const Triangle& triangle,
+  float y,
+  int32_t first,
+  int32_t last,
+  float* row
+) {
+  const __m256 offsets = _mm256_setr_ps(
+    0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+
+  __m256 a[3], base[3];
+  for (int e = 0; e < 3; ++e) {
+    a[e]    = _mm256_set1_ps(triangle.edgeA[e]);
+    base[e] = _mm256_set1_ps(triangle.edgeB[e] * y + triangle.edgeC[e]);
+  }
+  const __m256 depthA    = _mm256_set1_ps(triangle.depthA);
+  const __m256 depthBase =
+    _mm256_set1_ps(triangle.depthB * y + triangle.depthC);
+  const __m256 zero      = _mm256_setzero_ps();
+
+  for (int32_t x = first; x <= last; x += sLanes) {
+    const __m256 px =
+      _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), offsets);
+
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (int e = 0; e < 3; ++e) {
+      const __m256 edge = _mm256_add_ps(_mm256_mul_ps(a[e], px), base[e]);
+      inside = _mm256_and_ps(inside, _mm256_cmp_ps(edge, zero, _CMP_GE_OQ));
+    }
+
+    const __m256 depth =
+      _mm256_add_ps(_mm256_mul_ps(depthA, px), depthBase);
+    const __m256 old = _mm256_loadu_ps(row + x);
+    _mm256_storeu_ps(
+      row + x, _mm256_blendv_ps(old, _mm256_min_ps(old, depth), inside));
+  }
+}
+
+// Four pixels per iteration.
+void shade_span_sse2(
+  const Triangle& triangle,
+  float y,
+  int32_t first,
+  int32_t last,
+  float* row
+) {
+  const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+
+  __m128 a[3], base[3];
+  for (int e = 0; e < 3; ++e) {
+    a[e]    = _mm_set1_ps(triangle.edgeA[e]);
+    base[e] = _mm_set1_ps(triangle.edgeB[e] * y + triangle.edgeC[e]);
+  }
+  const __m128 depthA    = _mm_set1_ps(triangle.depthA);
+  const __m128 depthBase = _mm_set1_ps(triangle.depthB * y + triangle.depthC);
+  const __m128 zero      = _mm_setzero_ps();
+
+  for (int32_t x = first; x <= last; x += 4) {
+    const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offsets);
+
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (int e = 0; e < 3; ++e) {
+      const __m128 edge = _mm_add_ps(_mm_mul_ps(a[e], px), base[e]);
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(edge, zero));
+    }
+
+    const __m128 depth = _mm_add_ps(_mm_mul_ps(depthA, px), depthBase);
+    const __m128 old = _mm_loadu_ps(row + x);
+    const __m128 nearer = _mm_min_ps(old, depth);
+    _mm_storeu_ps(row + x, _mm_or_ps(
+      _mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+  }
+}
+
+#elif defined(OCCLUSION_NEON)
+
+// Four pixels per iteration.
+void shade_span_neon(
+  const Triangle& triangle,
+  float y,
+  int32_t first,
+  int32_t last,
+  float* row
+) {
+  const float offsetData[4] = { 0.5f, 1.5f, 2.5f, 3.5f };
+  const float32x4_t offsets = vld1q_f32(offsetData);
+
+  float32x4_t a[3], base[3];
+  for (int e = 0; e < 3; ++e) {
+    a[e]    = vdupq_n_f32(triangle.edgeA[e]);
+    base[e] = vdupq_n_f32(triangle.edgeB[e] * y + triangle.edgeC[e]);
+  }
+  const float32x4_t depthA    = vdupq_n_f32(triangle.depthA);
+  const float32x4_t depthBase =
+    vdupq_n_f32(triangle.depthB * y + triangle.depthC);
+  const float32x4_t zero      = vdupq_n_f32(0.0f);
+
+  for (int32_t x = first; x <= last; x += 4) {
+    const float32x4_t px =
+      vaddq_f32(vdupq_n_f32(static_cast<float>(x)), offsets);
+
+    uint32x4_t inside = vdupq_n_u32(0xffffffffu);
+    for (int e = 0; e < 3; ++e) {
+      const float32x4_t edge = vmlaq_f32(base[e], a[e], px);
+      inside = vandq_u32(inside, vcgeq_f32(edge, zero));
+    }
+
+    const float32x4_t depth = vmlaq_f32(depthBase, depthA, px);
+    const float32x4_t old = vld1q_f32(row + x);
+    vst1q_f32(row + x, vbslq_f32(inside, vminq_f32(old, depth), old));
+  }
+}
+
+#else
+
+void shade_span_scalar(
+  const Triangle& triangle,
+  float y,
+  int32_t first,
+  int32_t last,
+  float* row
+) {
+  for (int32_t x = first; x <= last; ++x) {
+    const float px = static_cast<float>(x) + 0.5f;
+
+    bool inside = true;
+    for (int e = 0; e < 3; ++e) {
+      const float edge = triangle.edgeA[e] * px + triangle.edgeB[e] * y
+        + triangle.edgeC[e];
+      inside = inside && edge >= 0.0f;
+    }
+    if (inside) {
+      const float depth = triangle.depthA * px + triangle.depthB * y
+        + triangle.depthC;
+      row[x] = std::min(row[x], depth);
+    }
+  }
+}
+
+#endif
+
+ShadeSpan select_shade_span() {
+#if defined(OCCLUSION_X86)
+  return __builtin_cpu_supports("avx2") ? shade_span_avx2 : shade_span_sse2;
+#elif defined(OCCLUSION_NEON)
+  return shade_span_neon;
+#else
+  return shade_span_scalar;
+#endif
+}
+
+// Sutherland-Hodgman against the near plane, z >= 0 in clip space with zero
+// to one depth. Writes up to four vertices and returns their count.
+uint32_t clip_near(const glm::vec4 (&in)[3], glm::vec4 (&out)[4]) {
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < 3; ++i) {
+    const glm::vec4& current = in[i];
+    const glm::vec4& next    = in[(i + 1) % 3];
+    if (current.z >= 0.0f) {
+      out[count++] = current;
+    }
+    if ((current.z >= 0.0f) != (next.z >= 0.0f)) {
+      const float t = current.z / (current.z - next.z);
+      out[count++] = current + (next - current) * t;
+    }
+  }
+  return count;
+}
+
+}  // namespace
+
+void vkUtil::OcclusionBuffer::resize(uint32_t width, uint32_t height) {
+  const uint32_t tilesX = std::max(1u, (width + sTileSize - 1) / sTileSize);
+  const uint32_t tilesY = std::max(1u, (height + sTileSize - 1) / sTileSize);
+  if (tilesX == mTilesX && tilesY == mTilesY) {
+    return;
+  }
+
+  mTilesX = tilesX;
+  mTilesY = tilesY;
+  mWidth  = tilesX * sTileSize;
+  mHeight = tilesY * sTileSize;
+  mDepth.assign(static_cast<size_t>(mWidth) * mHeight, 1.0f);
+  mTileDepth.assign(static_cast<size_t>(mTilesX) * mTilesY, 1.0f);
+}
+
+uint32_t vkUtil::OcclusionBuffer::get_width() const {
+  return mWidth;
+}
+
+uint32_t vkUtil::OcclusionBuffer::get_height() const {
+  return mHeight;
+}
+
+uint32_t vkUtil::OcclusionBuffer::get_band_count() const {
+  return mTilesY;
+}
+
+size_t vkUtil::OcclusionBuffer::get_triangle_count() const {
+  return mTriangles.size();
+}
+
+void vkUtil::OcclusionBuffer::begin(const glm::mat4& viewProjection) {
+  mViewProjection = viewProjection;
+  mTriangles.clear();
+}
+
+void vkUtil::OcclusionBuffer::add_occluder(
+  const OccluderMesh& mesh,
+  const glm::mat4& model
+) {
+  const glm::mat4 transform = mViewProjection * model;
+
+  std::vector<glm::vec4> clip;
+  clip.reserve(mesh.positions.size());
+  for (const glm::vec3& position : mesh.positions) {
+    clip.push_back(transform * glm::vec4(position, 1.0f));
+  }
+
+  for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+    const glm::vec4 corners[3] = {
+      clip[mesh.indices[i]],
+      clip[mesh.indices[i + 1]],
+      clip[mesh.indices[i + 2]],
+    };
+    if (corners[0].z >= 0.0f && corners[1].z >= 0.0f
+        && corners[2].z >= 0.0f) {
+      setup_triangle(corners[0], corners[1], corners[2]);
+      continue;
+    }
+
+    glm::vec4 clipped[4];
+    const uint32_t count = clip_near(corners, clipped);
+    for (uint32_t j = 2; j < count; ++j) {
+      setup_triangle(clipped[0], clipped[j - 1], clipped[j]);
+    }
+  }
+}
+
+void vkUtil::OcclusionBuffer::setup_triangle(
+  const glm::vec4& a,
+  const glm::vec4& b,
+  const glm::vec4& c
+) {
+  // Past the near plane w is at least the near distance, so the divide is
+  // safe and the screen positions finite.
+  const glm::vec4* clip[3] = { &a, &b, &c };
+  glm::vec3 screen[3];
+  for (int i = 0; i < 3; ++i) {
+    const glm::vec4& v = *clip[i];
+    if (v.w <= 0.0f) {
+      return;
+    }
+    screen[i] = glm::vec3(
+      (v.x / v.w * 0.5f + 0.5f) * static_cast<float>(mWidth),
+      (v.y / v.w * 0.5f + 0.5f) * static_cast<float>(mHeight),
+      v.z / v.w);
+  }
+
+  const glm::vec3 ab = screen[1] - screen[0];
+  const glm::vec3 ac = screen[2] - screen[0];
+  const float area = ab.x * ac.y - ab.y * ac.x;
+  if (std::fabs(area) < sMinArea) {
+    return;
+  }
+
+  Triangle triangle {};
+  // Pixels whose center may be covered, skipping the triangle if none is.
+  const float minX = std::min({ screen[0].x, screen[1].x, screen[2].x });
+  const float minY = std::min({ screen[0].y, screen[1].y, screen[2].y });
+  const float maxX = std::max({ screen[0].x, screen[1].x, screen[2].x });
+  const float maxY = std::max({ screen[0].y, screen[1].y, screen[2].y });
+  if (maxX < 0.0f || maxY < 0.0f || minX >= static_cast<float>(mWidth)
+      || minY >= static_cast<float>(mHeight)) {
+    return;
+  }
+  triangle.minX = std::max(0, static_cast<int32_t>(minX));
+  triangle.minY = std::max(0, static_cast<int32_t>(minY));
+  triangle.maxX = std::min(
+    static_cast<int32_t>(mWidth) - 1, static_cast<int32_t>(maxX));
+  triangle.maxY = std::min(
+    static_cast<int32_t>(mHeight) - 1, static_cast<int32_t>(maxY));
+
+  // Counter clockwise edges are positive inside, clockwise ones flipped.
+  const float sign = area > 0.0f ? 1.0f : -1.0f;
+  for (int e = 0; e < 3; ++e) {
+    const glm::vec3& from = screen[e];
+    const glm::vec3& to   = screen[(e + 1) % 3];
+    triangle.edgeA[e] = sign * (from.y - to.y);
+    triangle.edgeB[e] = sign * (to.x - from.x);
+    triangle.edgeC[e] = sign * (from.x * to.y - from.y * to.x);
+  }
+
+  triangle.depthA = (ab.z * ac.y - ac.z * ab.y) / area;
+  triangle.depthB = (ac.z * ab.x - ab.z * ac.x) / area;
+  triangle.depthC = screen[0].z - triangle.depthA * screen[0].x
+    - triangle.depthB * screen[0].y;
+
+  mTriangles.push_back(triangle);
+}
+
+void vkUtil::OcclusionBuffer::rasterize(uint32_t band) {
+  static const ShadeSpan shadeSpan = select_shade_span();
+
+  const int32_t firstRow = static_cast<int32_t>(band * sTileSize);
+  const int32_t lastRow  = firstRow + static_cast<int32_t>(sTileSize) - 1;
+  float* depth = mDepth.data() + static_cast<size_t>(firstRow) * mWidth;
+  std::fill(depth, depth + static_cast<size_t>(sTileSize) * mWidth, 1.0f);
+
+  for (const Triangle& triangle : mTriangles) {
+    if (triangle.maxY < firstRow || triangle.minY > lastRow) {
+      continue;
+    }
+
+    const int32_t first = triangle.minX & ~static_cast<int32_t>(sLanes - 1);
+    const int32_t top    = std::max(triangle.minY, firstRow);
+    const int32_t bottom = std::min(triangle.maxY, lastRow);
+    for (int32_t y = top; y <= bottom; ++y) {
+      shadeSpan(
+        triangle,
+        static_cast<float>(y) + 0.5f,
+        first,
+        triangle.maxX,
+        mDepth.data() + static_cast<size_t>(y) * mWidth);
+    }
+  }
+
+  for (uint32_t tile = 0; tile < mTilesX; ++tile) {
+    float farthest = 0.0f;
+    for (uint32_t y = 0; y < sTileSize; ++y) {
+      const float* row = depth + y * mWidth + tile * sTileSize;
+      farthest = std::max(farthest, *std::max_element(row, row + sTileSize));
+    }
+    mTileDepth[band * mTilesX + tile] = farthest;
+  }
+}
+
+bool vkUtil::OcclusionBuffer::is_occluded(const glm::vec4& sphere) const {
+  if (mTriangles.empty()) {
+    return false;
+  }
+
+  // Screen rectangle and nearest depth of the box around the sphere. A box
+  // reaching past the near plane may hide nothing behind it.
+  // The corners are the projected center plus or minus the scaled axes.
+  const glm::vec4 center =
+    mViewProjection * glm::vec4(glm::vec3(sphere), 1.0f);
+  const glm::vec4 axisX = mViewProjection[0] * sphere.w;
+  const glm::vec4 axisY = mViewProjection[1] * sphere.w;
+  const glm::vec4 axisZ = mViewProjection[2] * sphere.w;
+
+  glm::vec2 minScreen(static_cast<float>(mWidth), static_cast<float>(mHeight));
+  glm::vec2 maxScreen(0.0f);
+  float nearest = 1.0f;
+  for (uint32_t corner = 0; corner < 8; ++corner) {
+    const glm::vec4 clip = center
+      + (corner & 1 ? axisX : -axisX)
+      + (corner & 2 ? axisY : -axisY)
+      + (corner & 4 ? axisZ : -axisZ);
+    if (clip.z <= 0.0f || clip.w <= 0.0f) {
+      return false;
+    }
+
+    const glm::vec2 screen(
+      (clip.x / clip.w * 0.5f + 0.5f) * static_cast<float>(mWidth),
+      (clip.y / clip.w * 0.5f + 0.5f) * static_cast<float>(mHeight));
+    minScreen = glm::min(minScreen, screen);
+    maxScreen = glm::max(maxScreen, screen);
+    nearest = std::min(nearest, clip.z / clip.w);
+  }
+
+  // Pixels the rectangle touches, off screen parts are left to the frustum.
+  const int32_t minX = std::max(0, static_cast<int32_t>(minScreen.x));
+  const int32_t minY = std::max(0, static_cast<int32_t>(minScreen.y));
+  const int32_t maxX = std::min(
+    static_cast<int32_t>(mWidth) - 1, static_cast<int32_t>(maxScreen.x));
+  const int32_t maxY = std::min(
+    static_cast<int32_t>(mHeight) - 1, static_cast<int32_t>(maxScreen.y));
+  if (minX > maxX || minY > maxY) {
+    return false;
+  }
+
+  const int32_t tileSize = static_cast<int32_t>(sTileSize);
+  for (int32_t tileY = minY / tileSize; tileY <= maxY / tileSize; ++tileY) {
+    for (int32_t tileX = minX / tileSize; tileX <= maxX / tileSize; ++tileX) {
+      if (mTileDepth[tileY * mTilesX + tileX] < nearest) {
+        continue;
+      }
+
+      // Only the part of the tile under the rectangle decides.
+      const int32_t left   = std::max(minX, tileX * tileSize);
+      const int32_t right  = std::min(maxX, tileX * tileSize + tileSize - 1);
+      const int32_t top    = std::max(minY, tileY * tileSize);
+      const int32_t bottom = std::min(maxY, tileY * tileSize + tileSize - 1);
+      for (int32_t y = top; y <= bottom; ++y) {
+        const float* row = mDepth.data() + static_cast<size_t>(y) * mWidth;
+        for (int32_t x = left; x <= right; ++x) {
+          if (row[x] >= nearest) {
+            return false;
+          }
+        }
+      }
+    }
+  }
+
+  return true;
+}
@@ -1,7 +1,11 @@
 #include "../inc/Texture.h"
 #include "../inc/Image.h"
-#include "../inc/Descriptors.h"
+#include "../inc/TextureRegistry.h"
+#include "../inc/SamplerCache.h"
+#include "../inc/DeletionQueue.h"
 #include "../inc/Memory.h"
+#include <algorithm>
+#include <vector>
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
 #include "../ext/stb/stb_image.h"
@@ -14,7 +18,12 @@ vkImage::Texture::~Texture() {
   mDevice.freeMemory(mImageMemory);
   mDevice.destroyImage(mImage);
   mDevice.destroyImageView(mImageView);
-  mDevice.destroySampler(mSampler);
+  mSamplerCache->release(mSampler);
+
+  if (mPendingImage) {
+    mDevice.destroyImage(mPendingImage);
+    mDevice.freeMemory(mPendingImageMemory);
+  }
 }
 
 void vkImage::Texture::init(const TextureInputChunk& input) {
@@ -23,112 +32,384 @@ void vkImage::Texture::init(const TextureInputChunk& input) {
   mFilename       = input.filename;
   mCommandBuffer  = input.commandBuffer;
   mQueue          = input.queue;
-  mLayout         = input.layout;
-  mDescriptorPool = input.descriptorPool;
+  mRegistry       = input.registry;
+  mSamplerCache   = input.samplerCache;
+  mHasDebug       = input.debug;
 
-  load();
-
-  ImageInputChunk imageInput {};
-  imageInput.device           = mDevice;
-  imageInput.physicalDevice   = mPhysicalDevice;
-  imageInput.width            = mWidth;
-  imageInput.height           = mHeight;
-  imageInput.arraySize        = 1;
-  imageInput.format           = vk::Format::eR8G8B8A8Unorm;
-  imageInput.tiling           = vk::ImageTiling::eOptimal;
-  imageInput.usage            = vk::ImageUsageFlagBits::eTransferDst
-    | vk::ImageUsageFlagBits::eSampled;
-  imageInput.memoryProperties = vk::MemoryPropertyFlagBits::eDeviceLocal;
+  load(input.coarseExtent);
 
+  ImageInputChunk imageInput = make_image_input(mResidentMip);
   mImage = make_image(imageInput);
   mImageMemory = make_image_memory(imageInput, mImage);
 
   populate();
 
-  free(mPixels);
+  mMipChain.levels.clear();
+  mMipChain.levels.shrink_to_fit();
 
   make_view();
   make_sampler();
-  make_descriptor_set();
+  register_texture();
 }
 
-void vkImage::Texture::use(vk::CommandBuffer commandBuffer,
-                           vk::PipelineLayout pipelineLayout) {
-  commandBuffer.bindDescriptorSets(
-    vk::PipelineBindPoint::eGraphics,
-    pipelineLayout,
-    1,
-    mDescriptorSet,
-    nullptr
-  );
+std::optional<uint32_t> vkImage::Texture::get_index() const {
+  return mIndex;
+}
+
+size_t vkImage::Texture::get_memory_savings() const {
+  return static_cast<size_t>(mWidth) * mHeight * (4 - mBytesPerPixel);
+}
+
+const char* vkImage::Texture::get_filename() const {
+  return mFilename;
+}
+
+vk::Extent2D vkImage::Texture::get_extent() const {
+  return vk::Extent2D(mWidth, mHeight);
+}
+
+uint32_t vkImage::Texture::get_mip_levels() const {
+  return mMipLevels;
+}
+
+uint32_t vkImage::Texture::get_resident_mip() const {
+  return mResidentMip;
+}
+
+uint32_t vkImage::Texture::get_coarse_mip() const {
+  return mCoarseMip;
+}
+
+size_t vkImage::Texture::get_level_size(uint32_t level) const {
+  vk::Extent2D extent = mip_level_extent(mWidth, mHeight, level);
+  return static_cast<size_t>(extent.width) * extent.height * mBytesPerPixel;
 }
 
-void vkImage::Texture::load() {
-  int width = 0;
-  int height = 0;
-  int channels = 0;
-  mPixels   = stbi_load(mFilename, &width, &height, &channels, STBI_rgb_alpha);
-  mWidth    = static_cast<uint32_t>(width);
-  mHeight   = static_cast<uint32_t>(height);
-  mChannels = static_cast<uint32_t>(channels);
+size_t vkImage::Texture::get_resident_size(uint32_t residentMip) const {
+  size_t size = 0;
+  for (uint32_t level = residentMip; level < mMipLevels; ++level) {
+    size += get_level_size(level);
+  }
+  return size;
+}
+
+vk::DeviceSize vkImage::Texture::get_staging_alignment() const {
+  // Buffer offsets of copies must be multiples of both 4 and the texel size.
+  return 4 * mBytesPerPixel;
+}
+
+void vkImage::Texture::load(uint32_t coarseExtent) {
+  if (!load_mip_chain(mFilename, mPhysicalDevice, 0, 0, coarseExtent,
+                      &mMipChain)) {
+    return;
+  }
+
+  mWidth         = mMipChain.width;
+  mHeight        = mMipChain.height;
+  mChannels      = mMipChain.channels;
+  mBytesPerPixel = mMipChain.bytesPerPixel;
+  mFormat        = mMipChain.format;
+  mSwizzle       = mMipChain.swizzle;
+  mMipLevels     = mMipChain.levelCount;
+  mCoarseMip     = mMipChain.firstLevel;
+  mResidentMip   = mMipChain.firstLevel;
 
-  if (!mPixels) {
-    printf("Error while loading image: %s\n",
-           mFilename);
+  if (mHasDebug) {
+    printf("Texture %s: %u source channels stored as %s, %zu bytes "
+           "(%zu bytes saved over RGBA8), %u of %u mips resident\n",
+           mFilename,
+           mChannels,
+           vk::to_string(mFormat).c_str(),
+           get_resident_size(0),
+           get_memory_savings(),
+           mMipLevels - mResidentMip,
+           mMipLevels);
   }
 }
 
+vkImage::ImageInputChunk vkImage::Texture::make_image_input(
+  uint32_t residentMip
+) const {
+  vk::Extent2D extent = mip_level_extent(mWidth, mHeight, residentMip);
+
+  ImageInputChunk imageInput {};
+  imageInput.device           = mDevice;
+  imageInput.physicalDevice   = mPhysicalDevice;
+  imageInput.width            = extent.width;
+  imageInput.height           = extent.height;
+  imageInput.arraySize        = 1;
+  imageInput.mipLevels        = mMipLevels - residentMip;
+  imageInput.format           = mFormat;
+  imageInput.tiling           = vk::ImageTiling::eOptimal;
+  imageInput.usage            = vk::ImageUsageFlagBits::eTransferDst
+    | vk::ImageUsageFlagBits::eTransferSrc
+    | vk::ImageUsageFlagBits::eSampled;
+  imageInput.memoryProperties = vk::MemoryPropertyFlagBits::eDeviceLocal;
+
+  return imageInput;
+}
+
 void vkImage::Texture::populate() {
+  const vk::DeviceSize alignment = get_staging_alignment();
+
+  vk::DeviceSize size = 0;
+  for (uint32_t level = mResidentMip; level < mMipLevels; ++level) {
+    size = (size + alignment - 1) / alignment * alignment;
+    size += get_level_size(level);
+  }
+
   vkUtil::BufferInputChunk input {};
   input.device           = mDevice;
   input.physicalDevice   = mPhysicalDevice;
   input.memoryProperties = vk::MemoryPropertyFlagBits::eHostCoherent
     | vk::MemoryPropertyFlagBits::eHostVisible;
   input.usage            = vk::BufferUsageFlagBits::eTransferSrc;
-  input.size             = mWidth * mHeight * 4;
+  input.size             = size;
 
   vkUtil::Buffer stagingBuffer = vkUtil::createBuffer(input);
 
-  void* writeLocation = mDevice.mapMemory(stagingBuffer.bufferMemory,
-                                          0, input.size);
-  memcpy(writeLocation, mPixels, input.size);
+  unsigned char* writeLocation = static_cast<unsigned char*>(
+    mDevice.mapMemory(stagingBuffer.bufferMemory, 0, input.size));
+  vk::DeviceSize offset = 0;
+  for (const std::vector<unsigned char>& level : mMipChain.levels) {
+    offset = (offset + alignment - 1) / alignment * alignment;
+    memcpy(writeLocation + offset, level.data(), level.size());
+    offset += level.size();
+  }
   mDevice.unmapMemory(stagingBuffer.bufferMemory);
 
-  ImageLayoutTransitionJob transitionJob {};
-  transitionJob.commandBuffer = mCommandBuffer;
-  transitionJob.queue         = mQueue;
-  transitionJob.image         = mImage;
-  transitionJob.oldLayout     = vk::ImageLayout::eUndefined;
-  transitionJob.newLayout     = vk::ImageLayout::eTransferDstOptimal;
-  transitionJob.arraySize     = 1;
-  transition_image_layout(transitionJob);
-
-  BufferImageCopyJob copyJob {};
-  copyJob.commandBuffer = mCommandBuffer;
-  copyJob.queue         = mQueue;
-  copyJob.srcBuffer     = stagingBuffer.buffer;
-  copyJob.dstImage      = mImage;
-  copyJob.width         = mWidth;
-  copyJob.height        = mHeight;
-  copyJob.arraySize     = 1;
-  copy_buffer_to_image(copyJob);
-
-  transitionJob.oldLayout = vk::ImageLayout::eTransferDstOptimal;
-  transitionJob.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-  transition_image_layout(transitionJob);
+  const uint32_t levelCount = mMipLevels - mResidentMip;
+
+  vkUtil::start_job(mCommandBuffer);
+  record_layout_transition(
+    mCommandBuffer,
+    mImage,
+    vk::ImageLayout::eUndefined,
+    vk::ImageLayout::eTransferDstOptimal,
+    0,
+    levelCount,
+    1
+  );
+  record_upload(
+    mCommandBuffer,
+    mImage,
+    mResidentMip,
+    mResidentMip,
+    mMipLevels,
+    stagingBuffer.buffer,
+    0
+  );
+  record_layout_transition(
+    mCommandBuffer,
+    mImage,
+    vk::ImageLayout::eTransferDstOptimal,
+    vk::ImageLayout::eShaderReadOnlyOptimal,
+    0,
+    levelCount,
+    1
+  );
+  vkUtil::end_job(mCommandBuffer, mQueue);
 
   mDevice.freeMemory(stagingBuffer.bufferMemory);
   mDevice.destroyBuffer(stagingBuffer.buffer);
 }
 
+void vkImage::Texture::record_upload(
+  vk::CommandBuffer commandBuffer,
+  vk::Image image,
+  uint32_t imageBaseMip,
+  uint32_t firstLevel,
+  uint32_t lastLevel,
+  vk::Buffer staging,
+  vk::DeviceSize stagingOffset
+) {
+  const vk::DeviceSize alignment = get_staging_alignment();
+
+  std::vector<vk::BufferImageCopy> copies;
+  vk::DeviceSize offset = stagingOffset;
+  for (uint32_t level = firstLevel; level < lastLevel; ++level) {
+    offset = (offset + alignment - 1) / alignment * alignment;
+
+    vk::Extent2D extent = mip_level_extent(mWidth, mHeight, level);
+
+    vk::BufferImageCopy copy {};
+    copy.bufferOffset      = offset;
+    copy.bufferRowLength   = 0;
+    copy.bufferImageHeight = 0;
+    copy.imageSubresource.aspectMask     = vk::ImageAspectFlagBits::eColor;
+    copy.imageSubresource.mipLevel       = level - imageBaseMip;
+    copy.imageSubresource.baseArrayLayer = 0;
+    copy.imageSubresource.layerCount     = 1;
+    copy.imageOffset       = vk::Offset3D(0, 0, 0);
+    copy.imageExtent       = vk::Extent3D(extent.width, extent.height, 1);
+    copies.push_back(copy);
+
+    offset += get_level_size(level);
+  }
+
+  if (!copies.empty()) {
+    commandBuffer.copyBufferToImage(
+      staging,
+      image,
+      vk::ImageLayout::eTransferDstOptimal,
+      copies
+    );
+  }
+}
+
+void vkImage::Texture::record_residency_change(
+  vk::CommandBuffer commandBuffer,
+  uint32_t residentMip,
+  vk::Buffer staging,
+  vk::DeviceSize stagingOffset
+) {
+  mPendingMip = residentMip;
+
+  ImageInputChunk imageInput = make_image_input(residentMip);
+  mPendingImage       = make_image(imageInput);
+  mPendingImageMemory = make_image_memory(imageInput, mPendingImage);
+
+  const uint32_t pendingLevels  = mMipLevels - residentMip;
+  const uint32_t residentLevels = mMipLevels - mResidentMip;
+
+  // Frames recorded before the commit keep sampling the current image, so it
+  // goes back to shader read once the copy is done.
+  record_layout_transition(
+    commandBuffer,
+    mPendingImage,
+    vk::ImageLayout::eUndefined,
+    vk::ImageLayout::eTransferDstOptimal,
+    0,
+    pendingLevels,
+    1
+  );
+  record_layout_transition(
+    commandBuffer,
+    mImage,
+    vk::ImageLayout::eShaderReadOnlyOptimal,
+    vk::ImageLayout::eTransferSrcOptimal,
+    0,
+    residentLevels,
+    1
+  );
+
+  std::vector<vk::ImageCopy> copies;
+  for (uint32_t level = std::max(residentMip, mResidentMip);
+       level < mMipLevels; ++level) {
+    vk::Extent2D extent = mip_level_extent(mWidth, mHeight, level);
+
+    vk::ImageCopy copy {};
+    copy.srcSubresource.aspectMask     = vk::ImageAspectFlagBits::eColor;
+    copy.srcSubresource.mipLevel       = level - mResidentMip;
+    copy.srcSubresource.baseArrayLayer = 0;
+    copy.srcSubresource.layerCount     = 1;
+    copy.dstSubresource.aspectMask     = vk::ImageAspectFlagBits::eColor;
+    copy.dstSubresource.mipLevel       = level - residentMip;
+    copy.dstSubresource.baseArrayLayer = 0;
+    copy.dstSubresource.layerCount     = 1;
+    copy.extent = vk::Extent3D(extent.width, extent.height, 1);
+    copies.push_back(copy);
+  }
+  commandBuffer.copyImage(
+    mImage,
+    vk::ImageLayout::eTransferSrcOptimal,
+    mPendingImage,
+    vk::ImageLayout::eTransferDstOptimal,
+    copies
+  );
+
+  if (residentMip < mResidentMip) {
+    record_upload(
+      commandBuffer,
+      mPendingImage,
+      residentMip,
+      residentMip,
+      mResidentMip,
+      staging,
+      stagingOffset
+    );
+  }
+
+  record_layout_transition(
+    commandBuffer,
+    mImage,
+    vk::ImageLayout::eTransferSrcOptimal,
+    vk::ImageLayout::eShaderReadOnlyOptimal,
+    0,
+    residentLevels,
+    1
+  );
+  record_layout_transition(
+    commandBuffer,
+    mPendingImage,
+    vk::ImageLayout::eTransferDstOptimal,
+    vk::ImageLayout::eShaderReadOnlyOptimal,
+    0,
+    pendingLevels,
+    1
+  );
+}
+
+void vkImage::Texture::commit_residency_change(
+  vkUtil::DeletionQueue* deletionQueue
+) {
+  // Frames in flight still sample the old slot, so the new view needs a slot
+  // of its own. Without one the pending image is retired in its place and
+  // the streamer retries once a slot frees up.
+  vk::ImageView pendingView = make_image_view(
+    mDevice,
+    mPendingImage,
+    mFormat,
+    vk::ImageAspectFlagBits::eColor,
+    vk::ImageViewType::e2D,
+    1,
+    mSwizzle,
+    mMipLevels - mPendingMip
+  );
+  std::optional<uint32_t> pendingIndex =
+    mRegistry->register_texture(pendingView, mSampler);
+
+  vk::Device              device    = mDevice;
+  vk::Image               image     = mPendingImage;
+  vk::DeviceMemory        memory    = mPendingImageMemory;
+  vk::ImageView           imageView = pendingView;
+  std::optional<uint32_t> index;
+  TextureRegistry*        registry  = mRegistry;
+  if (pendingIndex) {
+    image     = mImage;
+    memory    = mImageMemory;
+    imageView = mImageView;
+    index     = mIndex;
+
+    mImage       = mPendingImage;
+    mImageMemory = mPendingImageMemory;
+    mImageView   = pendingView;
+    mIndex       = pendingIndex;
+    mResidentMip = mPendingMip;
+  }
+  deletionQueue->push([=]() {
+    device.destroyImageView(imageView);
+    device.destroyImage(image);
+    device.freeMemory(memory);
+    if (index) {
+      registry->release_texture(*index);
+    }
+  });
+
+  mPendingImage       = nullptr;
+  mPendingImageMemory = nullptr;
+}
+
 void vkImage::Texture::make_view() {
   mImageView = make_image_view(
     mDevice,
     mImage,
-    vk::Format::eR8G8B8A8Unorm,
+    mFormat,
     vk::ImageAspectFlagBits::eColor,
     vk::ImageViewType::e2D,
-    1
+    1,
+    mSwizzle,
+    mMipLevels - mResidentMip
   );
 }
 
@@ -149,33 +430,11 @@ void vkImage::Texture::make_sampler() {
   samplerInfo.mipmapMode              = vk::SamplerMipmapMode::eLinear;
   samplerInfo.mipLodBias              = 0.0f;
   samplerInfo.minLod                  = 0.0f;
-  samplerInfo.maxLod                  = 0.0f;
+  samplerInfo.maxLod                  = VK_LOD_CLAMP_NONE;
 
-  try {
-    mSampler = mDevice.createSampler(samplerInfo);
-  } catch (vk::SystemError err) {
-    printf("Error while creating image sampler. Image: %s, Error: %s\n",
-           mFilename, err.what());
-  }
+  mSampler = mSamplerCache->acquire(samplerInfo);
 }
 
-void vkImage::Texture::make_descriptor_set() {
-  bool debug = true;
-  mDescriptorSet  = vkInit::allocate_descriptor_set(
-    mDevice, mDescriptorPool, mLayout, debug);
-
-  vk::DescriptorImageInfo imageDescriptor {};
-  imageDescriptor.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-  imageDescriptor.imageView   = mImageView;
-  imageDescriptor.sampler     = mSampler;
-
-  vk::WriteDescriptorSet descriptorWrite {};
-  descriptorWrite.dstSet          = mDescriptorSet;
-  descriptorWrite.dstBinding      = 0;
-  descriptorWrite.dstArrayElement = 0;
-  descriptorWrite.descriptorType  = vk::DescriptorType::eCombinedImageSampler;
-  descriptorWrite.descriptorCount = 1;
-  descriptorWrite.pImageInfo      = &imageDescriptor;
-
-  mDevice.updateDescriptorSets(1, &descriptorWrite, 0, nullptr);
+void vkImage::Texture::register_texture() {
+  mIndex = mRegistry->register_texture(mImageView, mSampler);
 }
@@ -0,0 +1,284 @@
+// Copyright (c) 2024 Meerkat
+#include "../inc/TextureAtlas.h"
+#include "../inc/Image.h"
+#include "../inc/TextureRegistry.h"
+#include "../inc/SamplerCache.h"
+#include "../inc/Memory.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include "../ext/stb/stb_image.h"
+
+vkImage::TextureAtlas::TextureAtlas() {
+}
+
+vkImage::TextureAtlas::~TextureAtlas() {
+  if (!mImage) {
+    return;
+  }
+
+  mDevice.freeMemory(mImageMemory);
+  mDevice.destroyImage(mImage);
+  mDevice.destroyImageView(mImageView);
+  mSamplerCache->release(mSampler);
+}
+
+void vkImage::TextureAtlas::init(const TextureAtlasInputChunk& input) {
+  mDevice         = input.device;
+  mPhysicalDevice = input.physicalDevice;
+  mCommandBuffer  = input.commandBuffer;
+  mQueue          = input.queue;
+  mRegistry       = input.registry;
+  mSamplerCache   = input.samplerCache;
+  mMaxExtent      = input.maxExtent;
+  mHasDebug       = input.debug;
+}
+
+bool vkImage::TextureAtlas::accepts(const char* filename) const {
+  int width, height, channels;
+  if (!stbi_info(filename, &width, &height, &channels)) {
+    return false;
+  }
+  return static_cast<uint32_t>(width) <= mMaxExtent
+    && static_cast<uint32_t>(height) <= mMaxExtent;
+}
+
+uint32_t vkImage::TextureAtlas::add(const char* filename) {
+  int width, height, channels;
+  stbi_uc* pixels =
+    stbi_load(filename, &width, &height, &channels, STBI_rgb_alpha);
+  if (!pixels) {
+    printf("Unable to load: %s\n", filename);
+    width  = 1;
+    height = 1;
+  }
+
+  Region region {};
+  region.width  = static_cast<uint32_t>(width);
+  region.height = static_cast<uint32_t>(height);
+  region.texels.assign(static_cast<size_t>(width) * height * 4, 255);
+  if (pixels) {
+    memcpy(region.texels.data(), pixels, region.texels.size());
+    stbi_image_free(pixels);
+  }
+
+  mRegions.push_back(std::move(region));
+  return static_cast<uint32_t>(mRegions.size() - 1);
+}
+
+void vkImage::TextureAtlas::finalize() {
+  if (mRegions.empty()) {
+    return;
+  }
+
+  pack();
+
+  ImageInputChunk imageInput {};
+  imageInput.device           = mDevice;
+  imageInput.physicalDevice   = mPhysicalDevice;
+  imageInput.width            = mWidth;
+  imageInput.height           = mHeight;
+  imageInput.arraySize        = 1;
+  imageInput.mipLevels        = 1;
+  imageInput.format           = vk::Format::eR8G8B8A8Unorm;
+  imageInput.tiling           = vk::ImageTiling::eOptimal;
+  imageInput.usage            = vk::ImageUsageFlagBits::eTransferDst
+    | vk::ImageUsageFlagBits::eSampled;
+  imageInput.memoryProperties = vk::MemoryPropertyFlagBits::eDeviceLocal;
+
+  mImage = make_image(imageInput);
+  mImageMemory = make_image_memory(imageInput, mImage);
+
+  populate();
+
+  for (Region& region : mRegions) {
+    region.texels.clear();
+    region.texels.shrink_to_fit();
+  }
+
+  mImageView = make_image_view(
+    mDevice,
+    mImage,
+    vk::Format::eR8G8B8A8Unorm,
+    vk::ImageAspectFlagBits::eColor,
+    vk::ImageViewType::e2D,
+    1
+  );
+
+  vk::SamplerCreateInfo samplerInfo {};
+  samplerInfo.flags                   = vk::SamplerCreateFlags();
+  // Linear both ways, the gutters keep it from reading a neighbour.
+  samplerInfo.minFilter               = vk::Filter::eLinear;
+  samplerInfo.magFilter               = vk::Filter::eLinear;
+  samplerInfo.addressModeU            = vk::SamplerAddressMode::eClampToEdge;
+  samplerInfo.addressModeV            = vk::SamplerAddressMode::eClampToEdge;
+  samplerInfo.addressModeW            = vk::SamplerAddressMode::eClampToEdge;
+  samplerInfo.anisotropyEnable        = false;
+  samplerInfo.maxAnisotropy           = 1.0f;
+  samplerInfo.borderColor             = vk::BorderColor::eIntOpaqueBlack;
+  samplerInfo.unnormalizedCoordinates = false;
+  samplerInfo.compareEnable           = false;
+  samplerInfo.compareOp               = vk::CompareOp::eAlways;
+  samplerInfo.mipmapMode              = vk::SamplerMipmapMode::eNearest;
+  samplerInfo.mipLodBias              = 0.0f;
+  samplerInfo.minLod                  = 0.0f;
+  samplerInfo.maxLod                  = 0.0f;
+  mSampler = mSamplerCache->acquire(samplerInfo);
+
+  mIndex = mRegistry->register_texture(mImageView, mSampler);
+
+  if (mHasDebug) {
+    printf("Texture atlas: %zu textures packed into %ux%u\n",
+           mRegions.size(), mWidth, mHeight);
+  }
+}
+
+std::optional<uint32_t> vkImage::TextureAtlas::get_index() const {
+  return mIndex;
+}
+
+size_t vkImage::TextureAtlas::get_region_count() const {
+  return mRegions.size();
+}
+
+glm::vec4 vkImage::TextureAtlas::get_uv_transform(uint32_t region) const {
+  const Region& r = mRegions[region];
+  return glm::vec4(
+    static_cast<float>(r.width) / mWidth,
+    static_cast<float>(r.height) / mHeight,
+    static_cast<float>(r.x) / mWidth,
+    static_cast<float>(r.y) / mHeight
+  );
+}
+
+void vkImage::TextureAtlas::pack() {
+  // Shelf packing, tallest regions first, into a power of two wide atlas
+  // roughly as wide as it is tall.
+  std::vector<uint32_t> order(mRegions.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+    return mRegions[a].height > mRegions[b].height;
+  });
+
+  size_t area = 0;
+  uint32_t widest = 0;
+  for (const Region& region : mRegions) {
+    const uint32_t width  = region.width + 2 * sGutter;
+    const uint32_t height = region.height + 2 * sGutter;
+    area  += static_cast<size_t>(width) * height;
+    widest = std::max(widest, width);
+  }
+
+  mWidth = 1;
+  const uint32_t targetWidth = std::max(
+    widest,
+    static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(area))))
+  );
+  while (mWidth < targetWidth) {
+    mWidth <<= 1;
+  }
+
+  uint32_t x = 0;
+  uint32_t shelfY = 0;
+  uint32_t shelfHeight = 0;
+  for (uint32_t i : order) {
+    Region& region = mRegions[i];
+    const uint32_t width  = region.width + 2 * sGutter;
+    const uint32_t height = region.height + 2 * sGutter;
+
+    if (x + width > mWidth) {
+      x = 0;
+      shelfY += shelfHeight;
+      shelfHeight = 0;
+    }
+
+    region.x = x + sGutter;
+    region.y = shelfY + sGutter;
+    x += width;
+    shelfHeight = std::max(shelfHeight, height);
+  }
+  mHeight = shelfY + shelfHeight;
+}
+
+void vkImage::TextureAtlas::populate() {
+  vkUtil::BufferInputChunk input {};
+  input.device           = mDevice;
+  input.physicalDevice   = mPhysicalDevice;
+  input.memoryProperties = vk::MemoryPropertyFlagBits::eHostCoherent
+    | vk::MemoryPropertyFlagBits::eHostVisible;
+  input.usage            = vk::BufferUsageFlagBits::eTransferSrc;
+  input.size             = static_cast<size_t>(mWidth) * mHeight * 4;
+
+  vkUtil::Buffer stagingBuffer = vkUtil::createBuffer(input);
+
+  unsigned char* writeLocation = static_cast<unsigned char*>(
+    mDevice.mapMemory(stagingBuffer.bufferMemory, 0, input.size));
+  memset(writeLocation, 0, input.size);
+
+  // Each region is written with its gutter, whose texels repeat the nearest
+  // edge texel of the region.
+  for (const Region& region : mRegions) {
+    const int32_t gutter = static_cast<int32_t>(sGutter);
+    for (int32_t y = -gutter;
+         y < static_cast<int32_t>(region.height) + gutter; ++y) {
+      const int32_t srcY =
+        std::clamp(y, 0, static_cast<int32_t>(region.height) - 1);
+      for (int32_t x = -gutter;
+           x < static_cast<int32_t>(region.width) + gutter; ++x) {
+        const int32_t srcX =
+          std::clamp(x, 0, static_cast<int32_t>(region.width) - 1);
+
+        const size_t src = (static_cast<size_t>(srcY) * region.width + srcX)
+          * 4;
+        const size_t dst = ((region.y + y) * static_cast<size_t>(mWidth)
+          + region.x + x) * 4;
+        memcpy(writeLocation + dst, region.texels.data() + src, 4);
+      }
+    }
+  }
+  mDevice.unmapMemory(stagingBuffer.bufferMemory);
+
+  vkUtil::start_job(mCommandBuffer);
+  record_layout_transition(
+    mCommandBuffer,
+    mImage,
+    vk::ImageLayout::eUndefined,
+    vk::ImageLayout::eTransferDstOptimal,
+    0,
+    1,
+    1
+  );
+
+  vk::BufferImageCopy copy {};
+  copy.bufferOffset      = 0;
+  copy.bufferRowLength   = 0;
+  copy.bufferImageHeight = 0;
+  copy.imageSubresource.aspectMask     = vk::ImageAspectFlagBits::eColor;
+  copy.imageSubresource.mipLevel       = 0;
+  copy.imageSubresource.baseArrayLayer = 0;
+  copy.imageSubresource.layerCount     = 1;
+  copy.imageOffset       = vk::Offset3D(0, 0, 0);
+  copy.imageExtent       = vk::Extent3D(mWidth, mHeight, 1);
+  mCommandBuffer.copyBufferToImage(
+    stagingBuffer.buffer,
+    mImage,
+    vk::ImageLayout::eTransferDstOptimal,
+    1,
+    &copy
+  );
+
+  record_layout_transition(
+    mCommandBuffer,
+    mImage,
+    vk::ImageLayout::eTransferDstOptimal,
+    vk::ImageLayout::eShaderReadOnlyOptimal,
+    0,
+    1,
+    1
+  );
+  vkUtil::end_job(mCommandBuffer, mQueue);
+
+  mDevice.freeMemory(stagingBuffer.bufferMemory);
+  mDevice.destroyBuffer(stagingBuffer.buffer);
+}
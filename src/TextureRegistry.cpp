@@ -0,0 +1,127 @@
+// Copyright (c) 2024 Meerkat
+#include "../inc/TextureRegistry.h"
+#include "../inc/Descriptors.h"
+
+vkImage::TextureRegistry::TextureRegistry() {
+}
+
+vkImage::TextureRegistry::~TextureRegistry() {
+  mDevice.destroyDescriptorPool(mDescriptorPool);
+  mDevice.destroyDescriptorSetLayout(mLayout);
+}
+
+void vkImage::TextureRegistry::init(
+  const TextureRegistryInputChunk& input,
+  bool debug
+) {
+  mDevice      = input.device;
+  mMaxTextures = input.maxTextures;
+
+  // Update after bind lets textures register into unused slots while earlier
+  // frames that bound the set are still in flight.
+  const vk::DescriptorBindingFlags flags =
+    vk::DescriptorBindingFlagBits::ePartiallyBound
+    | vk::DescriptorBindingFlagBits::eUpdateAfterBind
+    | vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+
+  vkInit::DescriptorSetLayoutData bindings;
+  bindings.count = 2;
+  bindings.indices.push_back(0);
+  bindings.types.push_back(vk::DescriptorType::eCombinedImageSampler);
+  bindings.counts.push_back(mMaxTextures);
+  bindings.stages.push_back(vk::ShaderStageFlagBits::eFragment);
+  bindings.bindingFlags.push_back(flags);
+
+  bindings.indices.push_back(1);
+  bindings.types.push_back(vk::DescriptorType::eCombinedImageSampler);
+  bindings.counts.push_back(1);
+  bindings.stages.push_back(vk::ShaderStageFlagBits::eFragment);
+  bindings.bindingFlags.push_back(flags);
+
+  bindings.layoutFlags =
+    vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool;
+
+  mLayout = vkInit::make_descriptor_set_layout(mDevice, bindings, debug);
+  mDescriptorPool = vkInit::make_descriptor_pool(
+    mDevice,
+    1,
+    bindings,
+    debug,
+    vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind
+  );
+  mDescriptorSet = vkInit::allocate_descriptor_set(
+    mDevice, mDescriptorPool, mLayout, debug);
+}
+
+std::optional<uint32_t> vkImage::TextureRegistry::register_texture(
+  vk::ImageView imageView,
+  vk::Sampler sampler
+) {
+  uint32_t index = 0;
+  if (!mFreeSlots.empty()) {
+    index = mFreeSlots.back();
+    mFreeSlots.pop_back();
+  } else if (mTextureCount < mMaxTextures) {
+    index = mTextureCount++;
+  } else {
+    printf("Error: texture registry is full (%u textures).\n", mMaxTextures);
+    return std::nullopt;
+  }
+
+  write_descriptor(0, index, imageView, sampler);
+  return index;
+}
+
+void vkImage::TextureRegistry::release_texture(uint32_t index) {
+  mFreeSlots.push_back(index);
+}
+
+void vkImage::TextureRegistry::set_environment(
+  vk::ImageView imageView,
+  vk::Sampler sampler
+) {
+  write_descriptor(1, 0, imageView, sampler);
+}
+
+void vkImage::TextureRegistry::use(
+  vk::CommandBuffer commandBuffer,
+  vk::PipelineLayout pipelineLayout
+) const {
+  commandBuffer.bindDescriptorSets(
+    vk::PipelineBindPoint::eGraphics,
+    pipelineLayout,
+    1,
+    mDescriptorSet,
+    nullptr
+  );
+}
+
+vk::DescriptorSetLayout vkImage::TextureRegistry::get_layout() const {
+  return mLayout;
+}
+
+vk::DescriptorSet vkImage::TextureRegistry::get_descriptor_set() const {
+  return mDescriptorSet;
+}
+
+void vkImage::TextureRegistry::write_descriptor(
+  uint32_t binding,
+  uint32_t arrayElement,
+  vk::ImageView imageView,
+  vk::Sampler sampler
+) {
+  vk::DescriptorImageInfo imageDescriptor {};
+  imageDescriptor.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+  imageDescriptor.imageView   = imageView;
+  imageDescriptor.sampler     = sampler;
+
+  vk::WriteDescriptorSet descriptorWrite {};
+  descriptorWrite.dstSet          = mDescriptorSet;
+  descriptorWrite.dstBinding      = binding;
+  descriptorWrite.dstArrayElement = arrayElement;
+  descriptorWrite.descriptorType  = vk::DescriptorType::eCombinedImageSampler;
+  descriptorWrite.descriptorCount = 1;
+  descriptorWrite.pImageInfo      = &imageDescriptor;
+
+  mDevice.updateDescriptorSets(1, &descriptorWrite, 0, nullptr);
+}
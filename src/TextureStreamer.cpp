@@ -0,0 +1,382 @@
+// Copyright (c) 2024 Meerkat
+#include "../inc/TextureStreamer.h"
+#include "../inc/Texture.h"
+#include "../inc/DeletionQueue.h"
+#include "../inc/Commands.h"
+#include "../inc/Sync.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+vk::DeviceSize align_up(vk::DeviceSize offset, vk::DeviceSize alignment) {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+vkImage::TextureStreamer::TextureStreamer() {
+}
+
+vkImage::TextureStreamer::~TextureStreamer() {
+}
+
+void vkImage::TextureStreamer::init(
+  const TextureStreamerInputChunk& input,
+  bool debug
+) {
+  mHasDebug       = debug;
+  mDevice         = input.device;
+  mPhysicalDevice = input.physicalDevice;
+  mQueue          = input.queue;
+  mDeletionQueue  = input.deletionQueue;
+  mBudget         = input.budget;
+
+  mCommandPool = vkInit::make_command_pool(
+    mDevice, mPhysicalDevice, input.surface, debug);
+
+  vk::CommandBufferAllocateInfo allocInfo {};
+  allocInfo.commandPool        = mCommandPool;
+  allocInfo.level              = vk::CommandBufferLevel::ePrimary;
+  allocInfo.commandBufferCount = 1;
+  try {
+    mCommandBuffer = mDevice.allocateCommandBuffers(allocInfo)[0];
+  } catch (vk::SystemError err) {
+    printf("Error while creating streaming command buffer. Error %s\n",
+           err.what());
+  }
+
+  mBatchFence = vkInit::make_fence(mDevice, debug);
+
+  mRunning = true;
+  mWorker  = std::thread(&TextureStreamer::work, this);
+}
+
+void vkImage::TextureStreamer::destroy() {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mRunning = false;
+  }
+  mWakeUp.notify_all();
+  if (mWorker.joinable()) {
+    mWorker.join();
+  }
+
+  if (mBatchInFlight) {
+    mDevice.waitForFences(1, &mBatchFence, VK_TRUE, UINT64_MAX);
+    finish_batch();
+  }
+
+  mDevice.destroyFence(mBatchFence);
+  mDevice.destroyCommandPool(mCommandPool);
+}
+
+void vkImage::TextureStreamer::add(Texture* texture) {
+  mTextures.push_back(texture);
+
+  TextureState state {};
+  state.targetMip = texture->get_resident_mip();
+  mStates.insert({ texture, state });
+}
+
+void vkImage::TextureStreamer::set_budget(size_t budget) {
+  mBudget = budget;
+}
+
+void vkImage::TextureStreamer::request(Texture* texture, float screenSize) {
+  TextureState& state = mStates[texture];
+  state.screenSize = std::max(state.screenSize, screenSize);
+}
+
+bool vkImage::TextureStreamer::update() {
+  bool committed = false;
+  if (mBatchInFlight) {
+    if (mDevice.getFenceStatus(mBatchFence) != vk::Result::eSuccess) {
+      for (auto& [_, state] : mStates) {
+        state.screenSize = 0.0f;
+      }
+      return false;
+    }
+    finish_batch();
+    committed = true;
+  }
+
+  choose_targets();
+  submit_batch();
+
+  for (auto& [_, state] : mStates) {
+    state.screenSize = 0.0f;
+  }
+
+  return committed;
+}
+
+size_t vkImage::TextureStreamer::get_resident_size() const {
+  size_t size = 0;
+  for (const Texture* texture : mTextures) {
+    size += texture->get_resident_size(texture->get_resident_mip());
+  }
+  return size;
+}
+
+void vkImage::TextureStreamer::work() {
+  while (true) {
+    LoadRequest request;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mWakeUp.wait(lock, [this]() {
+        return !mRunning || !mRequests.empty();
+      });
+      if (!mRunning) {
+        return;
+      }
+
+      auto next = std::max_element(
+        mRequests.begin(),
+        mRequests.end(),
+        [](const LoadRequest& a, const LoadRequest& b) {
+          return a.priority < b.priority;
+        }
+      );
+      request = *next;
+      mRequests.erase(next);
+    }
+
+    LoadResult result {};
+    result.texture = request.texture;
+    if (!load_mip_chain(request.filename, mPhysicalDevice,
+                        request.firstLevel, request.lastLevel, 0,
+                        &result.mipChain)) {
+      result.mipChain.levels.clear();
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mResults.push_back(std::move(result));
+  }
+}
+
+void vkImage::TextureStreamer::choose_targets() {
+  // Coarse mips stay resident whatever the budget says.
+  size_t used = 0;
+  for (const Texture* texture : mTextures) {
+    used += texture->get_resident_size(texture->get_coarse_mip());
+  }
+
+  std::vector<Texture*> order = mTextures;
+  std::sort(order.begin(), order.end(), [this](Texture* a, Texture* b) {
+    return mStates[a].screenSize > mStates[b].screenSize;
+  });
+
+  // Textures hand out the remaining budget in priority order. Levels that are
+  // already resident only get dropped when a more visible texture needs the
+  // memory.
+  for (Texture* texture : order) {
+    TextureState& state = mStates[texture];
+    uint32_t wanted = std::min(
+      desired_mip(texture, state.screenSize),
+      texture->get_resident_mip()
+    );
+
+    uint32_t target = texture->get_coarse_mip();
+    while (target > wanted) {
+      size_t extra = texture->get_level_size(target - 1);
+      if (used + extra > mBudget) {
+        break;
+      }
+      used += extra;
+      --target;
+    }
+    state.targetMip = target;
+  }
+}
+
+uint32_t vkImage::TextureStreamer::desired_mip(
+  const Texture* texture,
+  float screenSize
+) const {
+  const uint32_t coarseMip = texture->get_coarse_mip();
+  if (screenSize <= 0.0f) {
+    return coarseMip;
+  }
+
+  // The texture is assumed to span the instance once, so one texel per pixel
+  // is reached at the level whose size matches the projected size.
+  vk::Extent2D extent = texture->get_extent();
+  float ratio =
+    static_cast<float>(std::max(extent.width, extent.height)) / screenSize;
+  if (ratio <= 1.0f) {
+    return 0;
+  }
+  uint32_t level = static_cast<uint32_t>(std::floor(std::log2(ratio)));
+  return std::min(level, coarseMip);
+}
+
+void vkImage::TextureStreamer::finish_batch() {
+  for (Texture* texture : mBatch) {
+    texture->commit_residency_change(mDeletionQueue);
+
+    if (mHasDebug) {
+      printf("Streamed %s to mip %u, %zu bytes resident.\n",
+             texture->get_filename(),
+             texture->get_resident_mip(),
+             get_resident_size());
+    }
+  }
+  mBatch.clear();
+
+  if (mStagingBuffer.buffer) {
+    mDevice.destroyBuffer(mStagingBuffer.buffer);
+    mDevice.freeMemory(mStagingBuffer.bufferMemory);
+    mStagingBuffer = {};
+  }
+
+  mBatchInFlight = false;
+}
+
+void vkImage::TextureStreamer::submit_batch() {
+  struct ResidencyChange {
+    Texture*        texture;
+    uint32_t        residentMip;
+    const MipChain* mipChain;
+    vk::DeviceSize  stagingOffset;
+  };
+
+  std::vector<LoadResult> results;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    results.swap(mResults);
+  }
+
+  std::vector<ResidencyChange> changes;
+  vk::DeviceSize stagingSize = 0;
+
+  // Promotions, only valid while the loaded levels still end where the
+  // resident ones begin.
+  for (const LoadResult& result : results) {
+    Texture* texture = result.texture;
+    TextureState& state = mStates[texture];
+    state.loading = false;
+
+    const MipChain& mipChain = result.mipChain;
+    const uint32_t residentMip = texture->get_resident_mip();
+    if (mipChain.levels.empty()
+        || mipChain.firstLevel + mipChain.levels.size() != residentMip) {
+      continue;
+    }
+
+    uint32_t newMip = std::max(mipChain.firstLevel, state.targetMip);
+    if (newMip >= residentMip) {
+      continue;
+    }
+
+    ResidencyChange change { texture, newMip, &mipChain, stagingSize };
+    for (uint32_t level = newMip; level < residentMip; ++level) {
+      stagingSize = align_up(stagingSize, texture->get_staging_alignment());
+      stagingSize += texture->get_level_size(level);
+    }
+    changes.push_back(change);
+  }
+
+  // Demotions and new load requests.
+  std::vector<LoadRequest> requests;
+  for (Texture* texture : mTextures) {
+    TextureState& state = mStates[texture];
+    const uint32_t residentMip = texture->get_resident_mip();
+
+    bool changing = std::any_of(
+      changes.begin(),
+      changes.end(),
+      [texture](const ResidencyChange& c) { return c.texture == texture; }
+    );
+    if (changing) {
+      continue;
+    }
+
+    if (state.targetMip > residentMip) {
+      changes.push_back({ texture, state.targetMip, nullptr, 0 });
+    } else if (state.targetMip < residentMip && !state.loading) {
+      state.loading = true;
+      requests.push_back({
+        texture,
+        texture->get_filename(),
+        state.targetMip,
+        residentMip,
+        state.screenSize
+      });
+    }
+  }
+
+  if (!requests.empty()) {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mRequests.insert(mRequests.end(), requests.begin(), requests.end());
+    }
+    mWakeUp.notify_one();
+  }
+
+  if (changes.empty()) {
+    return;
+  }
+
+  if (stagingSize > 0) {
+    vkUtil::BufferInputChunk input {};
+    input.device           = mDevice;
+    input.physicalDevice   = mPhysicalDevice;
+    input.memoryProperties = vk::MemoryPropertyFlagBits::eHostCoherent
+      | vk::MemoryPropertyFlagBits::eHostVisible;
+    input.usage            = vk::BufferUsageFlagBits::eTransferSrc;
+    input.size             = stagingSize;
+
+    mStagingBuffer = vkUtil::createBuffer(input);
+
+    unsigned char* writeLocation = static_cast<unsigned char*>(
+      mDevice.mapMemory(mStagingBuffer.bufferMemory, 0, input.size));
+    for (const ResidencyChange& change : changes) {
+      if (!change.mipChain) {
+        continue;
+      }
+      const vk::DeviceSize alignment = change.texture->get_staging_alignment();
+      const uint32_t residentMip = change.texture->get_resident_mip();
+      vk::DeviceSize offset = change.stagingOffset;
+      for (uint32_t level = change.residentMip; level < residentMip; ++level) {
+        offset = align_up(offset, alignment);
+        const std::vector<unsigned char>& texels =
+          change.mipChain->levels[level - change.mipChain->firstLevel];
+        memcpy(writeLocation + offset, texels.data(), texels.size());
+        offset += texels.size();
+      }
+    }
+    mDevice.unmapMemory(mStagingBuffer.bufferMemory);
+  }
+
+  mCommandBuffer.reset();
+  vk::CommandBufferBeginInfo beginInfo {};
+  beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+  mCommandBuffer.begin(beginInfo);
+
+  for (const ResidencyChange& change : changes) {
+    change.texture->record_residency_change(
+      mCommandBuffer,
+      change.residentMip,
+      mStagingBuffer.buffer,
+      change.stagingOffset
+    );
+    mBatch.push_back(change.texture);
+  }
+
+  mCommandBuffer.end();
+
+  vk::SubmitInfo submitInfo {};
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers    = &mCommandBuffer;
+
+  mDevice.resetFences(1, &mBatchFence);
+  try {
+    mQueue.submit(submitInfo, mBatchFence);
+    mBatchInFlight = true;
+  } catch (vk::SystemError err) {
+    printf("Failed to submit texture streaming batch. Error: %s\n",
+           err.what());
+  }
+}
@@ -8,6 +8,9 @@ VertexMenagerie::~VertexMenagerie() {
   mDevice.destroyBuffer(mVertexBuffer.buffer);
   mDevice.freeMemory(mVertexBuffer.bufferMemory);
 
+  mDevice.destroyBuffer(mPositionBuffer.buffer);
+  mDevice.freeMemory(mPositionBuffer.bufferMemory);
+
   mDevice.destroyBuffer(mIndexBuffer.buffer);
   mDevice.freeMemory(mIndexBuffer.bufferMemory);
 }
@@ -40,73 +43,78 @@ void VertexMenagerie::consume(
 void VertexMenagerie::finalize(const FinalizationChunk& input) {
   mDevice = input.device;
 
-  {
-    vkUtil::BufferInputChunk inputChunk {};
-    inputChunk.device           = input.device;
-    inputChunk.physicalDevice   = input.physicalDevice;
-    inputChunk.size             = sizeof(float) * mVertexLump.size();
-    inputChunk.usage            = vk::BufferUsageFlagBits::eTransferSrc;
-    inputChunk.memoryProperties = vk::MemoryPropertyFlagBits::eHostVisible
-      | vk::MemoryPropertyFlagBits::eHostCoherent;
-
-    vkUtil::Buffer stagingBuffer = vkUtil::createBuffer(inputChunk);
-
-    void* memoryLocation = mDevice.mapMemory(stagingBuffer.bufferMemory,
-                                             0, inputChunk.size);
-    memcpy(memoryLocation, mVertexLump.data(), inputChunk.size);
-    mDevice.unmapMemory(stagingBuffer.bufferMemory);
-
-
-    inputChunk.usage            = vk::BufferUsageFlagBits::eTransferDst
-      | vk::BufferUsageFlagBits::eVertexBuffer;
-    inputChunk.memoryProperties = vk::MemoryPropertyFlagBits::eDeviceLocal;
-
-    mVertexBuffer = vkUtil::createBuffer(inputChunk);
-
-    vkUtil::copyBuffer(&stagingBuffer, &mVertexBuffer, inputChunk.size,
-                       input.queue, input.commandBuffer);
-
-    mDevice.destroyBuffer(stagingBuffer.buffer);
-    mDevice.freeMemory(stagingBuffer.bufferMemory);
+  mVertexBuffer = upload(
+    input,
+    mVertexLump.data(),
+    sizeof(float) * mVertexLump.size(),
+    vk::BufferUsageFlagBits::eVertexBuffer);
+
+  std::vector<float> positions;
+  const size_t vertexCount = mVertexLump.size() / vkMesh::VERTEX_COMPONENTS;
+  positions.reserve(vertexCount * vkMesh::POSITION_COMPONENTS);
+  for (size_t i = 0; i < vertexCount; ++i) {
+    const float* vertex = &mVertexLump[i * vkMesh::VERTEX_COMPONENTS];
+    positions.insert(
+      positions.end(), vertex, vertex + vkMesh::POSITION_COMPONENTS);
   }
+  mPositionBuffer = upload(
+    input,
+    positions.data(),
+    sizeof(float) * positions.size(),
+    vk::BufferUsageFlagBits::eVertexBuffer);
+
+  mIndexBuffer = upload(
+    input,
+    mIndexLump.data(),
+    sizeof(Index) * mIndexLump.size(),
+    vk::BufferUsageFlagBits::eIndexBuffer);
 
-  {
-    vkUtil::BufferInputChunk inputChunk {};
-    inputChunk.device           = input.device;
-    inputChunk.physicalDevice   = input.physicalDevice;
-    inputChunk.size             = sizeof(Index) * mIndexLump.size();
-    inputChunk.usage            = vk::BufferUsageFlagBits::eTransferSrc;
-    inputChunk.memoryProperties = vk::MemoryPropertyFlagBits::eHostVisible
-      | vk::MemoryPropertyFlagBits::eHostCoherent;
+  mVertexLump.clear();
+}
 
-    vkUtil::Buffer stagingBuffer = vkUtil::createBuffer(inputChunk);
+vkUtil::Buffer VertexMenagerie::upload(
+  const FinalizationChunk& input,
+  const void* data,
+  size_t size,
+  vk::BufferUsageFlags usage
+) {
+  vkUtil::BufferInputChunk inputChunk {};
+  inputChunk.device           = input.device;
+  inputChunk.physicalDevice   = input.physicalDevice;
+  inputChunk.size             = size;
+  inputChunk.usage            = vk::BufferUsageFlagBits::eTransferSrc;
+  inputChunk.memoryProperties = vk::MemoryPropertyFlagBits::eHostVisible
+    | vk::MemoryPropertyFlagBits::eHostCoherent;
 
-    void* memoryLocation = mDevice.mapMemory(stagingBuffer.bufferMemory,
-                                             0, inputChunk.size);
-    memcpy(memoryLocation, mIndexLump.data(), inputChunk.size);
-    mDevice.unmapMemory(stagingBuffer.bufferMemory);
+  vkUtil::Buffer stagingBuffer = vkUtil::createBuffer(inputChunk);
 
+  void* memoryLocation = mDevice.mapMemory(stagingBuffer.bufferMemory,
+                                           0, inputChunk.size);
+  memcpy(memoryLocation, data, inputChunk.size);
+  mDevice.unmapMemory(stagingBuffer.bufferMemory);
 
-    inputChunk.usage            = vk::BufferUsageFlagBits::eTransferDst
-      | vk::BufferUsageFlagBits::eIndexBuffer;
-    inputChunk.memoryProperties = vk::MemoryPropertyFlagBits::eDeviceLocal;
+  inputChunk.usage            = vk::BufferUsageFlagBits::eTransferDst | usage;
+  inputChunk.memoryProperties = vk::MemoryPropertyFlagBits::eDeviceLocal;
 
-    mIndexBuffer = vkUtil::createBuffer(inputChunk);
+  vkUtil::Buffer buffer = vkUtil::createBuffer(inputChunk);
 
-    vkUtil::copyBuffer(&stagingBuffer, &mIndexBuffer, inputChunk.size,
-                       input.queue, input.commandBuffer);
+  vkUtil::copyBuffer(&stagingBuffer, &buffer, inputChunk.size,
+                     input.queue, input.commandBuffer);
 
-    mDevice.destroyBuffer(stagingBuffer.buffer);
-    mDevice.freeMemory(stagingBuffer.bufferMemory);
-  }
+  mDevice.destroyBuffer(stagingBuffer.buffer);
+  mDevice.freeMemory(stagingBuffer.bufferMemory);
 
-  mVertexLump.clear();
+  return buffer;
 }
 
 const vkUtil::Buffer& VertexMenagerie::getVertexBuffer() {
   return mVertexBuffer;
 }
 
+const vkUtil::Buffer& VertexMenagerie::getPositionBuffer() {
+  return mPositionBuffer;
+}
+
 const vkUtil::Buffer& VertexMenagerie::getIndexBuffer() {
   return mIndexBuffer;
 }
@@ -1,9 +1,24 @@
 // Copyright (c) 2024 Meerkat
 
 #include "../inc/App.h"
+#include <cstdlib>
+#include <cstring>
 
-int main() {
-  App* app = new App(800, 800, true);
+int main(int argc, char** argv) {
+  // --texture-budget <MiB> bounds the device memory of streamed textures.
+  size_t textureBudget = Engine::sDefaultTextureBudget;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--texture-budget") == 0 && i + 1 < argc) {
+      textureBudget = static_cast<size_t>(strtoull(argv[++i], nullptr, 10))
+        << 20;
+    } else {
+      printf("Unknown argument: %s\n", argv[i]);
+      printf("Usage: %s [--texture-budget <MiB>]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  App* app = new App(800, 800, true, textureBudget);
   app->run();
   delete app;
 
@@ -1,17 +1,35 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
 layout(location = 2) in vec3 fragNormal;
+layout(location = 3) flat in vec4 fragUvTransform;
+layout(location = 4) flat in uint fragMaterial;
+layout(location = 5) flat in uint fragFlags;
 
 layout(location = 0) out vec4 outColor;
 
-layout(set = 1, binding = 0) uniform sampler2D material;
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+const uint DRAW_FLAG_ATLAS = 1u;
+const uint DRAW_FLAG_UNTEXTURED = 8u;
 
 const vec4 sunColor = vec4(1.0);
 const vec3 sunDirection = normalize(vec3(1.0, 1.0, -1.0));
 
 void main() {
+  vec4 albedo = vec4(1.0);
+  vec2 texCoord = fragTexCoord;
+  if ((fragFlags & DRAW_FLAG_ATLAS) != 0u) {
+    texCoord = fract(texCoord);
+  }
+  texCoord = texCoord * fragUvTransform.xy + fragUvTransform.zw;
+  if ((fragFlags & DRAW_FLAG_UNTEXTURED) == 0u) {
+    albedo = texture(textures[nonuniformEXT(fragMaterial)], texCoord);
+  }
+
   outColor = sunColor * max(0.0, dot(fragNormal, -sunDirection)) 
-    * vec4(fragColor, 1.0f) * texture(material, fragTexCoord);
+    * vec4(fragColor, 1.0f)
+    * albedo;
 }
@@ -6,10 +6,35 @@ layout(set = 0, binding = 0) uniform UniformBufferObject {
   mat4 viewProjection;
 } cameraData;
 
-layout(std140, set = 0, binding = 1) readonly buffer storageBuffer {
-  mat4 model[];
+struct ObjectData {
+  mat4 model;
+  vec4 uvTransform;
+  vec4 bounds;
+  uint mesh;
+  uint material;
+  uint flags;
+  uint pad;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer storageBuffer {
+  ObjectData objects[];
 } objectData;
 
+// Instances that survived culling, indexed by gl_InstanceIndex of GPU
+// driven draws.
+layout(std430, set = 0, binding = 2) readonly buffer visibleBuffer {
+  uint indices[];
+} visibleInstances;
+
+layout(push_constant) uniform DrawPushConstants {
+  vec4 uvTransform;
+  uint baseInstance;
+  uint material;
+  uint flags;
+} draw;
+
+const uint DRAW_FLAG_GPU_DRIVEN = 2u;
+
 layout(location = 0) in vec3 vertexPosition;
 layout(location = 1) in vec3 vertexColor;
 layout(location = 2) in vec2 vertexTexCoord;
@@ -18,12 +43,31 @@ layout(location = 3) in vec3 vertexNormal;
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
 layout(location = 2) out vec3 fragNormal;
+layout(location = 3) flat out vec4 fragUvTransform;
+layout(location = 4) flat out uint fragMaterial;
+layout(location = 5) flat out uint fragFlags;
+
+// Matches the depth prepass bit for bit.
+invariant gl_Position;
 
 void main() {
-  gl_Position = cameraData.viewProjection * 
-    objectData.model[gl_InstanceIndex] * vec4(vertexPosition, 1.0f);
+  uint instance = (draw.flags & DRAW_FLAG_GPU_DRIVEN) != 0u
+    ? visibleInstances.indices[gl_InstanceIndex]
+    : draw.baseInstance + gl_InstanceIndex;
+  ObjectData object = objectData.objects[instance];
+  mat4 model = object.model;
+  gl_Position = cameraData.viewProjection * model * vec4(vertexPosition, 1.0f);
   fragColor = vertexColor;
   fragTexCoord = vertexTexCoord;
-  fragNormal = normalize(
-    objectData.model[gl_InstanceIndex] * vec4(vertexNormal, 0.0f)).xyz;
+  fragNormal = normalize(model * vec4(vertexNormal, 0.0f)).xyz;
+
+  if ((draw.flags & DRAW_FLAG_GPU_DRIVEN) != 0u) {
+    fragUvTransform = object.uvTransform;
+    fragMaterial = object.material;
+    fragFlags = object.flags;
+  } else {
+    fragUvTransform = draw.uvTransform;
+    fragMaterial = draw.material;
+    fragFlags = draw.flags;
+  }
 }
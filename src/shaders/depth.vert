@@ -0,0 +1,52 @@
+#version 450
+
+// Depth prepass: positions only, transformed exactly like default.vert so
+// the main pass finds the same depth.
+
+layout(set = 0, binding = 0) uniform UniformBufferObject {
+  mat4 view;
+  mat4 projection;
+  mat4 viewProjection;
+} cameraData;
+
+struct ObjectData {
+  mat4 model;
+  vec4 uvTransform;
+  vec4 bounds;
+  uint mesh;
+  uint material;
+  uint flags;
+  uint pad;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer storageBuffer {
+  ObjectData objects[];
+} objectData;
+
+// Instances that survived culling, indexed by gl_InstanceIndex of GPU
+// driven draws.
+layout(std430, set = 0, binding = 2) readonly buffer visibleBuffer {
+  uint indices[];
+} visibleInstances;
+
+layout(push_constant) uniform DrawPushConstants {
+  vec4 uvTransform;
+  uint baseInstance;
+  uint material;
+  uint flags;
+} draw;
+
+const uint DRAW_FLAG_GPU_DRIVEN = 2u;
+
+layout(location = 0) in vec3 vertexPosition;
+
+invariant gl_Position;
+
+void main() {
+  uint instance = (draw.flags & DRAW_FLAG_GPU_DRIVEN) != 0u
+    ? visibleInstances.indices[gl_InstanceIndex]
+    : draw.baseInstance + gl_InstanceIndex;
+  ObjectData object = objectData.objects[instance];
+  mat4 model = object.model;
+  gl_Position = cameraData.viewProjection * model * vec4(vertexPosition, 1.0f);
+}
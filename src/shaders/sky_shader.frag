@@ -4,8 +4,8 @@ layout(location = 0) in vec3 forwards;
 
 layout(location = 0) out vec4 outColor;
 
-layout(set = 1, binding = 0) uniform samplerCube material;
+layout(set = 1, binding = 1) uniform samplerCube environment;
 
 void main() {
-  outColor = texture(material, forwards);
+  outColor = texture(environment, forwards);
 }
@@ -8,21 +8,22 @@ layout(set = 0, binding = 0) uniform CameraVectors {
 
 layout(location = 0) out vec3 forwards;
 
-const vec2 screen_corners[6] = vec2[](
+// One triangle covering the screen, at the far plane so geometry drawn
+// before it hides it.
+const vec2 screen_corners[3] = vec2[](
   vec2(-1.0, -1.0),
-  vec2(-1.0,  1.0),
-  vec2( 1.0,  1.0),
-  vec2( 1.0,  1.0),
-  vec2( 1.0, -1.0),
-  vec2(-1.0, -1.0)
+  vec2(-1.0,  3.0),
+  vec2( 3.0, -1.0)
 );
 
 void main() {
   vec2 pos = screen_corners[gl_VertexIndex];
-  gl_Position = vec4(pos, 0.0, 1.0);
-  forwards = normalize(
-      cameraData.forwards 
-      + pos.x * cameraData.right 
+  gl_Position = vec4(pos, 1.0, 1.0);
+  // Left unnormalized: the direction is linear across the screen, and
+  // cubemap lookups do not need unit vectors.
+  forwards = (
+      cameraData.forwards
+      + pos.x * cameraData.right
       - pos.y * cameraData.up
     ).xyz;
 }